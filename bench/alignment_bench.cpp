@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "memory_manager/memory_manager.h"
+
+// Hot-path cost of block alignment. Every block is created right after a
+// 1-byte filler, so with alignment 1 its address is odd; larger alignments
+// pad the block onto a multiple of the argument instead.
+// Arguments: alignment in bytes, block size in bytes.
+
+static constexpr size_t kArena = 64 * 1024 * 1024;
+static constexpr int kBlocks = 64;
+
+static std::vector<uint32_t> setUp(benchmark::State& state, const char* type) {
+    size_t alignment = static_cast<size_t>(state.range(0));
+    size_t size = static_cast<size_t>(state.range(1));
+    auto dumpFolder = std::filesystem::temp_directory_path() / "mpointers_alignment_bench";
+    MemoryManager* manager = MemoryManager::getInstance();
+    manager->initialize(0, kArena, dumpFolder.string());
+    manager->setDumps(false);
+
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < kBlocks; ++i) {
+        manager->createBlock(1, "CHAR");
+        ids.push_back(manager->createBlock(size, type, 0, 0, 0, alignment));
+    }
+    return ids;
+}
+
+static void BM_GetSetDouble(benchmark::State& state) {
+    std::vector<uint32_t> ids = setUp(state, "DOUBLE");
+    MemoryManager* manager = MemoryManager::getInstance();
+    std::vector<double> buffer(static_cast<size_t>(state.range(1)) / sizeof(double), 1.5);
+    size_t bytes = buffer.size() * sizeof(double);
+
+    size_t next = 0;
+    for (auto _ : state) {
+        manager->setValue(ids[next], buffer.data(), bytes);
+        benchmark::DoNotOptimize(manager->getValue(ids[next], buffer.data(), bytes));
+        next = (next + 1) % ids.size();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * 2 * bytes));
+}
+
+static void BM_ComputeSum(benchmark::State& state) {
+    std::vector<uint32_t> ids = setUp(state, "DOUBLE");
+    MemoryManager* manager = MemoryManager::getInstance();
+
+    size_t next = 0;
+    double result;
+    int64_t intResult;
+    std::string error;
+    for (auto _ : state) {
+        manager->compute(memory_service::SUM, ids[next], 0, 0, result, intResult, error);
+        benchmark::DoNotOptimize(result);
+        next = (next + 1) % ids.size();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * state.range(1)));
+}
+
+static void BM_CopyRange(benchmark::State& state) {
+    std::vector<uint32_t> ids = setUp(state, "CHAR");
+    MemoryManager* manager = MemoryManager::getInstance();
+    size_t size = static_cast<size_t>(state.range(1));
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager->copyRange(ids[next], 0, ids[(next + 1) % ids.size()], 0, size));
+        next = (next + 1) % ids.size();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+}
+
+static void AlignmentArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"alignment", "size"});
+    b->ArgsProduct({{1, 8, 64, 4096}, {64, 4096, 262144}});
+}
+
+BENCHMARK(BM_GetSetDouble)->Apply(AlignmentArgs);
+BENCHMARK(BM_ComputeSum)->Apply(AlignmentArgs);
+BENCHMARK(BM_CopyRange)->Apply(AlignmentArgs);
+
+BENCHMARK_MAIN();
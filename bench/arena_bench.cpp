@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "memory_manager/memory_manager.h"
+
+// Hot-path cost of the segmented arena: reads and a reduction over blocks
+// spread across many small segments versus one segment holding the whole
+// arena. The two should be indistinguishable.
+// Arguments: segment size in KB (0 = a single segment), block size in bytes.
+
+static constexpr size_t kArena = 16 * 1024 * 1024;
+static constexpr int kBlocks = 256;
+
+static std::vector<uint32_t> setUp(benchmark::State& state, const char* type) {
+    size_t segment = state.range(0) == 0 ? kArena : static_cast<size_t>(state.range(0)) * 1024;
+    size_t size = static_cast<size_t>(state.range(1));
+    auto dumpFolder = std::filesystem::temp_directory_path() / "mpointers_arena_bench";
+    MemoryManager* manager = MemoryManager::getInstance();
+    manager->initialize(0, kArena, dumpFolder.string(), WalOptions(), 0, segment);
+
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < kBlocks; ++i) {
+        ids.push_back(manager->createBlock(size, type));
+    }
+    return ids;
+}
+
+static void BM_GetValue(benchmark::State& state) {
+    std::vector<uint32_t> ids = setUp(state, "CHAR");
+    MemoryManager* manager = MemoryManager::getInstance();
+    std::vector<char> buffer(static_cast<size_t>(state.range(1)));
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager->getValue(ids[next], buffer.data(), buffer.size()));
+        next = (next + 1) % ids.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+static void BM_ComputeSum(benchmark::State& state) {
+    std::vector<uint32_t> ids = setUp(state, "INT");
+    MemoryManager* manager = MemoryManager::getInstance();
+
+    size_t next = 0;
+    double result;
+    int64_t intResult;
+    std::string error;
+    for (auto _ : state) {
+        manager->compute(memory_service::SUM, ids[next], 0, 0, result, intResult, error);
+        benchmark::DoNotOptimize(intResult);
+        next = (next + 1) % ids.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+static void ArenaArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"segment_kb", "size"});
+    b->ArgsProduct({{0, 64}, {64, 4096}});
+}
+
+BENCHMARK(BM_GetValue)->Apply(ArenaArgs);
+BENCHMARK(BM_ComputeSum)->Apply(ArenaArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,196 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <vector>
+#include "memory_manager/memory_manager.h"
+#include "perf_counters.h"
+
+// MemoryManager called directly, with dumps off, at 1k, 100k and 1M live
+// blocks. Blocks are visited in a fixed random order so lookups do not
+// benefit from walking the table in sequence.
+// Argument: live blocks. Pass --perf_counters for hardware counters per
+// operation (see perf_counters.h).
+
+static constexpr size_t kArena = 256 * 1024 * 1024;
+static constexpr size_t kBlockSize = sizeof(double);
+
+struct Population {
+    std::vector<uint32_t> ids;  // Shuffled
+    bool dirty = true;          // Changed by the last benchmark
+};
+
+// Rebuilds the manager with `live` blocks unless it already holds exactly those
+static Population& populate(size_t live) {
+    static Population population;
+    if (!population.dirty && population.ids.size() == live) {
+        return population;
+    }
+
+    auto dumpFolder = std::filesystem::temp_directory_path() / "mpointers_manager_bench";
+    MemoryManager* manager = MemoryManager::getInstance();
+    manager->setDumps(false);
+    manager->initialize(0, kArena, dumpFolder.string());
+
+    population.ids.clear();
+    for (size_t i = 0; i < live; ++i) {
+        population.ids.push_back(manager->createBlock(kBlockSize, "DOUBLE"));
+    }
+    std::shuffle(population.ids.begin(), population.ids.end(), std::mt19937(42));
+    population.dirty = false;
+    return population;
+}
+
+// Drops the only reference to every other block and collects them
+static void freeHalf(Population& population) {
+    MemoryManager* manager = MemoryManager::getInstance();
+    for (size_t i = 0; i < population.ids.size(); i += 2) {
+        manager->decreaseRefCount(population.ids[i]);
+    }
+    manager->collectGarbage();
+    population.dirty = true;
+}
+
+static void BM_CreateBlock(benchmark::State& state) {
+    Population& population = populate(static_cast<size_t>(state.range(0)));
+    MemoryManager* manager = MemoryManager::getInstance();
+
+    PerfScope perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager->createBlock(kBlockSize, "DOUBLE"));
+    }
+    population.dirty = true;
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+static void BM_SetValue(benchmark::State& state) {
+    Population& population = populate(static_cast<size_t>(state.range(0)));
+    MemoryManager* manager = MemoryManager::getInstance();
+
+    double value = 1.0;
+    size_t next = 0;
+    PerfScope perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager->setValue(population.ids[next], &value, sizeof(value)));
+        next = (next + 1) % population.ids.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+static void BM_GetValue(benchmark::State& state) {
+    Population& population = populate(static_cast<size_t>(state.range(0)));
+    MemoryManager* manager = MemoryManager::getInstance();
+
+    double value;
+    size_t next = 0;
+    PerfScope perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager->getValue(population.ids[next], &value, sizeof(value)));
+        next = (next + 1) % population.ids.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// One increment and one decrement, as a handle copy and release would do
+static void BM_RefCount(benchmark::State& state) {
+    Population& population = populate(static_cast<size_t>(state.range(0)));
+    MemoryManager* manager = MemoryManager::getInstance();
+
+    size_t next = 0;
+    PerfScope perf(state, 2);
+    for (auto _ : state) {
+        manager->increaseRefCount(population.ids[next]);
+        manager->decreaseRefCount(population.ids[next]);
+        next = (next + 1) % population.ids.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 2);
+}
+
+// 64 increments, then the same 64 released through the batched path
+static void BM_RefCountBatch(benchmark::State& state) {
+    constexpr size_t kBatch = 64;
+    Population& population = populate(static_cast<size_t>(state.range(0)));
+    MemoryManager* manager = MemoryManager::getInstance();
+
+    std::vector<uint64_t> batch(kBatch);
+    size_t next = 0;
+    PerfScope perf(state, kBatch * 2);
+    for (auto _ : state) {
+        for (size_t i = 0; i < kBatch; ++i) {
+            batch[i] = population.ids[next];
+            manager->increaseRefCount(population.ids[next]);
+            next = (next + 1) % population.ids.size();
+        }
+        benchmark::DoNotOptimize(manager->decreaseRefCounts(batch.data(), batch.size()));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kBatch * 2));
+}
+
+// Half the blocks are freed by one GC pass before timing starts, so the
+// first pass compacts and the rest measure a pass over a packed arena
+static void BM_Defragment(benchmark::State& state) {
+    Population& population = populate(static_cast<size_t>(state.range(0)));
+    MemoryManager* manager = MemoryManager::getInstance();
+
+    freeHalf(population);
+
+    PerfScope perf(state);
+    for (auto _ : state) {
+        manager->defragment();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * population.ids.size() / 2));
+}
+
+// Reference-count passes over a table where every other block is dead,
+// so each pass checks every descriptor and frees nothing. Also reports
+// the block table's bytes per block.
+static void BM_Sweep(benchmark::State& state) {
+    Population& population = populate(static_cast<size_t>(state.range(0)));
+    MemoryManager* manager = MemoryManager::getInstance();
+    freeHalf(population);
+
+    PerfScope perf(state, static_cast<double>(population.ids.size()));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager->collectGarbage());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * population.ids.size()));
+    state.counters["metadata_B_per_block"] =
+        static_cast<double>(manager->arenaStats().metadataBytes) / population.ids.size();
+}
+
+// Occupancy walk behind GetStats and the metrics endpoint, same table
+static void BM_ArenaStats(benchmark::State& state) {
+    Population& population = populate(static_cast<size_t>(state.range(0)));
+    MemoryManager* manager = MemoryManager::getInstance();
+    freeHalf(population);
+
+    PerfScope perf(state, static_cast<double>(population.ids.size()));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager->arenaStats());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * population.ids.size()));
+}
+
+static void LiveBlocks(benchmark::internal::Benchmark* b) {
+    b->ArgName("live");
+    b->Arg(1000)->Arg(100000)->Arg(1000000);
+}
+
+BENCHMARK(BM_CreateBlock)->Apply(LiveBlocks);
+BENCHMARK(BM_SetValue)->Apply(LiveBlocks);
+BENCHMARK(BM_GetValue)->Apply(LiveBlocks);
+BENCHMARK(BM_RefCount)->Apply(LiveBlocks);
+BENCHMARK(BM_RefCountBatch)->Apply(LiveBlocks);
+BENCHMARK(BM_Defragment)->Apply(LiveBlocks)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Sweep)->Apply(LiveBlocks)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ArenaStats)->Apply(LiveBlocks)->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+    PerfCounters::parseArgs(argc, argv);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
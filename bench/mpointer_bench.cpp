@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <grpcpp/grpcpp.h>
+#include "memory_manager/memory_manager.h"
+#include "mpointers/mpointer.h"
+
+// End-to-end MPointer<T> operations against a gRPC server started in this
+// process on an ephemeral localhost port, so every call crosses the real
+// client stack, HTTP/2 and the service handlers.
+
+static void startServer() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        auto dumpFolder = std::filesystem::temp_directory_path() / "mpointers_mpointer_bench";
+        MemoryManager* manager = MemoryManager::getInstance();
+        manager->setDumps(false);
+        manager->initialize(0, 256 * 1024 * 1024, dumpFolder.string());
+
+        int port = 0;
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(manager);
+        manager->setServer(builder.BuildAndStart());
+        manager->start();
+
+        MPointer<int>::Init("localhost:" + std::to_string(port));
+    });
+}
+
+// New() is normally served from the thread's reservation pool
+static void BM_MPointerNew(benchmark::State& state) {
+    startServer();
+    for (auto _ : state) {
+        MPointer<int> ptr = MPointer<int>::New();
+        benchmark::DoNotOptimize(ptr.id());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// One Set RPC per assignment
+static void BM_MPointerAssign(benchmark::State& state) {
+    startServer();
+    MPointer<int> ptr = MPointer<int>::New();
+    int value = 0;
+    for (auto _ : state) {
+        ptr = value++;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// One Get RPC through the runtime's transport, as get_value() issues it
+static void BM_MPointerGet(benchmark::State& state) {
+    startServer();
+    MPointer<int> ptr = MPointer<int>::New();
+    ptr = 42;
+    memory_service::GetRequest request;
+    request.set_id(ptr.id());
+    for (auto _ : state) {
+        memory_service::GetResponse response;
+        ClientRuntime::getInstance().transport()->Get(request, &response);
+        benchmark::DoNotOptimize(response.value().data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Copying a handle only touches the process-wide reference registry
+static void BM_MPointerCopy(benchmark::State& state) {
+    startServer();
+    MPointer<int> ptr = MPointer<int>::New();
+    for (auto _ : state) {
+        MPointer<int> copy = ptr;
+        benchmark::DoNotOptimize(copy.id());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// A Clone RPC, then the clone's release through the deferred queue
+static void BM_MPointerClone(benchmark::State& state) {
+    startServer();
+    MPointer<int> ptr = MPointer<int>::New();
+    ptr = 42;
+    for (auto _ : state) {
+        MPointer<int> clone = ptr.clone();
+        benchmark::DoNotOptimize(clone.id());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_MPointerNew)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_MPointerAssign)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_MPointerGet)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_MPointerCopy)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_MPointerClone)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Optional hardware counters for the benchmarks (--perf_counters). Each
+// benchmark wraps its timing loop in a PerfScope, which reports cycles,
+// instructions, L1d/LLC/dTLB load misses and branch misses per operation,
+// plus IPC. Counters only cover the benchmark's own thread, in user mode.
+// Events run independently and are scaled for multiplexing. Any event the
+// kernel or the container refuses is left out, with one note on stderr;
+// when none opens, the benchmarks run as if the flag were absent.
+class PerfCounters {
+public:
+    static PerfCounters& get() {
+        static PerfCounters counters;
+        return counters;
+    }
+
+    // Takes --perf_counters out of argv; call before benchmark::Initialize
+    static void parseArgs(int& argc, char** argv) {
+        int kept = 1;
+        bool requested = false;
+        for (int i = 1; i < argc; ++i) {
+            if (std::string(argv[i]) == "--perf_counters") {
+                requested = true;
+            } else {
+                argv[kept++] = argv[i];
+            }
+        }
+        argc = kept;
+        if (requested) get().open();
+    }
+
+    bool enabled() const { return !events.empty(); }
+
+    void start() {
+#ifdef __linux__
+        for (const auto& event : events) {
+            ioctl(event.fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Scaled counts since start(), in event order
+    std::vector<std::pair<const char*, double>> stop() {
+        std::vector<std::pair<const char*, double>> counts;
+#ifdef __linux__
+        for (const auto& event : events) {
+            ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (const auto& event : events) {
+            // value, time enabled, time running
+            uint64_t values[3] = {};
+            if (read(event.fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) continue;
+            double scale = static_cast<double>(values[1]) / static_cast<double>(values[2]);
+            counts.emplace_back(event.name, static_cast<double>(values[0]) * scale);
+        }
+#endif
+        return counts;
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (const auto& event : events) {
+            close(event.fd);
+        }
+#endif
+    }
+
+private:
+    struct Event {
+        const char* name;
+        int fd;
+    };
+    std::vector<Event> events;
+
+    PerfCounters() = default;
+
+    void open() {
+#ifdef __linux__
+        auto cache = [](uint64_t cache, uint64_t op, uint64_t result) {
+            return cache | (op << 8) | (result << 16);
+        };
+        struct Wanted {
+            const char* name;
+            uint32_t type;
+            uint64_t config;
+        };
+        const Wanted wanted[] = {
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"L1d_miss", PERF_TYPE_HW_CACHE,
+             cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"LLC_miss", PERF_TYPE_HW_CACHE,
+             cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"branch_miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"dTLB_miss", PERF_TYPE_HW_CACHE,
+             cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        };
+
+        std::string missing;
+        int lastError = 0;
+        for (const auto& event : wanted) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = event.type;
+            attr.config = event.config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fd < 0) {
+                lastError = errno;
+                missing += missing.empty() ? event.name : std::string(", ") + event.name;
+                continue;
+            }
+            events.push_back(Event{event.name, fd});
+        }
+        if (events.empty()) {
+            std::cerr << "perf counters unavailable (" << std::strerror(lastError)
+                      << "); running without them" << std::endl;
+        } else if (!missing.empty()) {
+            std::cerr << "perf counters: " << missing << " unavailable (" << std::strerror(lastError) << ")"
+                      << std::endl;
+        }
+#else
+        std::cerr << "perf counters are only supported on Linux; running without them" << std::endl;
+#endif
+    }
+};
+
+// Counts the timing loop it encloses; `opsPerIteration` turns the totals
+// into per-operation figures for benchmarks that do several per iteration
+class PerfScope {
+public:
+    explicit PerfScope(benchmark::State& state, double opsPerIteration = 1.0)
+        : state(state), opsPerIteration(opsPerIteration) {
+        if (PerfCounters::get().enabled()) PerfCounters::get().start();
+    }
+    ~PerfScope() {
+        if (!PerfCounters::get().enabled()) return;
+        double cycles = 0;
+        double instructions = 0;
+        for (const auto& count : PerfCounters::get().stop()) {
+            state.counters[count.first] =
+                benchmark::Counter(count.second / opsPerIteration, benchmark::Counter::kAvgIterations);
+            if (std::strcmp(count.first, "cycles") == 0) cycles = count.second;
+            if (std::strcmp(count.first, "instructions") == 0) instructions = count.second;
+        }
+        if (cycles > 0 && instructions > 0) {
+            state.counters["IPC"] = instructions / cycles;
+        }
+    }
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    benchmark::State& state;
+    double opsPerIteration;
+};
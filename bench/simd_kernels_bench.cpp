@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+#include "memory_manager/simd_kernels.h"
+
+// Throughput of every Compute kernel for each instruction set.
+// Arguments: instruction set (0 = scalar, 1 = SSE4.1, 2 = AVX2), element count.
+
+enum class Op { Sum, Min, Max, Dot, Scale, Fill, Add };
+
+template<typename T, Op op>
+static void BM_Kernel(benchmark::State& state) {
+    auto isa = static_cast<simd::Isa>(state.range(0));
+    if (!simd::isSupported(isa)) {
+        state.SkipWithError("instruction set not supported on this CPU");
+        return;
+    }
+    const simd::KernelTable<T>& k = simd::kernels<T>(isa);
+    const size_t count = static_cast<size_t>(state.range(1));
+
+    std::vector<T> a(count), b(count);
+    for (size_t i = 0; i < count; ++i) {
+        a[i] = static_cast<T>(i % 97);
+        b[i] = static_cast<T>(i % 89);
+    }
+
+    for (auto _ : state) {
+        switch (op) {
+            case Op::Sum: benchmark::DoNotOptimize(k.sum(a.data(), count)); break;
+            case Op::Min: benchmark::DoNotOptimize(k.min(a.data(), count)); break;
+            case Op::Max: benchmark::DoNotOptimize(k.max(a.data(), count)); break;
+            case Op::Dot: benchmark::DoNotOptimize(k.dot(a.data(), b.data(), count)); break;
+            case Op::Scale: k.scale(a.data(), count, static_cast<T>(1)); break;
+            case Op::Fill: k.fill(a.data(), count, static_cast<T>(3)); break;
+            case Op::Add: k.add(a.data(), b.data(), count); break;
+        }
+        benchmark::ClobberMemory();
+    }
+
+    const size_t operands = (op == Op::Dot || op == Op::Add) ? 2 : 1;
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * operands * sizeof(T)));
+    state.SetLabel(simd::isaName(isa));
+}
+
+static void KernelArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"isa", "n"});
+    b->ArgsProduct({{0, 1, 2}, {1 << 10, 1 << 16, 1 << 20}});
+}
+
+#define KERNEL_BENCHMARKS(T)                                   \
+    BENCHMARK_TEMPLATE(BM_Kernel, T, Op::Sum)->Apply(KernelArgs);   \
+    BENCHMARK_TEMPLATE(BM_Kernel, T, Op::Min)->Apply(KernelArgs);   \
+    BENCHMARK_TEMPLATE(BM_Kernel, T, Op::Max)->Apply(KernelArgs);   \
+    BENCHMARK_TEMPLATE(BM_Kernel, T, Op::Dot)->Apply(KernelArgs);   \
+    BENCHMARK_TEMPLATE(BM_Kernel, T, Op::Scale)->Apply(KernelArgs); \
+    BENCHMARK_TEMPLATE(BM_Kernel, T, Op::Fill)->Apply(KernelArgs);  \
+    BENCHMARK_TEMPLATE(BM_Kernel, T, Op::Add)->Apply(KernelArgs)
+
+KERNEL_BENCHMARKS(int32_t);
+KERNEL_BENCHMARKS(float);
+KERNEL_BENCHMARKS(double);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include "memory_manager/write_ahead_log.h"
+
+// Durable writes per second through the write-ahead log, for several group
+// commit windows and batch sizes. Each iteration appends one 64-byte write
+// record and waits until it is fsynced; run with more threads to see writers
+// share batches. Point TMPDIR at a real disk, tmpfs makes fsync free.
+// Arguments: commit window in microseconds, batch size in KB.
+
+static std::unique_ptr<WriteAheadLog> wal;
+static std::filesystem::path walDirectory;
+
+static void BM_DurableWrites(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        walDirectory = std::filesystem::temp_directory_path() / "mpointers_wal_bench";
+        std::filesystem::remove_all(walDirectory);
+        wal = std::make_unique<WriteAheadLog>(walDirectory.string(),
+                                              std::chrono::microseconds(state.range(0)),
+                                              static_cast<size_t>(state.range(1)) * 1024);
+        wal->start();
+    }
+
+    memory_service::MutationRecord record;
+    record.set_type(memory_service::MUTATION_WRITE);
+    record.set_id(static_cast<uint64_t>(state.thread_index()) + 1);
+    record.set_data(std::string(64, 'x'));
+
+    for (auto _ : state) {
+        uint64_t sequence = wal->append(record);
+        if (!wal->waitDurable(sequence)) {
+            state.SkipWithError("WAL write failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+
+    if (state.thread_index() == 0) {
+        wal.reset();
+        std::filesystem::remove_all(walDirectory);
+    }
+}
+
+BENCHMARK(BM_DurableWrites)
+    ->ArgNames({"window_us", "batch_kb"})
+    ->ArgsProduct({{0, 100, 1000, 5000}, {16, 256}})
+    ->Threads(1)->Threads(8)->Threads(32)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,137 @@
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// High dynamic range histogram of non-negative integers (normally latencies
+// in nanoseconds), after Gil Tene's HdrHistogram. Values are kept with a
+// fixed number of significant decimal digits over the whole range: buckets
+// double in width, and each is split into the same number of linear
+// sub-buckets. Recording is one index computation and an increment, and
+// histograms from several threads can be merged without losing precision.
+//
+// Not thread-safe; give each thread its own and merge them afterwards.
+class HdrHistogram {
+public:
+    // Tracks 1..highest with `significant_digits` (1-5) of precision;
+    // larger values are clamped to `highest`
+    explicit HdrHistogram(uint64_t highest = 3600ull * 1000 * 1000 * 1000, int significant_digits = 3) {
+        significant_digits = std::clamp(significant_digits, 1, 5);
+        uint64_t largest_single_unit = 2 * static_cast<uint64_t>(std::pow(10, significant_digits));
+        int magnitude = 0;
+        while ((1ull << magnitude) < largest_single_unit) {
+            magnitude++;
+        }
+        sub_bucket_half_magnitude_ = magnitude - 1;
+        sub_bucket_count_ = 1ull << magnitude;
+        sub_bucket_half_ = sub_bucket_count_ / 2;
+        sub_bucket_mask_ = sub_bucket_count_ - 1;
+
+        highest_ = std::max<uint64_t>(highest, sub_bucket_count_);
+        int buckets = 1;
+        uint64_t smallest_untrackable = sub_bucket_count_;
+        while (smallest_untrackable <= highest_ && buckets < 64 - magnitude) {
+            smallest_untrackable <<= 1;
+            buckets++;
+        }
+        counts_.assign(static_cast<size_t>(buckets + 1) * sub_bucket_half_, 0);
+    }
+
+    void record(uint64_t value, uint64_t count = 1) {
+        if (value > highest_) {
+            value = highest_;
+            clamped_ += count;
+        }
+        counts_[index_of(value)] += count;
+        total_ += count;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        sum_ += static_cast<double>(value) * count;
+    }
+
+    // Adds another histogram built with the same parameters
+    void merge(const HdrHistogram& other) {
+        if (other.counts_.size() != counts_.size()) return;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        clamped_ += other.clamped_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+    }
+
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        clamped_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+        sum_ = 0;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t clamped() const { return clamped_; }
+    uint64_t min() const { return total_ == 0 ? 0 : min_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ == 0 ? 0.0 : sum_ / total_; }
+
+    // Smallest recorded value that `percentile` percent of values are at or
+    // below, reported as the top of its sub-bucket
+    uint64_t value_at_percentile(double percentile) const {
+        if (total_ == 0) return 0;
+        percentile = std::clamp(percentile, 0.0, 100.0);
+        uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * total_));
+        target = std::max<uint64_t>(target, 1);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= target) {
+                return std::min(highest_equivalent(i), max_);
+            }
+        }
+        return max_;
+    }
+
+private:
+    int sub_bucket_half_magnitude_;
+    uint64_t sub_bucket_count_;
+    uint64_t sub_bucket_half_;
+    uint64_t sub_bucket_mask_;
+    uint64_t highest_;
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t clamped_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+    double sum_ = 0;
+
+    size_t index_of(uint64_t value) const {
+        // Bucket 0 covers 0..sub_bucket_count-1; bucket b covers values whose
+        // highest set bit is b positions above that
+        int pow2_ceiling = 64 - __builtin_clzll(value | sub_bucket_mask_);
+        int bucket = pow2_ceiling - (sub_bucket_half_magnitude_ + 1);
+        uint64_t sub_bucket = value >> bucket;
+        return (static_cast<size_t>(bucket + 1) << sub_bucket_half_magnitude_) +
+               static_cast<size_t>(sub_bucket - sub_bucket_half_);
+    }
+
+    uint64_t highest_equivalent(size_t index) const {
+        int bucket = static_cast<int>(index >> sub_bucket_half_magnitude_) - 1;
+        uint64_t sub_bucket = (index & (sub_bucket_half_ - 1)) + sub_bucket_half_;
+        if (bucket < 0) {
+            sub_bucket -= sub_bucket_half_;
+            bucket = 0;
+        }
+        uint64_t lowest = sub_bucket << bucket;
+        return lowest + (1ull << bucket) - 1;
+    }
+};
+
+#endif // HDR_HISTOGRAM_H
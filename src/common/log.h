@@ -0,0 +1,180 @@
+#ifndef MPOINTERS_LOG_H
+#define MPOINTERS_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Diagnostics for the client library and the server. The lowest level
+// compiled in is fixed at build time (CMake: -DMPOINTERS_LOG_LEVEL=debug);
+// statements below it are still type-checked but generate no code. Enabled
+// statements format their message on the calling thread and hand it to a
+// ring buffer; one writer thread prints Trace to Info to stdout and Warn and
+// Error to stderr, in order. Logging never blocks on the console: when the
+// ring is full the message is dropped and counted. Errors wait until they
+// are written, so they survive a crash right after.
+//
+//     MP_LOG_DEBUG("Node " << id << ": data=" << data);
+
+#define MPOINTERS_LOG_TRACE 0
+#define MPOINTERS_LOG_DEBUG 1
+#define MPOINTERS_LOG_INFO 2
+#define MPOINTERS_LOG_WARN 3
+#define MPOINTERS_LOG_ERROR 4
+#define MPOINTERS_LOG_OFF 5
+
+#ifndef MPOINTERS_LOG_LEVEL
+#define MPOINTERS_LOG_LEVEL MPOINTERS_LOG_INFO
+#endif
+
+namespace mplog {
+
+enum class Level { Trace, Debug, Info, Warn, Error };
+
+constexpr bool compiled_in(Level level) {
+    return static_cast<int>(level) >= MPOINTERS_LOG_LEVEL;
+}
+
+class Logger {
+public:
+    static constexpr size_t kCapacity = 8192;  // Messages in flight
+
+    // Never destroyed, so statics may still log while the program exits;
+    // the ring is flushed at exit
+    static Logger& instance() {
+        static Logger* logger = [] {
+            Logger* created = new Logger();
+            std::atexit([] { instance().flush(); });
+            return created;
+        }();
+        return *logger;
+    }
+
+    void write(Level level, std::string message) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots_[pos & (kCapacity - 1)];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->level = level;
+        slot->text.swap(message);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        if (level == Level::Error) {
+            flush();
+        }
+    }
+
+    // Returns once everything logged before the call is on the console
+    void flush() {
+        size_t target = enqueue_pos_.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(mutex_);
+        flush_requested_ = true;
+        wake_.notify_one();
+        written_cv_.wait(lock, [&] { return written_ >= target; });
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        Level level = Level::Info;
+        std::string text;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> enqueue_pos_{0};
+    size_t dequeue_pos_ = 0;                   // Writer thread only
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable written_cv_;
+    bool flush_requested_ = false;
+    size_t written_ = 0;                       // Guarded by mutex_
+    std::thread writer_;
+
+    Logger() : slots_(new Slot[kCapacity]) {
+        for (size_t i = 0; i < kCapacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writer_ = std::thread(&Logger::run, this);
+        writer_.detach();
+    }
+
+    void run() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait_for(lock, std::chrono::milliseconds(10), [&] { return flush_requested_; });
+                flush_requested_ = false;
+            }
+            size_t done = drain();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                written_ = done;
+            }
+            written_cv_.notify_all();
+        }
+    }
+
+    // Writes every published message; returns the position reached
+    size_t drain() {
+        bool wrote_out = false;
+        bool wrote_err = false;
+        for (;;) {
+            Slot& slot = slots_[dequeue_pos_ & (kCapacity - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) break;
+            if (slot.level >= Level::Warn) {
+                std::cerr << slot.text << '\n';
+                wrote_err = true;
+            } else {
+                std::cout << slot.text << '\n';
+                wrote_out = true;
+            }
+            slot.text.clear();
+            slot.sequence.store(dequeue_pos_ + kCapacity, std::memory_order_release);
+            dequeue_pos_++;
+        }
+        if (wrote_out) std::cout.flush();
+        if (wrote_err) std::cerr.flush();
+        return dequeue_pos_;
+    }
+};
+
+}  // namespace mplog
+
+#define MP_LOG(level, expr)                                                            \
+    do {                                                                               \
+        if constexpr (::mplog::compiled_in(::mplog::Level::level)) {                   \
+            std::ostringstream mp_log_stream_;                                         \
+            mp_log_stream_ << expr;                                                    \
+            ::mplog::Logger::instance().write(::mplog::Level::level, mp_log_stream_.str()); \
+        }                                                                              \
+    } while (0)
+
+#define MP_LOG_TRACE(expr) MP_LOG(Trace, expr)
+#define MP_LOG_DEBUG(expr) MP_LOG(Debug, expr)
+#define MP_LOG_INFO(expr) MP_LOG(Info, expr)
+#define MP_LOG_WARN(expr) MP_LOG(Warn, expr)
+#define MP_LOG_ERROR(expr) MP_LOG(Error, expr)
+
+#endif // MPOINTERS_LOG_H
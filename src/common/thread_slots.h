@@ -0,0 +1,121 @@
+#ifndef THREAD_SLOTS_H
+#define THREAD_SLOTS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One T per thread, owned by one object (stats slabs, trace rings, profiler
+// buffers). A thread finds its slot without locking after the first call.
+// When the thread exits, its slot goes back to a free list and the next new
+// thread takes it over as it is: what the exited thread counted or queued
+// stays in the slot, so readers walking every slot still see it, and there
+// are never more slots than threads alive at once.
+//
+// A slot has one writing thread at a time; the hand-over goes through the
+// list lock, so the next owner sees everything the last one wrote.
+template<typename T>
+class ThreadSlots {
+public:
+    ThreadSlots() : pool_(std::make_shared<Pool>()) {}
+    ThreadSlots(const ThreadSlots&) = delete;
+    ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+    // The calling thread's slot
+    T& local() {
+        thread_local Held cache;  // Last slot used by this thread
+        if (cache.id == pool_->id) {
+            return *cache.slot;
+        }
+        cache = held(registry());
+        return *cache.slot;
+    }
+
+    // Calls f(T&) on every slot, owned or free, under the list lock
+    template<typename F>
+    void for_each(F f) const {
+        std::lock_guard<std::mutex> lock(pool_->mutex);
+        for (const auto& slot : pool_->slots) {
+            f(*slot);
+        }
+    }
+
+    // Slots handed out so far, owned or free
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(pool_->mutex);
+        return pool_->slots.size();
+    }
+
+private:
+    struct Pool {
+        uint64_t id = next_id().fetch_add(1, std::memory_order_relaxed) + 1;
+        std::mutex mutex;  // Guards the lists, not the slots
+        std::vector<std::unique_ptr<T>> slots;
+        std::vector<T*> free;
+    };
+
+    struct Held {
+        uint64_t id = 0;
+        std::weak_ptr<Pool> pool;
+        T* slot = nullptr;
+    };
+
+    // Every slot a thread holds, handed back when the thread exits. Pools
+    // are reached through weak pointers, so an owner may go first.
+    struct Registry {
+        std::vector<Held> held;
+        ~Registry() {
+            for (auto& entry : held) {
+                if (auto pool = entry.pool.lock()) {
+                    std::lock_guard<std::mutex> lock(pool->mutex);
+                    pool->free.push_back(entry.slot);
+                }
+            }
+        }
+    };
+
+    std::shared_ptr<Pool> pool_;
+
+    // Ids rather than addresses tell pools apart: a new owner may reuse
+    // the address of one that is gone
+    static std::atomic<uint64_t>& next_id() {
+        static std::atomic<uint64_t> id{0};
+        return id;
+    }
+
+    static Registry& registry() {
+        thread_local Registry registry;
+        return registry;
+    }
+
+    Held held(Registry& registry) {
+        auto& entries = registry.held;
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [](const Held& entry) { return entry.pool.expired(); }),
+                      entries.end());
+        for (const auto& entry : entries) {
+            if (entry.id == pool_->id) {
+                return entry;
+            }
+        }
+
+        Held entry{pool_->id, pool_, nullptr};
+        {
+            std::lock_guard<std::mutex> lock(pool_->mutex);
+            if (!pool_->free.empty()) {
+                entry.slot = pool_->free.back();
+                pool_->free.pop_back();
+            } else {
+                pool_->slots.push_back(std::make_unique<T>());
+                entry.slot = pool_->slots.back().get();
+            }
+        }
+        entries.push_back(entry);
+        return entry;
+    }
+};
+
+#endif // THREAD_SLOTS_H
@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <grpcpp/grpcpp.h>
+#include "common/hdr_histogram.h"
+#include "mpointers/transport.h"
+
+// Load generator for mem-mgr. Every client thread owns a working set of
+// blocks and issues a weighted mix of Create/Set/Get/IncreaseRefCount/
+// DecreaseRefCount against it, over a fixed number of channels (one HTTP/2
+// connection each). Closed loop: each thread sends its next request as soon
+// as the previous one returns. Open loop: requests are scheduled as a Poisson
+// process at --rate and latency is measured from the scheduled time, so a
+// slow server is not hidden by the client backing off.
+
+using Clock = std::chrono::steady_clock;
+
+enum Op { CREATE, SET, GET, INCREF, DECREF, OP_COUNT };
+static const char* kOpNames[OP_COUNT] = {"create", "set", "get", "incref", "decref"};
+
+struct LoadOptions {
+    std::string address = "localhost:50051";
+    size_t threads = 1;
+    size_t channels = 1;
+    double duration = 10;  // Seconds measured
+    double warmup = 1;     // Seconds run before measuring
+    double rate = 0;       // Total requests per second, 0 for closed loop
+    size_t keys = 1000;    // Blocks per thread
+    size_t min_size = 8;
+    size_t max_size = 8;
+    double mix[OP_COUNT] = {5, 30, 55, 5, 5};
+    bool csv = false;
+    bool csv_header = true;  // Off for every run after the first of a series
+};
+
+struct ThreadResult {
+    std::vector<HdrHistogram> latency = std::vector<HdrHistogram>(OP_COUNT);
+    uint64_t errors[OP_COUNT] = {};
+};
+
+void print_usage() {
+    std::cout << "Usage: ./mem-mgr-load [--server HOST:PORT] [--threads N] [--channels N]"
+              << " [--duration SECONDS] [--warmup SECONDS] [--rate OPS_PER_SEC] [--keys N]"
+              << " [--mix create:W,set:W,get:W,incref:W,decref:W] [--valueSize BYTES|MIN-MAX]"
+              << " [--format text|csv] [--csvHeader on|off]" << std::endl;
+}
+
+static bool parse_mix(const std::string& text, double* mix) {
+    std::fill(mix, mix + OP_COUNT, 0.0);
+    std::stringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) return false;
+        std::string name = item.substr(0, colon);
+        auto op = std::find_if(kOpNames, kOpNames + OP_COUNT,
+                               [&name](const char* op_name) { return name == op_name; });
+        if (op == kOpNames + OP_COUNT) return false;
+        mix[op - kOpNames] = std::stod(item.substr(colon + 1));
+    }
+    double total = 0;
+    for (int i = 0; i < OP_COUNT; ++i) {
+        if (mix[i] < 0) return false;
+        total += mix[i];
+    }
+    return total > 0;
+}
+
+static bool parse_size(const std::string& text, size_t& min_size, size_t& max_size) {
+    size_t dash = text.find('-');
+    min_size = std::stoull(text.substr(0, dash));
+    max_size = dash == std::string::npos ? min_size : std::stoull(text.substr(dash + 1));
+    return min_size > 0 && min_size <= max_size;
+}
+
+// One client thread's blocks and the requests it owes the server
+class Worker {
+public:
+    Worker(size_t index, const LoadOptions& options, std::shared_ptr<Transport> transport)
+        : options_(options), transport_(std::move(transport)), rng_(index + 1),
+          ops_(options.mix, options.mix + OP_COUNT),
+          log_min_(std::log(static_cast<double>(options.min_size))),
+          log_max_(std::log(static_cast<double>(options.max_size) + 1)) {}
+
+    // Creates the working set; not measured
+    bool populate() {
+        for (size_t i = 0; i < options_.keys; ++i) {
+            uint64_t id = 0;
+            size_t size = next_size();
+            if (!create(size, id)) return false;
+            ids_.push_back(id);
+            sizes_.push_back(size);
+            extra_.push_back(0);
+        }
+        return true;
+    }
+
+    void run(const std::atomic<bool>& go, Clock::time_point measure_from, Clock::time_point until,
+             ThreadResult& result) {
+        while (!go.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+
+        double per_thread_rate = options_.rate / options_.threads;
+        std::exponential_distribution<double> gap(per_thread_rate > 0 ? per_thread_rate : 1);
+        Clock::time_point scheduled = Clock::now();
+
+        while (true) {
+            Clock::time_point start;
+            if (per_thread_rate > 0) {
+                scheduled += std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(gap(rng_)));
+                if (scheduled >= until) break;
+                std::this_thread::sleep_until(scheduled);
+                start = scheduled;
+            } else {
+                start = Clock::now();
+                if (start >= until) break;
+            }
+
+            Op op = static_cast<Op>(ops_(rng_));
+            bool ok = execute(op);
+            Clock::time_point end = Clock::now();
+
+            if (start >= measure_from) {
+                auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+                result.latency[op].record(static_cast<uint64_t>(std::max<int64_t>(nanos, 1)));
+                if (!ok) result.errors[op]++;
+            }
+        }
+    }
+
+    // Drops every reference this worker still holds
+    void release_all() {
+        for (size_t slot = 0; slot < ids_.size(); ++slot) {
+            release(ids_[slot], 1 + extra_[slot]);
+        }
+        flush_releases();
+    }
+
+private:
+    static constexpr size_t kReleaseBatch = 64;
+
+    const LoadOptions& options_;
+    std::shared_ptr<Transport> transport_;
+    std::mt19937_64 rng_;
+    std::discrete_distribution<int> ops_;
+    double log_min_;
+    double log_max_;
+
+    std::vector<uint64_t> ids_;
+    std::vector<size_t> sizes_;
+    std::vector<uint32_t> extra_;   // References taken by incref, per slot
+    std::vector<size_t> borrowed_;  // Slots with extra references (may be stale)
+    std::vector<uint64_t> releases_;
+    std::string buffer_;
+
+    // Log-uniform, so small values are as common as in real workloads
+    size_t next_size() {
+        if (options_.min_size == options_.max_size) return options_.min_size;
+        std::uniform_real_distribution<double> dist(log_min_, log_max_);
+        size_t size = static_cast<size_t>(std::exp(dist(rng_)));
+        return std::clamp(size, options_.min_size, options_.max_size);
+    }
+
+    size_t next_slot() {
+        return std::uniform_int_distribution<size_t>(0, ids_.size() - 1)(rng_);
+    }
+
+    bool create(size_t size, uint64_t& id) {
+        memory_service::CreateRequest request;
+        memory_service::CreateResponse response;
+        request.set_size(size);
+        request.set_type(memory_service::CHAR);
+        if (!transport_->Create(request, &response).ok() || !response.success()) return false;
+        id = response.id();
+        return true;
+    }
+
+    // Runs `op`, updating it to the operation actually sent
+    bool execute(Op& op) {
+        size_t slot = next_slot();
+        switch (op) {
+            case CREATE: {
+                // The new block replaces one of the working set
+                uint64_t id = 0;
+                size_t size = next_size();
+                if (!create(size, id)) return false;
+                release(ids_[slot], 1 + extra_[slot]);
+                ids_[slot] = id;
+                sizes_[slot] = size;
+                extra_[slot] = 0;
+                return true;
+            }
+            case SET: {
+                memory_service::SetRequest request;
+                memory_service::SetResponse response;
+                buffer_.assign(sizes_[slot], static_cast<char>(slot));
+                request.set_id(ids_[slot]);
+                request.set_value(buffer_);
+                return transport_->Set(request, &response).ok() && response.success();
+            }
+            case GET: {
+                memory_service::GetRequest request;
+                memory_service::GetResponse response;
+                request.set_id(ids_[slot]);
+                return transport_->Get(request, &response).ok() && response.success();
+            }
+            case DECREF: {
+                // Only references this worker took itself are dropped; with
+                // none outstanding the operation becomes an incref
+                while (!borrowed_.empty()) {
+                    size_t candidate = borrowed_.back();
+                    borrowed_.pop_back();
+                    if (extra_[candidate] > 0) {
+                        memory_service::RefCountRequest request;
+                        memory_service::RefCountResponse response;
+                        request.set_id(ids_[candidate]);
+                        extra_[candidate]--;
+                        return transport_->DecreaseRefCount(request, &response).ok() && response.success();
+                    }
+                }
+                op = INCREF;
+                [[fallthrough]];
+            }
+            case INCREF: {
+                memory_service::RefCountRequest request;
+                memory_service::RefCountResponse response;
+                request.set_id(ids_[slot]);
+                extra_[slot]++;
+                borrowed_.push_back(slot);
+                return transport_->IncreaseRefCount(request, &response).ok() && response.success();
+            }
+            default:
+                return false;
+        }
+    }
+
+    void release(uint64_t id, uint32_t references) {
+        releases_.insert(releases_.end(), references, id);
+        if (releases_.size() >= kReleaseBatch) {
+            flush_releases();
+        }
+    }
+
+    void flush_releases() {
+        if (releases_.empty()) return;
+        memory_service::RefCountBatchRequest request;
+        memory_service::RefCountBatchResponse response;
+        for (uint64_t id : releases_) {
+            request.add_decrease_ids(id);
+        }
+        transport_->UpdateRefCounts(request, &response);
+        releases_.clear();
+    }
+};
+
+static double to_us(uint64_t nanos) {
+    return nanos / 1000.0;
+}
+
+static void report(const LoadOptions& options, const ThreadResult& total) {
+    HdrHistogram all;
+    uint64_t all_errors = 0;
+    for (int op = 0; op < OP_COUNT; ++op) {
+        all.merge(total.latency[op]);
+        all_errors += total.errors[op];
+    }
+
+    auto row = [&](std::ostream& out, const std::string& name, const HdrHistogram& h, uint64_t errors) {
+        double throughput = h.count() / options.duration;
+        if (options.csv) {
+            out << options.threads << ',' << options.channels << ',' << options.rate << ',' << name << ','
+                << h.count() << ',' << errors << ',' << throughput << ','
+                << to_us(h.value_at_percentile(50)) << ',' << to_us(h.value_at_percentile(99)) << ','
+                << to_us(h.value_at_percentile(99.9)) << ',' << to_us(h.max()) << '\n';
+            return;
+        }
+        out << std::left << std::setw(8) << name << std::right
+            << std::setw(12) << h.count() << std::setw(8) << errors
+            << std::setw(12) << std::fixed << std::setprecision(0) << throughput
+            << std::setw(10) << std::setprecision(1) << to_us(h.value_at_percentile(50))
+            << std::setw(10) << to_us(h.value_at_percentile(99))
+            << std::setw(10) << to_us(h.value_at_percentile(99.9))
+            << std::setw(10) << to_us(h.max()) << '\n';
+    };
+
+    if (options.csv) {
+        if (options.csv_header) {
+            std::cout << "threads,channels,target_rate,op,count,errors,ops_per_sec,p50_us,p99_us,p999_us,max_us\n";
+        }
+    } else {
+        std::cout << options.threads << " threads, " << options.channels << " channels, "
+                  << (options.rate > 0 ? "open loop at " + std::to_string(static_cast<long long>(options.rate)) + " ops/s"
+                                       : std::string("closed loop"))
+                  << ", " << options.duration << " s\n";
+        std::cout << std::left << std::setw(8) << "op" << std::right
+                  << std::setw(12) << "count" << std::setw(8) << "errors" << std::setw(12) << "ops/s"
+                  << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+                  << std::setw(10) << "p999 us" << std::setw(10) << "max us" << '\n';
+    }
+    for (int op = 0; op < OP_COUNT; ++op) {
+        if (total.latency[op].count() > 0) {
+            row(std::cout, kOpNames[op], total.latency[op], total.errors[op]);
+        }
+    }
+    row(std::cout, "all", all, all_errors);
+    std::cout.flush();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc % 2 == 0) {
+        print_usage();
+        return 1;
+    }
+
+    LoadOptions options;
+    try {
+        for (int i = 1; i < argc; i += 2) {
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if (arg == "--server") {
+                options.address = value;
+            } else if (arg == "--threads") {
+                options.threads = std::stoull(value);
+            } else if (arg == "--channels") {
+                options.channels = std::stoull(value);
+            } else if (arg == "--duration") {
+                options.duration = std::stod(value);
+            } else if (arg == "--warmup") {
+                options.warmup = std::stod(value);
+            } else if (arg == "--rate") {
+                options.rate = std::stod(value);
+            } else if (arg == "--keys") {
+                options.keys = std::stoull(value);
+            } else if (arg == "--mix") {
+                if (!parse_mix(value, options.mix)) throw std::invalid_argument(value);
+            } else if (arg == "--valueSize") {
+                if (!parse_size(value, options.min_size, options.max_size)) throw std::invalid_argument(value);
+            } else if (arg == "--format") {
+                options.csv = value == "csv";
+            } else if (arg == "--csvHeader") {
+                if (value != "on" && value != "off") throw std::invalid_argument(value);
+                options.csv_header = value == "on";
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        print_usage();
+        return 1;
+    }
+    if (options.threads == 0 || options.channels == 0 || options.keys == 0 || options.duration <= 0) {
+        print_usage();
+        return 1;
+    }
+
+    // Threads share the channels round-robin
+    std::vector<std::shared_ptr<Transport>> transports;
+    for (size_t i = 0; i < options.channels; ++i) {
+        grpc::ChannelArguments args;
+        args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+        auto channel = grpc::CreateCustomChannel(options.address, grpc::InsecureChannelCredentials(), args);
+        transports.push_back(std::make_shared<GrpcTransport>(channel, std::chrono::seconds(5)));
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (size_t i = 0; i < options.threads; ++i) {
+        workers.push_back(std::make_unique<Worker>(i, options, transports[i % transports.size()]));
+    }
+    for (auto& worker : workers) {
+        if (!worker->populate()) {
+            std::cerr << "Failed to create the working set on " << options.address << std::endl;
+            return 1;
+        }
+    }
+
+    std::atomic<bool> go{false};
+    Clock::time_point measure_from = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.warmup + 0.01));
+    Clock::time_point until = measure_from + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.duration));
+
+    std::vector<ThreadResult> results(options.threads);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < options.threads; ++i) {
+        threads.emplace_back([&, i] { workers[i]->run(go, measure_from, until, results[i]); });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ThreadResult total;
+    for (const auto& result : results) {
+        for (int op = 0; op < OP_COUNT; ++op) {
+            total.latency[op].merge(result.latency[op]);
+            total.errors[op] += result.errors[op];
+        }
+    }
+    report(options, total);
+
+    for (auto& worker : workers) {
+        worker->release_all();
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "alloc_trace.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr auto kDrainInterval = std::chrono::milliseconds(20);
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t eventSize;
+    uint32_t reserved;
+};
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+}  // namespace
+
+AllocTrace::~AllocTrace() {
+    stop();
+}
+
+bool AllocTrace::start(const std::string& path) {
+    stop();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) return false;
+
+    TraceHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.eventSize = sizeof(TraceEvent);
+    if (!writeAll(fd_, reinterpret_cast<const char*>(&header), sizeof(header))) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    origin_ = std::chrono::steady_clock::now();
+    nextSequence_.store(0, std::memory_order_relaxed);
+    stopping_ = false;
+    writer_ = std::thread(&AllocTrace::writeLoop, this);
+    active_.store(true, std::memory_order_release);
+    return true;
+}
+
+void AllocTrace::stop() {
+    active_.store(false, std::memory_order_release);
+    if (writer_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(writerMutex_);
+            stopping_ = true;
+        }
+        writerCv_.notify_all();
+        writer_.join();
+    }
+    if (fd_ >= 0) {
+        drain();
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void AllocTrace::append(TraceEvent::Kind kind, uint32_t id, uint64_t size, uint32_t arg, uint8_t type) {
+    Ring& ring = rings_.local();
+    uint64_t sequence = nextSequence_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) == Ring::kCapacity) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    TraceEvent& event = ring.events[head % Ring::kCapacity];
+    event.sequence = sequence;
+    event.timeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - origin_).count());
+    event.size = size;
+    event.id = id;
+    event.arg = arg;
+    event.kind = kind;
+    event.type = type;
+    std::memset(event.reserved, 0, sizeof(event.reserved));
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t AllocTrace::dropped() const {
+    uint64_t total = 0;
+    rings_.for_each([&](const Ring& ring) { total += ring.dropped.load(std::memory_order_relaxed); });
+    return total;
+}
+
+void AllocTrace::writeLoop() {
+    std::unique_lock<std::mutex> lock(writerMutex_);
+    while (!stopping_) {
+        writerCv_.wait_for(lock, kDrainInterval, [this] { return stopping_; });
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void AllocTrace::drain() {
+    // Rings live as long as the trace, so they can be drained outside the lock
+    std::vector<Ring*> snapshot;
+    rings_.for_each([&](Ring& ring) { snapshot.push_back(&ring); });
+    for (Ring* ring : snapshot) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        // At most two contiguous runs: up to the end of the array, then from its start
+        while (tail < head) {
+            size_t start = tail % Ring::kCapacity;
+            size_t count = std::min<uint64_t>(head - tail, Ring::kCapacity - start);
+            if (!writeAll(fd_, reinterpret_cast<const char*>(&ring->events[start]), count * sizeof(TraceEvent))) {
+                return;
+            }
+            tail += count;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+}
+
+bool AllocTrace::load(const std::string& path, std::vector<TraceEvent>& events, uint64_t& missing,
+                      std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    TraceHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kMagic, sizeof(header.magic)) != 0 || header.eventSize != sizeof(TraceEvent)) {
+        error = path + " is not an allocation trace";
+        return false;
+    }
+
+    events.clear();
+    TraceEvent event;
+    while (file.read(reinterpret_cast<char*>(&event), sizeof(event))) {
+        events.push_back(event);
+    }
+    std::sort(events.begin(), events.end(),
+              [](const TraceEvent& a, const TraceEvent& b) { return a.sequence < b.sequence; });
+
+    // Sequence numbers are dense, so any gap is a dropped event
+    missing = events.empty() ? 0 : events.back().sequence + 1 - events.size();
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/thread_slots.h"
+
+// One allocator event. Every field has a fixed width so a trace file is a
+// plain array of these after its header.
+struct TraceEvent {
+    enum Kind : uint8_t {
+        Create = 1,      // id, size, type, arg = region (0 for none)
+        RefCount,        // id, arg = new reference count
+        Free,            // id
+        Defragment,
+        RegionCreate,    // id = region, size = chunk size
+        RegionDestroy,   // id = region; its members' Free events follow
+    };
+
+    uint64_t sequence;   // Global order of events
+    uint64_t timeNs;     // Since the trace started
+    uint64_t size;
+    uint32_t id;
+    uint32_t arg;
+    uint8_t kind;
+    uint8_t type;        // memory_service::DataType of a created block
+    uint8_t reserved[6];
+};
+static_assert(sizeof(TraceEvent) == 40, "trace file layout");
+
+// Opt-in binary trace of allocator events (mem-mgr --trace FILE), for
+// replaying real allocation sequences with mem-replay. Each recording
+// thread appends to its own single-producer ring without locking; a writer
+// thread drains the rings to the file every few milliseconds. Events are
+// numbered from one atomic counter, and the reader sorts by that number.
+// A full ring drops events rather than stall the server; the reader
+// reports the gaps.
+class AllocTrace {
+public:
+    static constexpr char kMagic[8] = {'M', 'P', 'T', 'R', 'A', 'C', 'E', '1'};
+
+    ~AllocTrace();
+
+    // Truncates `path` and starts recording; false if it cannot be opened
+    bool start(const std::string& path);
+    // Writes everything recorded so far and closes the file; callers make
+    // sure no thread is still inside record()
+    void stop();
+
+    bool enabled() const { return active_.load(std::memory_order_relaxed); }
+    void record(TraceEvent::Kind kind, uint32_t id, uint64_t size = 0, uint32_t arg = 0, uint8_t type = 0) {
+        if (enabled()) append(kind, id, size, arg, type);
+    }
+
+    uint64_t dropped() const;
+
+    // Reads a whole trace in sequence order; `missing` counts events the
+    // server dropped. A torn last event is ignored.
+    static bool load(const std::string& path, std::vector<TraceEvent>& events, uint64_t& missing,
+                     std::string& error);
+
+private:
+    struct Ring {
+        static constexpr size_t kCapacity = 8192;
+        TraceEvent events[kCapacity];
+        std::atomic<uint64_t> head{0};     // Written by the owning thread
+        std::atomic<uint64_t> tail{0};     // Written by the drain
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    std::atomic<bool> active_{false};
+    std::atomic<uint64_t> nextSequence_{0};
+    std::chrono::steady_clock::time_point origin_;
+
+    ThreadSlots<Ring> rings_;              // A new thread reuses an exited one's ring
+
+    std::mutex writerMutex_;
+    std::condition_variable writerCv_;
+    bool stopping_ = false;
+    std::thread writer_;
+    int fd_ = -1;
+
+    void append(TraceEvent::Kind kind, uint32_t id, uint64_t size, uint32_t arg, uint8_t type);
+    void writeLoop();
+    void drain();
+};
@@ -1,15 +1,24 @@
+#include <algorithm>
+#include <csignal>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <grpcpp/grpcpp.h>
+#include "common/log.h"
 #include "memory_manager.h"
 #include "memory_service.grpc.pb.h"
 
 void print_usage() {
-    std::cout << "Usage: ./mem-mgr --port LISTEN_PORT --memsize SIZE_MB --dumpFolder DUMP_FOLDER" << std::endl;
+    std::cout << "Usage: ./mem-mgr --port LISTEN_PORT --memsize SIZE_MB --dumpFolder DUMP_FOLDER"
+              << " [--replicaOf PRIMARY_HOST:PORT]"
+              << " [--walCommitUs MICROSECONDS] [--walCommitKB KB] [--checkpointSec SECONDS]"
+              << " [--spillMB SIZE_MB] [--segmentMB SIZE_MB] [--dumps on|off] [--trace FILE]"
+              << " [--metricsPort PORT] [--profile FILE] [--profileSlowest N]" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 7) {
+    // Flags come in pairs; the first three are required
+    if (argc < 7 || argc % 2 == 0) {
         print_usage();
         return 1;
     }
@@ -17,6 +26,15 @@ int main(int argc, char* argv[]) {
     std::string port;
     size_t memsize = 0;
     std::string dump_folder;
+    std::string replica_of;
+    WalOptions wal_options;
+    size_t spill_size = 0;
+    size_t segment_size = MemoryManager::kDefaultSegmentSize;
+    bool dumps = true;
+    std::string trace_path;
+    int metrics_port = 0;
+    std::string profile_path;
+    size_t profile_slowest = RequestProfiler::kDefaultSlowest;
 
     // Parse command line arguments
     for (int i = 1; i < argc; i += 2) {
@@ -27,6 +45,30 @@ int main(int argc, char* argv[]) {
             memsize = std::stoull(argv[i + 1]) * 1024 * 1024; // Convert MB to bytes
         } else if (arg == "--dumpFolder") {
             dump_folder = argv[i + 1];
+        } else if (arg == "--replicaOf") {
+            replica_of = argv[i + 1];
+        } else if (arg == "--walCommitUs") {
+            // Enables the write-ahead log
+            wal_options.enabled = true;
+            wal_options.commitWindow = std::chrono::microseconds(std::stoll(argv[i + 1]));
+        } else if (arg == "--walCommitKB") {
+            wal_options.commitBytes = std::stoull(argv[i + 1]) * 1024;
+        } else if (arg == "--checkpointSec") {
+            wal_options.checkpointInterval = std::chrono::seconds(std::stoll(argv[i + 1]));
+        } else if (arg == "--spillMB") {
+            spill_size = std::stoull(argv[i + 1]) * 1024 * 1024;
+        } else if (arg == "--segmentMB") {
+            segment_size = std::stoull(argv[i + 1]) * 1024 * 1024;
+        } else if (arg == "--dumps") {
+            dumps = std::string(argv[i + 1]) != "off";
+        } else if (arg == "--trace") {
+            trace_path = argv[i + 1];
+        } else if (arg == "--metricsPort") {
+            metrics_port = std::stoi(argv[i + 1]);
+        } else if (arg == "--profile") {
+            profile_path = argv[i + 1];
+        } else if (arg == "--profileSlowest") {
+            profile_slowest = std::stoull(argv[i + 1]);
         } else {
             print_usage();
             return 1;
@@ -38,18 +80,36 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // SIGINT and SIGTERM shut the server down cleanly so the trace and the
+    // profile get written. Blocked here, before any thread starts, so only
+    // the waiter below ever receives them.
+    sigset_t shutdown_signals;
+    sigemptyset(&shutdown_signals);
+    sigaddset(&shutdown_signals, SIGINT);
+    sigaddset(&shutdown_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &shutdown_signals, nullptr);
+
     try {
-        std::cout << "Creating Memory Manager instance..." << std::endl;
+        MP_LOG_INFO("Creating Memory Manager instance...");
         // Get Memory Manager instance
         auto manager = MemoryManager::getInstance();
         
         // Initialize memory manager
-        if (!manager->initialize(std::stoi(port), memsize, dump_folder)) {
-            std::cerr << "Failed to initialize memory manager" << std::endl;
+        if (!manager->initialize(std::stoi(port), memsize, dump_folder, wal_options, spill_size, segment_size)) {
+            MP_LOG_ERROR("Failed to initialize memory manager");
+            return 1;
+        }
+        manager->setDumps(dumps);
+        if (!trace_path.empty() && !manager->startTrace(trace_path)) {
+            MP_LOG_ERROR("Failed to open trace file " << trace_path);
+            return 1;
+        }
+        if (!profile_path.empty() && !manager->startProfile(profile_path, profile_slowest)) {
+            MP_LOG_ERROR("Failed to open profile file " << profile_path);
             return 1;
         }
 
-        std::cout << "Setting up gRPC server..." << std::endl;
+        MP_LOG_INFO("Setting up gRPC server...");
         // Create gRPC server
         grpc::ServerBuilder builder;
         
@@ -62,27 +122,52 @@ int main(int argc, char* argv[]) {
         builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
         builder.RegisterService(manager);
 
-        std::cout << "Starting server..." << std::endl;
+        MP_LOG_INFO("Starting server...");
         std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
         if (!server) {
-            std::cerr << "Failed to start server" << std::endl;
+            MP_LOG_ERROR("Failed to start server");
             return 1;
         }
         
         // Store server in memory manager
         manager->setServer(std::move(server));
         
-        std::cout << "Memory Manager server listening on " << server_address << std::endl;
-        std::cout << "Memory size: " << (memsize / (1024 * 1024)) << " MB" << std::endl;
-        std::cout << "Dump folder: " << dump_folder << std::endl;
+        MP_LOG_INFO("Memory Manager server listening on " << server_address);
+        MP_LOG_INFO("Memory size: up to " << (memsize / (1024 * 1024)) << " MB in "
+                 << (std::min(segment_size, memsize) / 1024) << " KB segments");
+        if (spill_size > 0) {
+            MP_LOG_INFO("Spill size: " << (spill_size / (1024 * 1024)) << " MB");
+        }
+        MP_LOG_INFO("Dump folder: " << dump_folder);
+        if (metrics_port > 0) {
+            if (!manager->startMetrics(static_cast<uint16_t>(metrics_port))) {
+                MP_LOG_ERROR("Failed to listen for metrics on port " << metrics_port);
+                return 1;
+            }
+            MP_LOG_INFO("Metrics: http://localhost:" << metrics_port << "/metrics");
+        }
 
         // Start garbage collector
         manager->start();
+
+        // A backup mirrors its primary and serves reads only
+        if (!replica_of.empty()) {
+            MP_LOG_INFO("Replicating from: " << replica_of);
+            manager->startReplica(replica_of);
+        }
         
+        std::thread signal_waiter([manager, shutdown_signals]() {
+            int signal = 0;
+            sigwait(&shutdown_signals, &signal);
+            MP_LOG_INFO("Shutting down...");
+            manager->stop();
+        });
+
         // Wait for the server to shutdown
         manager->waitForServer();
+        signal_waiter.join();
     } catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
+        MP_LOG_ERROR("Error: " << e.what());
         return 1;
     }
 
@@ -1,10 +1,13 @@
 #include "memory_manager.h"
+#include "simd_kernels.h"
+#include "common/log.h"
+#include <cmath>
 #include <cstring>
 #include <iomanip>
-#include <iostream>
 #include <algorithm>
 #include <sstream>
 #include <filesystem>
+#include <type_traits>
 
 // Initialize static instance
 MemoryManager* MemoryManager::instance = nullptr;
@@ -16,15 +19,59 @@ MemoryManager* MemoryManager::getInstance() {
     return instance;
 }
 
-bool MemoryManager::initialize(uint16_t port, size_t memSize, const std::string& dumpFolder) {
+// Highest WAL sequence this thread appended and has not yet waited for
+static thread_local uint64_t pendingWalSequence = 0;
+
+bool MemoryManager::initialize(uint16_t port, size_t memSize, const std::string& dumpFolder,
+                               const WalOptions& walOptions, size_t spillSize, size_t segmentSize) {
     totalSize = memSize;
-    memoryBlock = malloc(memSize);
-    if (!memoryBlock) return false;
+    this->segmentSize = std::min(std::max<size_t>(segmentSize, 1), memSize);
+    resetArena();
+    // The first segment is committed up front; the rest as blocks need it
+    uint32_t first;
+    if (!addSegment(this->segmentSize, first)) return false;
     
     dumpFolderPath = dumpFolder;
     std::filesystem::create_directories(dumpFolderPath);
     
-    nextBlockId = 0;
+    nextBlockId = 1;  // Id 0 is the null MPointer
+    clearBlocks();
+    usage.clear();
+    layouts.clear();
+    shardTag = 0;
+    abortTrace();
+    reservations.clear();
+    sessions.clear();
+    regions.clear();
+    nextRegionId = 1;
+    spill.reset();
+    if (spillSize > 0) {
+        spill = std::make_unique<SpillFile>(dumpFolderPath + "/spill.bin", spillSize);
+        if (!spill->isOpen()) return false;
+    }
+    
+    // Rebuild the logged state before serving anything
+    if (walOptions.enabled) {
+        wal = std::make_unique<WriteAheadLog>(dumpFolderPath + "/wal", walOptions.commitWindow,
+                                              walOptions.commitBytes);
+        checkpointInterval = walOptions.checkpointInterval;
+        lastCheckpoint = std::chrono::steady_clock::now();
+        {
+            ProfiledLock lock(mutex, profiler, __func__);
+            uint64_t sequence = wal->replay([this](const memory_service::MutationRecord& record) {
+                applyMutation(record);
+            });
+            size_t live = 0;
+            for (uint64_t word : usedBits) {
+                live += __builtin_popcountll(word);
+            }
+            MP_LOG_INFO("WAL: recovered " << live << " blocks up to sequence " << sequence);
+            if (live > 0) {
+                dumpMemoryState();
+            }
+        }
+        if (!wal->start()) return false;
+    }
     
     // Initialize GC
     gc = std::make_unique<GarbageCollector>(this);
@@ -40,7 +87,7 @@ void MemoryManager::waitForServer() {
     if (server) {
         server->Wait();
     } else {
-        std::cerr << "Error: Server is not initialized\n";
+        MP_LOG_ERROR("Error: Server is not initialized");
     }
 }
 
@@ -48,146 +95,1955 @@ void MemoryManager::start() {
     gc->start();
 }
 
-void MemoryManager::stop() {
-    gc->stop();
-    if (server) {
-        server->Shutdown();
+void MemoryManager::stop() {
+    stopFollowing();
+    // Ends open Replicate streams so the server can shut down
+    replicationLog.close();
+    gc->stop();
+    if (server) {
+        server->Shutdown();
+    }
+    // After the server, so no request is left waiting on a flush
+    if (wal) {
+        wal->stop();
+    }
+    stopTrace();
+    stopProfile();
+    if (metrics) {
+        metrics->stop();
+    }
+}
+
+MemoryManager::~MemoryManager() {
+    stop();
+    resetArena();
+}
+
+uint32_t MemoryManager::createBlock(size_t size, const std::string& type, uint32_t layoutId, uint64_t session,
+                                   uint32_t region, size_t alignment) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    uint32_t id;
+    {
+        ProfiledPhase phase(profiler, "allocate");
+        id = createBlockLocked(size, type, layoutId, region, session, alignment);
+    }
+    if (id != static_cast<uint32_t>(-1)) {
+        trackReference(session, id, +1);
+        dumpMemoryState();
+    }
+    return id;
+}
+
+uint32_t MemoryManager::createBlockLocked(size_t size, const std::string& type, uint32_t layoutId, uint32_t region,
+                                          uint64_t session, size_t alignment) {
+    if (!validAlignment(alignment)) return -1;
+    alignment = std::max<size_t>(alignment, 1);
+    // Every link field of the layout has to fit
+    if (layoutId != 0) {
+        auto layout = layouts.find(layoutId);
+        if (layout == layouts.end() || size < layout->second.size) return -1;
+    }
+    Region* owner = nullptr;
+    if (region != 0) {
+        auto it = regions.find(region);
+        if (it == regions.end()) return -1;
+        owner = &it->second;
+    }
+    
+    // First fit in a freed hole, otherwise at the top of a segment; region
+    // blocks bump-allocate inside the region's current chunk
+    uint32_t segment;
+    size_t offset = owner ? regionOffset(*owner, size, alignment, segment) : allocateOffset(size, alignment, segment);
+    if (offset == kNoSpace) {
+        // No space available
+        return -1;
+    }
+    
+    MemoryBlock newBlock{
+        nextBlockId++,
+        segment,
+        size,
+        offset
+    };
+    newBlock.type = blockType(type);
+    newBlock.alignment = static_cast<uint16_t>(alignment);
+    newBlock.layout = layoutId;
+    newBlock.region = region;
+    newBlock.owner = session;
+    const MemoryBlock& added = addBlock(newBlock, 1);  // Initial ref count
+    if (owner) {
+        owner->blocks.push_back(added.id);
+    }
+    logBlock(added);
+    return added.id;
+}
+
+MemoryManager::MemoryBlock& MemoryManager::addBlock(const MemoryBlock& block, uint32_t refs) {
+    blockIndex[block.id] = blocks.size();
+    blocks.push_back(block);
+    refCounts.push_back(refs);
+    if (blocks.size() > usedBits.size() * 64) {
+        usedBits.push_back(0);
+    }
+    setUsed(blocks.size() - 1, true);
+    accountBlock(block, +1);
+    // Blocks born during a collection survive it
+    shade(block.id);
+    if (allocTrace.enabled()) {
+        traceCreate(block);
+    }
+    return blocks.back();
+}
+
+void MemoryManager::setUsed(size_t slot, bool used) {
+    uint64_t bit = uint64_t(1) << (slot % 64);
+    if (used) {
+        usedBits[slot / 64] |= bit;
+    } else {
+        usedBits[slot / 64] &= ~bit;
+    }
+}
+
+void MemoryManager::clearBlocks() {
+    // Storage goes too: clearing an index sized for a larger table walks
+    // all of its buckets
+    blocks = std::vector<MemoryBlock>();
+    refCounts = std::vector<uint32_t>();
+    usedBits = std::vector<uint64_t>();
+    blockIndex = std::unordered_map<uint32_t, size_t>();
+}
+
+uint8_t MemoryManager::blockType(const std::string& name) {
+    memory_service::DataType type = memory_service::CUSTOM;
+    memory_service::DataType_Parse(name, &type);
+    return static_cast<uint8_t>(type);
+}
+
+const std::string& MemoryManager::blockTypeName(uint8_t type) {
+    return memory_service::DataType_Name(static_cast<memory_service::DataType>(type));
+}
+
+void MemoryManager::accountBlock(const MemoryBlock& block, int delta) {
+    Usage& tag = usage[block.owner][block.type];
+    if (delta > 0) {
+        if (tag.baseTime == std::chrono::steady_clock::time_point()) {
+            tag.baseTime = tag.pendingTime = std::chrono::steady_clock::now();
+        }
+        tag.blocks++;
+        tag.bytes += block.size;
+        tag.allocatedBytes += block.size;
+    } else {
+        tag.blocks--;
+        tag.bytes -= block.size;
+        tag.freedBytes += block.size;
+    }
+}
+
+void MemoryManager::rollUsage(std::chrono::steady_clock::time_point now) {
+    // Called with mutex held, by the GC about once a second
+    if (now - lastUsageRoll < std::chrono::seconds(1)) return;
+    lastUsageRoll = now;
+    for (auto session = usage.begin(); session != usage.end();) {
+        auto& types = session->second;
+        for (auto it = types.begin(); it != types.end();) {
+            Usage& tag = it->second;
+            if (now - tag.pendingTime >= kUsageWindow) {
+                tag.baseBytes = tag.pendingBytes;
+                tag.baseTime = tag.pendingTime;
+                tag.pendingBytes = tag.bytes;
+                tag.pendingTime = now;
+            }
+            // Gone, and no longer shrinking either
+            if (tag.blocks == 0 && tag.baseBytes == 0 && tag.pendingBytes == 0) {
+                it = types.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        session = types.empty() ? usage.erase(session) : std::next(session);
+    }
+}
+
+void MemoryManager::collectUsage(const memory_service::GetUsageRequest& request,
+                                 memory_service::GetUsageResponse& response) {
+    struct Group {
+        uint64_t session = 0;
+        std::string type;
+        uint64_t blocks = 0;
+        uint64_t bytes = 0;
+        uint64_t allocatedBytes = 0;
+        uint64_t freedBytes = 0;
+        double growth = 0.0;
+    };
+    std::map<std::pair<uint64_t, std::string>, Group> groups;
+    uint64_t totalBlocks = 0;
+    uint64_t totalBytes = 0;
+    {
+        ProfiledLock lock(mutex, profiler, __func__);
+        
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& session : usage) {
+            for (const auto& entry : session.second) {
+                const Usage& tag = entry.second;
+                uint64_t sessionKey = request.group_by() == memory_service::USAGE_BY_TYPE ? 0 : session.first;
+                std::string typeKey =
+                    request.group_by() == memory_service::USAGE_BY_SESSION ? "" : blockTypeName(entry.first);
+                Group& group = groups[{sessionKey, typeKey}];
+                group.session = sessionKey;
+                group.type = typeKey;
+                group.blocks += tag.blocks;
+                group.bytes += tag.bytes;
+                group.allocatedBytes += tag.allocatedBytes;
+                group.freedBytes += tag.freedBytes;
+                // Tags younger than a window count over a whole one, so a
+                // burst of fresh allocations does not read as a huge rate
+                double seconds = std::max(std::chrono::duration<double>(now - tag.baseTime).count(),
+                                          std::chrono::duration<double>(kUsageWindow).count());
+                group.growth += (static_cast<double>(tag.bytes) - static_cast<double>(tag.baseBytes)) / seconds;
+                totalBlocks += tag.blocks;
+                totalBytes += tag.bytes;
+            }
+        }
+    }
+    
+    std::vector<Group> ranked;
+    for (auto& entry : groups) {
+        ranked.push_back(std::move(entry.second));
+    }
+    if (request.by_growth()) {
+        std::sort(ranked.begin(), ranked.end(), [](const Group& a, const Group& b) { return a.growth > b.growth; });
+    } else {
+        std::sort(ranked.begin(), ranked.end(), [](const Group& a, const Group& b) { return a.bytes > b.bytes; });
+    }
+    size_t top = request.top() == 0 ? 10 : request.top();
+    for (size_t i = 0; i < ranked.size() && i < top; ++i) {
+        const Group& group = ranked[i];
+        auto* entry = response.add_entries();
+        entry->set_session_id(group.session);
+        entry->set_type(group.type);
+        entry->set_blocks(group.blocks);
+        entry->set_bytes(group.bytes);
+        entry->set_allocated_bytes(group.allocatedBytes);
+        entry->set_freed_bytes(group.freedBytes);
+        entry->set_growth_bytes_per_sec(group.growth);
+    }
+    response.set_total_blocks(totalBlocks);
+    response.set_total_bytes(totalBytes);
+    response.set_groups(static_cast<uint32_t>(ranked.size()));
+}
+
+void MemoryManager::traceCreate(const MemoryBlock& block) {
+    allocTrace.record(TraceEvent::Create, block.id, block.size, block.region, block.type);
+}
+
+bool MemoryManager::startTrace(const std::string& path) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    return allocTrace.start(path);
+}
+
+void MemoryManager::stopTrace() {
+    // Every event is recorded under the mutex, so none is in flight here
+    ProfiledLock lock(mutex, profiler, __func__);
+    if (!allocTrace.enabled()) return;
+    allocTrace.stop();
+    if (allocTrace.dropped() > 0) {
+        MP_LOG_WARN("Trace: dropped " << allocTrace.dropped() << " events");
+    }
+}
+
+bool MemoryManager::startProfile(const std::string& path, size_t slowest) {
+    return profiler.start(path, slowest);
+}
+
+void MemoryManager::stopProfile() {
+    if (!profiler.enabled()) return;
+    std::string error;
+    if (!profiler.stop(error)) {
+        MP_LOG_ERROR("Profile: " << error);
+    }
+    MP_LOG_INFO(profiler.summary());
+}
+
+MemoryManager::ArenaStats MemoryManager::arenaStats() {
+    ProfiledLock lock(mutex, profiler, __func__);
+    return arenaStatsLocked();
+}
+
+MemoryManager::ArenaStats MemoryManager::arenaStatsLocked() const {
+    ArenaStats stats;
+    stats.committed = committedSize;
+    for (const auto& seg : segments) {
+        if (!seg.base) continue;
+        stats.segments++;
+        for (const auto& hole : seg.freeExtents) {
+            stats.freeBytes += hole.second;
+            stats.largestFree = std::max(stats.largestFree, hole.second);
+        }
+        stats.freeBytes += seg.size - seg.top;
+        stats.largestFree = std::max(stats.largestFree, seg.size - seg.top);
+    }
+    stats.metadataBytes = blocks.capacity() * sizeof(MemoryBlock) + refCounts.capacity() * sizeof(uint32_t) +
+                          usedBits.capacity() * sizeof(uint64_t);
+    forEachUsed([&](size_t slot) {
+        stats.liveBlocks++;
+        if (blocks[slot].resident) {
+            stats.liveBytes += blocks[slot].size;
+        }
+    });
+    return stats;
+}
+
+void MemoryManager::collectStats(memory_service::GetStatsResponse& response) {
+    {
+        ProfiledLock lock(mutex, profiler, __func__);
+        
+        ArenaStats arena = arenaStatsLocked();
+        response.set_committed_bytes(arena.committed);
+        response.set_live_bytes(arena.liveBytes);
+        response.set_free_bytes(arena.freeBytes);
+        response.set_largest_free_bytes(arena.largestFree);
+        response.set_fragmentation(arena.fragmentation());
+        response.set_live_blocks(arena.liveBlocks);
+        response.set_segments(static_cast<uint32_t>(arena.segments));
+        response.set_spilled_bytes(spill ? spill->used() : 0);
+        
+        // Types come from the usage counters; size classes are powers of
+        // two, from 8 bytes up
+        std::map<std::string, std::pair<uint64_t, uint64_t>> types;
+        for (const auto& session : usage) {
+            for (const auto& entry : session.second) {
+                if (entry.second.blocks == 0) continue;
+                auto& type = types[blockTypeName(entry.first)];
+                type.first += entry.second.blocks;
+                type.second += entry.second.bytes;
+            }
+        }
+        std::map<uint64_t, std::pair<uint64_t, uint64_t>> sizeClasses;
+        forEachUsed([&](size_t slot) {
+            const MemoryBlock& block = blocks[slot];
+            uint64_t sizeClass = 8;
+            while (sizeClass < block.size) {
+                sizeClass <<= 1;
+            }
+            auto& bucket = sizeClasses[sizeClass];
+            bucket.first++;
+            bucket.second += block.size;
+        });
+        for (const auto& entry : types) {
+            auto* type = response.add_types();
+            type->set_type(entry.first);
+            type->set_blocks(entry.second.first);
+            type->set_bytes(entry.second.second);
+        }
+        for (const auto& entry : sizeClasses) {
+            auto* sizeClass = response.add_size_classes();
+            sizeClass->set_max_size(entry.first);
+            sizeClass->set_blocks(entry.second.first);
+            sizeClass->set_bytes(entry.second.second);
+        }
+    }
+    
+    ServerStats::PassTotals gcTotals = stats.gcTotals();
+    response.set_gc_runs(gcTotals.runs);
+    response.set_gc_total_us(gcTotals.totalUs);
+    response.set_gc_last_us(gcTotals.lastUs);
+    response.set_gc_freed_blocks(gcTotals.freed);
+    ServerStats::PassTotals compactions = stats.compactionTotals();
+    response.set_compactions(compactions.runs);
+    response.set_compaction_total_us(compactions.totalUs);
+    response.set_compaction_last_us(compactions.lastUs);
+    
+    std::vector<ServerStats::RpcTotals> rpcs = stats.rpcTotals();
+    for (size_t i = 0; i < rpcs.size(); ++i) {
+        const ServerStats::RpcTotals& totals = rpcs[i];
+        if (totals.calls == 0) continue;
+        auto* rpc = response.add_rpcs();
+        rpc->set_method(ServerStats::rpcName(static_cast<ServerStats::Rpc>(i)));
+        rpc->set_calls(totals.calls);
+        rpc->set_errors(totals.errors);
+        rpc->set_total_us(totals.totalUs);
+        for (uint64_t count : totals.buckets) {
+            rpc->add_latency_buckets(count);
+        }
+        rpc->set_p50_us(totals.percentileUs(50));
+        rpc->set_p99_us(totals.percentileUs(99));
+        rpc->set_p999_us(totals.percentileUs(99.9));
+    }
+}
+
+bool MemoryManager::startMetrics(uint16_t port) {
+    metrics = std::make_unique<MetricsServer>();
+    return metrics->start(port, [this] {
+        memory_service::GetStatsResponse response;
+        collectStats(response);
+        return MetricsServer::format(response);
+    });
+}
+
+bool MemoryManager::releaseBlock(uint32_t id) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    MemoryBlock* block = findBlock(id);
+    if (!block || block->region != 0) return false;
+    std::vector<uint32_t> links = readLinks(*block);
+    freeBlock(*block);
+    logFree(id);
+    adjustLinks(links, -1);
+    releaseEmptySegments();
+    return true;
+}
+
+MemoryManager::MemoryBlock* MemoryManager::findBlock(uint32_t id) {
+    auto it = blockIndex.find(id);
+    if (it == blockIndex.end()) return nullptr;
+    return isUsed(it->second) ? &blocks[it->second] : nullptr;
+}
+
+static size_t alignUp(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+size_t MemoryManager::allocateOffset(size_t size, size_t alignment, uint32_t& segment) {
+    size_t offset = carveOffset(size, alignment, segment);
+    // Arena at its ceiling: move cold blocks to the spill file until the request fits
+    while (offset == kNoSpace && spill && size <= totalSize && evictOne()) {
+        offset = carveOffset(size, alignment, segment);
+    }
+    return offset;
+}
+
+size_t MemoryManager::carveOffset(size_t size, size_t alignment, uint32_t& segment) {
+    // Segment bases are kMaxAlignment-aligned, so aligning the offset
+    // aligns the address. Padding skipped in front stays a hole.
+    for (uint32_t s = 0; s < segments.size(); ++s) {
+        auto& holes = segments[s].freeExtents;
+        for (auto it = holes.begin(); it != holes.end(); ++it) {
+            size_t offset = alignUp(it->first, alignment);
+            size_t padding = offset - it->first;
+            if (it->second >= padding + size) {
+                size_t start = it->first;
+                size_t remaining = it->second - padding - size;
+                holes.erase(it);
+                if (padding > 0) {
+                    holes[start] = padding;
+                }
+                if (remaining > 0) {
+                    holes[offset + size] = remaining;
+                }
+                segment = s;
+                return offset;
+            }
+        }
+    }
+    
+    for (uint32_t s = 0; s < segments.size(); ++s) {
+        Segment& seg = segments[s];
+        size_t offset = alignUp(seg.top, alignment);
+        if (seg.base && offset + size <= seg.size) {
+            if (offset > seg.top) {
+                seg.freeExtents[seg.top] = offset - seg.top;
+            }
+            seg.top = offset + size;
+            segment = s;
+            return offset;
+        }
+    }
+    
+    // Grow the arena by one segment
+    if (!addSegment(size, segment)) {
+        return kNoSpace;
+    }
+    segments[segment].top = size;
+    return 0;
+}
+
+bool MemoryManager::addSegment(size_t minSize, uint32_t& segment) {
+    // Oversized blocks get a segment of their own; the last one may be
+    // cut short by the ceiling
+    size_t size = std::min(std::max(segmentSize, minSize), totalSize - committedSize);
+    if (size == 0 || size < minSize) return false;
+    void* base = nullptr;
+    if (posix_memalign(&base, kMaxAlignment, size) != 0) return false;
+    
+    // Reuse a released slot so segment numbers stay small
+    segment = 0;
+    while (segment < segments.size() && segments[segment].base) {
+        ++segment;
+    }
+    if (segment == segments.size()) {
+        segments.emplace_back();
+    }
+    segments[segment].base = static_cast<char*>(base);
+    segments[segment].size = size;
+    committedSize += size;
+    return true;
+}
+
+void MemoryManager::releaseOffset(uint32_t segment, size_t offset, size_t size) {
+    if (size == 0) return;
+    Segment& seg = segments[segment];
+    auto& holes = seg.freeExtents;
+    
+    // Coalesce with the following hole
+    auto next = holes.lower_bound(offset);
+    if (next != holes.end() && offset + size == next->first) {
+        size += next->second;
+        next = holes.erase(next);
+    }
+    
+    // Coalesce with the preceding hole
+    if (next != holes.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            holes.erase(prev);
+        }
+    }
+    
+    // A hole touching the top just lowers it
+    if (offset + size == seg.top) {
+        seg.top = offset;
+    } else {
+        holes[offset] = size;
+    }
+}
+
+void MemoryManager::releaseEmptySegments() {
+    // The first segment stays so an idle server does not start from nothing
+    for (size_t s = 1; s < segments.size(); ++s) {
+        Segment& seg = segments[s];
+        if (seg.base && seg.top == 0) {
+            free(seg.base);
+            committedSize -= seg.size;
+            seg = Segment();
+        }
+    }
+    while (segments.size() > 1 && !segments.back().base) {
+        segments.pop_back();
+    }
+}
+
+void MemoryManager::resetArena() {
+    for (auto& seg : segments) {
+        free(seg.base);
+    }
+    segments.clear();
+    committedSize = 0;
+    sharedStorage.clear();
+    clockHand = 0;
+    if (spill) {
+        spill->clear();
+    }
+}
+
+void MemoryManager::freeBlock(MemoryBlock& block) {
+    setUsed(slotOf(block), false);
+    accountBlock(block, -1);
+    if (!block.resident) {
+        spill->release(block.spillSlot, block.size);
+        return;
+    }
+    
+    // Storage shared with a copy-on-write clone stays with the other blocks
+    auto shared = sharedStorage.find(storage(block));
+    if (shared != sharedStorage.end()) {
+        if (--shared->second == 1) {
+            sharedStorage.erase(shared);
+        }
+        return;
+    }
+    releaseOffset(block.segment, block.offset, block.size);
+}
+
+bool MemoryManager::ensureExclusive(MemoryBlock& block) {
+    auto shared = sharedStorage.find(storage(block));
+    if (shared == sharedStorage.end()) {
+        return true;
+    }
+    
+    // First write to copy-on-write storage: give this block its own copy
+    uint32_t segment;
+    size_t offset = allocateOffset(block.size, block.alignment, segment);
+    if (offset == kNoSpace) {
+        return false;
+    }
+    std::memcpy(segments[segment].base + offset, address(block), block.size);
+    if (--shared->second == 1) {
+        sharedStorage.erase(shared);
+    }
+    block.segment = segment;
+    block.offset = offset;
+    return true;
+}
+
+// Keeps the blocks an operation works on in the arena while it makes room
+class BlockPin {
+public:
+    explicit BlockPin(MemoryManager::MemoryBlock* first, MemoryManager::MemoryBlock* second = nullptr)
+        : first(first), second(second) {
+        if (first) first->pinned = true;
+        if (second) second->pinned = true;
+    }
+    ~BlockPin() { release(); }
+
+    // Unpins early, before the block table can reallocate
+    void release() {
+        if (first) first->pinned = false;
+        if (second) second->pinned = false;
+        first = second = nullptr;
+    }
+
+private:
+    MemoryManager::MemoryBlock* first;
+    MemoryManager::MemoryBlock* second;
+};
+
+char* MemoryManager::blockData(MemoryBlock& block) {
+    block.referenced = true;
+    if (!block.resident) {
+        // Fault the block back in, possibly evicting colder ones
+        ProfiledPhase phase(profiler, "spillIn");
+        uint32_t segment;
+        size_t offset = allocateOffset(block.size, block.alignment, segment);
+        if (offset == kNoSpace) return nullptr;
+        if (!spill->read(block.spillSlot, segments[segment].base + offset, block.size)) {
+            releaseOffset(segment, offset, block.size);
+            return nullptr;
+        }
+        spill->release(block.spillSlot, block.size);
+        block.segment = segment;
+        block.offset = offset;
+        block.resident = true;
+    }
+    return address(block);
+}
+
+bool MemoryManager::evictOne() {
+    // CLOCK: the hand clears reference bits as it sweeps and evicts the
+    // first block it finds unreferenced; two turns visit every block twice
+    for (size_t step = 0; step < 2 * blocks.size(); ++step) {
+        if (clockHand >= blocks.size()) clockHand = 0;
+        MemoryBlock& block = blocks[clockHand++];
+        // Copy-on-write storage stays put for all its sharers, region
+        // storage until the region is destroyed
+        if (!isUsed(block) || !block.resident || block.pinned || block.size == 0 || block.region != 0 ||
+            sharedStorage.count(storage(block))) {
+            continue;
+        }
+        if (block.referenced) {
+            block.referenced = false;
+            continue;
+        }
+        
+        size_t slot = spill->write(address(block), block.size);
+        if (slot == SpillFile::kNoSlot) return false;
+        releaseOffset(block.segment, block.offset, block.size);
+        block.resident = false;
+        block.spillSlot = slot;
+        return true;
+    }
+    return false;
+}
+
+bool MemoryManager::setValue(uint32_t id, const void* value, size_t size) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    MemoryBlock* found;
+    {
+        ProfiledPhase phase(profiler, "lookup");
+        found = findBlock(id);
+    }
+    if (!found || size > found->size) return false;
+    
+    MemoryBlock& block = *found;
+    BlockPin pin(&block);
+    if (!blockData(block) || !ensureExclusive(block)) return false;
+    std::vector<uint32_t> before = readLinks(block);
+    {
+        ProfiledPhase phase(profiler, "copy");
+        std::memcpy(address(block), value, size);
+    }
+    {
+        ProfiledPhase phase(profiler, "log");
+        logWrite(block, 0, size);
+        adjustLinks(readLinks(block), +1);
+        adjustLinks(before, -1);
+    }
+    dumpMemoryState();
+    return true;
+}
+
+bool MemoryManager::getValue(uint32_t id, void* value, size_t size) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    MemoryBlock* found;
+    {
+        ProfiledPhase phase(profiler, "lookup");
+        found = findBlock(id);
+    }
+    if (!found || size > found->size) return false;
+    
+    const char* src = blockData(*found);
+    if (!src) return false;
+    ProfiledPhase phase(profiler, "copy");
+    std::memcpy(value, src, size);
+    return true;
+}
+
+bool MemoryManager::increaseRefCount(uint32_t id, uint64_t session) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    MemoryBlock* block = findBlock(id);
+    if (!block) return false;
+    refCount(*block)++;
+    logBlock(*block);
+    shade(block->id);
+    trackReference(session, id, +1);
+    dumpMemoryState();
+    return true;
+}
+
+bool MemoryManager::decreaseRefCount(uint32_t id, uint64_t session) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    MemoryBlock* block = findBlock(id);
+    if (!block || refCount(*block) == 0) return false;
+    if (!trackReference(session, id, -1)) return false;
+    refCount(*block)--;
+    logBlock(*block);
+    shade(block->id);
+    dumpMemoryState();
+    return true;
+}
+
+size_t MemoryManager::decreaseRefCounts(const uint64_t* ids, size_t count, uint64_t session) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    // One lock and one dump for the whole batch
+    size_t applied = 0;
+    for (size_t i = 0; i < count; ++i) {
+        MemoryBlock* block = findBlock(static_cast<uint32_t>(ids[i]));
+        if (!block || refCount(*block) == 0) continue;
+        // A returned reservation is simply released; anything else must
+        // still be held by the session
+        if (!endReservation(block->id) && !trackReference(session, block->id, -1)) continue;
+        refCount(*block)--;
+        logBlock(*block);
+        shade(block->id);
+        applied++;
+    }
+    if (applied > 0) {
+        dumpMemoryState();
+    }
+    return applied;
+}
+
+std::vector<uint32_t> MemoryManager::reserveBlocks(size_t size, const std::string& type, size_t count,
+                                                  std::chrono::milliseconds lease, uint32_t layoutId,
+                                                  size_t alignment) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    // Each reserved block holds one reference on behalf of the reservation
+    std::vector<uint32_t> ids;
+    auto expiry = std::chrono::steady_clock::now() + lease;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t id = createBlockLocked(size, type, layoutId, 0, 0, alignment);
+        if (id == static_cast<uint32_t>(-1)) break;
+        reservations[id] = expiry;
+        logReservation(id, lease);
+        ids.push_back(id);
+    }
+    if (!ids.empty()) {
+        dumpMemoryState();
+    }
+    return ids;
+}
+
+size_t MemoryManager::claimReservations(const uint64_t* ids, size_t count, uint64_t session) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    // The reservation's reference now belongs to the claiming session
+    size_t claimed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t id = static_cast<uint32_t>(ids[i]);
+        if (endReservation(id)) {
+            trackReference(session, id, +1);
+            claimed++;
+            // Its usage moves from the unowned tag to the session's
+            MemoryBlock* block = findBlock(id);
+            if (block && block->owner == 0 && session != 0) {
+                accountBlock(*block, -1);
+                block->owner = session;
+                accountBlock(*block, +1);
+                logBlock(*block);
+            }
+        }
+    }
+    return claimed;
+}
+
+std::chrono::milliseconds MemoryManager::heartbeat(uint64_t session, std::chrono::milliseconds lease, bool resume) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    if (resume && sessions.find(session) == sessions.end()) {
+        return std::chrono::milliseconds(0);
+    }
+    Session& entry = sessions[session];
+    if (lease.count() > 0) {
+        entry.lease = lease;
+    }
+    entry.expiry = std::chrono::steady_clock::now() + entry.lease;
+    return entry.lease;
+}
+
+bool MemoryManager::trackReference(uint64_t session, uint32_t id, int delta) {
+    // Called with mutex held
+    if (session == 0) return true;
+    
+    auto it = sessions.find(session);
+    if (it == sessions.end()) {
+        if (delta < 0) return false;
+        // First use before any heartbeat: open it with the default lease
+        it = sessions.emplace(session, Session()).first;
+        it->second.expiry = std::chrono::steady_clock::now() + it->second.lease;
+    }
+    auto& held = it->second.held;
+    if (delta > 0) {
+        held[id]++;
+    } else {
+        auto entry = held.find(id);
+        if (entry == held.end()) return false;
+        if (--entry->second == 0) {
+            held.erase(entry);
+        }
+    }
+    logSessionRef(session, id, delta);
+    return true;
+}
+
+void MemoryManager::expireSessions() {
+    // Called with mutex held; the GC frees whatever drops to zero
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        if (it->second.expiry > now) {
+            ++it;
+            continue;
+        }
+        size_t released = 0;
+        for (const auto& entry : it->second.held) {
+            MemoryBlock* block = findBlock(entry.first);
+            if (!block) continue;
+            uint32_t count = std::min(entry.second, refCount(*block));
+            if (count == 0) continue;
+            refCount(*block) -= count;
+            logBlock(*block);
+            shade(block->id);
+            released += count;
+        }
+        if (released > 0) {
+            MP_LOG_INFO("Session " << it->first << " expired, released " << released << " references");
+        }
+        logSessionRef(it->first, 0, 0);
+        
+        // Regions the session opened go with it
+        for (auto region = regions.begin(); region != regions.end();) {
+            uint32_t regionId = region->first;
+            bool owned = region->second.session == it->first;
+            ++region;
+            if (owned) {
+                destroyRegionLocked(regionId);
+            }
+        }
+        it = sessions.erase(it);
+    }
+}
+
+uint32_t MemoryManager::createRegion(size_t chunkSize, uint64_t session) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    // Chunks are taken on first use, so an empty region holds no memory
+    uint32_t id = nextRegionId++;
+    regions[id] = Region{chunkSize > 0 ? chunkSize : kDefaultRegionChunk, session, {}, {}};
+    allocTrace.record(TraceEvent::RegionCreate, id, regions[id].chunkSize);
+    logRegion(id, &regions[id]);
+    return id;
+}
+
+size_t MemoryManager::regionOffset(Region& region, size_t size, size_t alignment, uint32_t& segment) {
+    // Pointer bump in the newest chunk; the rest of a full chunk is abandoned
+    auto fits = [&](const Region::Chunk& chunk) {
+        return alignUp(chunk.used, alignment) + size <= chunk.size;
+    };
+    if (region.chunks.empty() || !fits(region.chunks.back())) {
+        Region::Chunk chunk{0, 0, std::max(size, region.chunkSize), 0};
+        chunk.offset = allocateOffset(chunk.size, kMaxAlignment, chunk.segment);
+        if (chunk.offset == kNoSpace) return kNoSpace;
+        region.chunks.push_back(chunk);
+    }
+    Region::Chunk& chunk = region.chunks.back();
+    segment = chunk.segment;
+    chunk.used = alignUp(chunk.used, alignment);
+    size_t offset = chunk.offset + chunk.used;
+    chunk.used += size;
+    return offset;
+}
+
+bool MemoryManager::destroyRegion(uint32_t region, size_t& freed) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    if (regions.count(region) == 0) return false;
+    freed = destroyRegionLocked(region);
+    dumpMemoryState();
+    return true;
+}
+
+size_t MemoryManager::destroyRegionLocked(uint32_t id) {
+    Region& region = regions[id];
+    allocTrace.record(TraceEvent::RegionDestroy, id);
+    
+    // Members give up their links, but their storage goes back chunk by chunk.
+    // One record stands for all the member frees; it follows the link
+    // updates, which a backup must apply while the members still exist.
+    size_t freed = 0;
+    for (uint32_t member : region.blocks) {
+        MemoryBlock* block = findBlock(member);
+        if (!block) continue;
+        std::vector<uint32_t> links = readLinks(*block);
+        setUsed(slotOf(*block), false);
+        accountBlock(*block, -1);
+        endReservation(member);
+        allocTrace.record(TraceEvent::Free, member);
+        adjustLinks(links, -1);
+        freed++;
+    }
+    logRegion(id, nullptr);
+    releaseRegion(id);
+    return freed;
+}
+
+void MemoryManager::releaseRegion(uint32_t id) {
+    // Called with mutex held
+    auto it = regions.find(id);
+    if (it == regions.end()) return;
+    for (uint32_t member : it->second.blocks) {
+        MemoryBlock* block = findBlock(member);
+        if (!block) continue;
+        setUsed(slotOf(*block), false);
+        accountBlock(*block, -1);
+        reservations.erase(member);
+    }
+    for (const auto& chunk : it->second.chunks) {
+        releaseOffset(chunk.segment, chunk.offset, chunk.size);
+    }
+    regions.erase(it);
+}
+
+void MemoryManager::expireReservations() {
+    // Called with mutex held
+    if (reservations.empty()) return;
+    
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = reservations.begin(); it != reservations.end();) {
+        if (it->second <= now) {
+            // Never claimed: drop the reservation's reference
+            MemoryBlock* block = findBlock(it->first);
+            if (block && refCount(*block) > 0) {
+                refCount(*block)--;
+                logBlock(*block);
+                shade(block->id);
+            }
+            logReservation(it->first, std::chrono::milliseconds(0));
+            it = reservations.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t MemoryManager::collectGarbage() {
+    ProfiledLock lock(mutex, profiler, __func__);
+    return sweepUnreferenced();
+}
+
+size_t MemoryManager::sweepUnreferenced() {
+    // Check for blocks with zero references; their links let go of their
+    // targets. Only the bitmap and the counts are read for the others.
+    size_t freed = 0;
+    forEachUsed([&](size_t slot) {
+        // Region blocks wait for their region
+        if (refCounts[slot] != 0 || blocks[slot].region != 0) return;
+        MemoryBlock& block = blocks[slot];
+        std::vector<uint32_t> links = readLinks(block);
+        freeBlock(block);
+        logFree(block.id);
+        adjustLinks(links, -1);
+        dumpMemoryState();
+        freed++;
+    });
+    releaseEmptySegments();
+    return freed;
+}
+
+void MemoryManager::defragment() {
+    ProfiledLock lock(mutex, profiler, __func__);
+    auto started = std::chrono::steady_clock::now();
+    
+    // The collector walks blocks by position, which is about to change
+    abortTrace();
+    allocTrace.record(TraceEvent::Defragment, 0);
+    
+    // Sort live blocks by location; descriptors of freed ones are dropped
+    std::vector<size_t> order;
+    forEachUsed([&](size_t slot) { order.push_back(slot); });
+    std::sort(order.begin(), order.end(), 
+              [this](size_t a, size_t b) {
+                  return storage(blocks[a]) < storage(blocks[b]);
+              });
+    std::vector<MemoryBlock> sorted;
+    std::vector<uint32_t> sortedRefs;
+    sorted.reserve(order.size());
+    sortedRefs.reserve(order.size());
+    for (size_t slot : order) {
+        sorted.push_back(blocks[slot]);
+        sortedRefs.push_back(refCounts[slot]);
+    }
+    clearBlocks();
+    blocks = std::move(sorted);
+    refCounts = std::move(sortedRefs);
+    usedBits.assign((blocks.size() + 63) / 64, ~uint64_t(0));
+    if (blocks.size() % 64 != 0) {
+        usedBits.back() = (uint64_t(1) << (blocks.size() % 64)) - 1;
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        blockIndex[blocks[i].id] = i;
+    }
+    clockHand = 0;
+    
+    // Pack blocks toward the first segment. A block never moves past its
+    // own position, so nothing is overwritten before it has moved.
+    // Copy-on-write storage is moved once and every sharer follows it, and
+    // so is each region chunk, with its members at the same offsets inside.
+    std::map<std::pair<uint32_t, size_t>, std::pair<uint32_t, size_t>> movedShared;
+    std::map<std::pair<uint32_t, size_t>, Region::Chunk*> chunks;
+    std::map<std::pair<uint32_t, size_t>, std::pair<uint32_t, size_t>> movedChunks;
+    for (auto& region : regions) {
+        for (auto& chunk : region.second.chunks) {
+            chunks[{chunk.segment, chunk.offset}] = &chunk;
+        }
+    }
+    std::vector<size_t> tops(segments.size(), 0);
+    uint32_t target = 0;
+    size_t newOffset = 0;
+    // Moves (target, newOffset) to the next place that fits; padding left
+    // in front of an aligned block becomes a hole
+    std::vector<std::map<size_t, size_t>> padding(segments.size());
+    auto place = [&](size_t size, size_t alignment) {
+        size_t offset = alignUp(newOffset, alignment);
+        while (!segments[target].base || offset + size > segments[target].size) {
+            ++target;
+            newOffset = 0;
+            offset = 0;
+        }
+        if (offset > newOffset) {
+            padding[target][newOffset] = offset - newOffset;
+        }
+        newOffset = offset;
+    };
+    for (auto& block : blocks) {
+        if (block.region != 0) {
+            // A chunk's first member sits at its start, so the chunk moves
+            // when that member comes up in location order
+            auto chunk = std::prev(chunks.upper_bound(storage(block)));
+            auto moved = movedChunks.find(chunk->first);
+            if (moved == movedChunks.end()) {
+                size_t size = chunk->second->size;
+                place(size, kMaxAlignment);
+                if (chunk->first != std::make_pair(target, newOffset)) {
+                    std::memmove(segments[target].base + newOffset,
+                                 segments[chunk->first.first].base + chunk->first.second, size);
+                }
+                moved = movedChunks.emplace(chunk->first, std::make_pair(target, newOffset)).first;
+                newOffset += size;
+                tops[target] = newOffset;
+            }
+            block.offset = moved->second.second + (block.offset - chunk->first.second);
+            block.segment = moved->second.first;
+            continue;
+        }
+        if (block.resident) {
+            bool shared = sharedStorage.count(storage(block)) > 0;
+            if (shared) {
+                auto moved = movedShared.find(storage(block));
+                if (moved != movedShared.end()) {
+                    block.segment = moved->second.first;
+                    block.offset = moved->second.second;
+                    continue;
+                }
+            }
+            place(block.size, block.alignment);
+            if (shared) {
+                movedShared[storage(block)] = {target, newOffset};
+            }
+            if (block.segment != target || block.offset != newOffset) {
+                // Move memory
+                std::memmove(segments[target].base + newOffset, address(block), block.size);
+                block.segment = target;
+                block.offset = newOffset;
+            }
+            newOffset += block.size;
+            tops[target] = newOffset;
+        }
+    }
+    
+    std::map<std::pair<uint32_t, size_t>, uint32_t> relocated;
+    for (const auto& entry : sharedStorage) {
+        relocated[movedShared[entry.first]] = entry.second;
+    }
+    sharedStorage.swap(relocated);
+    for (const auto& entry : movedChunks) {
+        chunks[entry.first]->segment = entry.second.first;
+        chunks[entry.first]->offset = entry.second.second;
+    }
+    
+    // Everything above the last live block of each segment is free again,
+    // and segments left empty go back to the OS
+    for (size_t s = 0; s < segments.size(); ++s) {
+        segments[s].freeExtents = std::move(padding[s]);
+        segments[s].top = tops[s];
+    }
+    releaseEmptySegments();
+    stats.recordCompaction(std::chrono::steady_clock::now() - started);
+    
+    dumpMemoryState();
+}
+
+// Runs one kernel over a typed view of the arena
+template<typename T>
+static bool runKernel(memory_service::ComputeOp op, T* data, const T* other, size_t count,
+                      double scalar, double& result, int64_t& intResult, std::string& error) {
+    const simd::KernelTable<T>& k = simd::kernels<T>();
+    // Integer blocks take the scalar operand rounded to the nearest integer
+    T operand = std::is_integral<T>::value ? static_cast<T>(std::llround(scalar))
+                                           : static_cast<T>(scalar);
+    switch (op) {
+        case memory_service::SUM: {
+            auto sum = k.sum(data, count);
+            result = static_cast<double>(sum);
+            intResult = static_cast<int64_t>(sum);
+            return true;
+        }
+        case memory_service::MIN:
+        case memory_service::MAX: {
+            if (count == 0) {
+                error = "block is empty, so it has no minimum or maximum";
+                return false;
+            }
+            T value = op == memory_service::MIN ? k.min(data, count) : k.max(data, count);
+            result = static_cast<double>(value);
+            intResult = static_cast<int64_t>(value);
+            return true;
+        }
+        case memory_service::DOT: {
+            auto dot = k.dot(data, other, count);
+            result = static_cast<double>(dot);
+            intResult = static_cast<int64_t>(dot);
+            return true;
+        }
+        case memory_service::SCALE:
+            k.scale(data, count, operand);
+            return true;
+        case memory_service::FILL:
+            k.fill(data, count, operand);
+            return true;
+        case memory_service::ADD:
+            k.add(data, other, count);
+            return true;
+        default:
+            error = "unknown operation";
+            return false;
+    }
+}
+
+bool MemoryManager::compute(memory_service::ComputeOp op, uint32_t id, uint32_t otherId,
+                            double scalar, double& result, int64_t& intResult, std::string& error) {
+    ProfiledLock lock(mutex, profiler, __func__);
+
+    const bool binary = op == memory_service::DOT || op == memory_service::ADD;
+    const bool writes = op == memory_service::SCALE || op == memory_service::FILL || op == memory_service::ADD;
+    MemoryBlock* target = findBlock(id);
+    MemoryBlock* operand = binary ? findBlock(otherId) : nullptr;
+    if (!target || (binary && !operand)) {
+        error = "block not found";
+        return false;
+    }
+
+    // Both operands must agree on type and length
+    if (binary && (operand->type != target->type || operand->size != target->size)) {
+        error = "blocks must share a numeric type and size";
+        return false;
+    }
+    BlockPin pin(target, operand);
+    if ((!blockData(*target) || (binary && !blockData(*operand))) ||
+        (writes && !ensureExclusive(*target))) {
+        error = "not enough memory";
+        return false;
+    }
+
+    char* data = address(*target);
+    const char* other = binary ? address(*operand) : nullptr;
+
+    result = 0;
+    intResult = 0;
+    bool success;
+    if (target->type == memory_service::INT) {
+        success = runKernel(op, reinterpret_cast<int32_t*>(data), reinterpret_cast<const int32_t*>(other),
+                            target->size / sizeof(int32_t), scalar, result, intResult, error);
+    } else if (target->type == memory_service::FLOAT) {
+        success = runKernel(op, reinterpret_cast<float*>(data), reinterpret_cast<const float*>(other),
+                            target->size / sizeof(float), scalar, result, intResult, error);
+    } else if (target->type == memory_service::DOUBLE) {
+        success = runKernel(op, reinterpret_cast<double*>(data), reinterpret_cast<const double*>(other),
+                            target->size / sizeof(double), scalar, result, intResult, error);
+    } else {
+        error = "block is not INT, FLOAT or DOUBLE";
+        return false;
+    }
+
+    // Transforms change the block contents
+    if (success && writes) {
+        logWrite(*target, 0, target->size);
+        dumpMemoryState();
+    }
+    return success;
+}
+
+bool MemoryManager::copyRange(uint32_t srcId, size_t srcOffset, uint32_t dstId, size_t dstOffset, size_t length) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    MemoryBlock* src = findBlock(srcId);
+    MemoryBlock* dst = findBlock(dstId);
+    if (!src || !dst) return false;
+    if (srcOffset > src->size || length > src->size - srcOffset) return false;
+    if (dstOffset > dst->size || length > dst->size - dstOffset) return false;
+    if (length == 0) return true;
+    
+    BlockPin pin(src, dst);
+    if (!blockData(*src) || !blockData(*dst)) return false;
+    // Unshare the destination before reading the source's (possibly same) storage
+    if (!ensureExclusive(*dst)) return false;
+    
+    std::vector<uint32_t> before = readLinks(*dst);
+    std::memmove(address(*dst) + dstOffset, address(*src) + srcOffset, length);
+    logWrite(*dst, dstOffset, length);
+    adjustLinks(readLinks(*dst), +1);
+    adjustLinks(before, -1);
+    dumpMemoryState();
+    return true;
+}
+
+uint32_t MemoryManager::cloneBlock(uint32_t id, bool copyOnWrite, uint64_t session) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    MemoryBlock* src = findBlock(id);
+    if (!src) return -1;
+    
+    uint32_t segment;
+    size_t offset;
+    BlockPin pin(src);
+    if (!blockData(*src)) return -1;
+    // Region storage is freed with its region, so it is never shared
+    if (copyOnWrite && src->size > 0 && src->region == 0) {
+        // Share the source storage; the first write to either side copies it
+        segment = src->segment;
+        offset = src->offset;
+        auto shared = sharedStorage.find(storage(*src));
+        if (shared == sharedStorage.end()) {
+            sharedStorage[storage(*src)] = 2;
+        } else {
+            shared->second++;
+        }
+    } else {
+        offset = allocateOffset(src->size, src->alignment, segment);
+        if (offset == kNoSpace) return -1;
+        std::memcpy(segments[segment].base + offset, address(*src), src->size);
+    }
+    
+    // push_back may reallocate, so copy what we need from src first
+    MemoryBlock copy{
+        nextBlockId++,
+        segment,
+        src->size,
+        offset
+    };
+    copy.type = src->type;
+    copy.layout = src->layout;
+    copy.alignment = src->alignment;
+    copy.owner = session;
+    pin.release();
+    const MemoryBlock& clone = addBlock(copy, 1);  // Initial ref count
+    // Backups get an independent copy
+    logBlock(clone);
+    logWrite(clone, 0, clone.size);
+    // The copied links take references of their own
+    adjustLinks(readLinks(clone), +1);
+    trackReference(session, clone.id, +1);
+    dumpMemoryState();
+    return clone.id;
+}
+
+uint32_t MemoryManager::registerLayout(const std::string& name, size_t size,
+                                      const std::vector<uint32_t>& pointerOffsets, uint32_t tag,
+                                      std::string& error) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    
+    for (uint32_t offset : pointerOffsets) {
+        if (static_cast<size_t>(offset) + sizeof(uint64_t) > size) {
+            error = "Pointer offset outside the layout";
+            return 0;
+        }
+    }
+    
+    // The id is a hash of the name, so every server (and every restart)
+    // agrees on it without coordination
+    uint32_t id = 2166136261u;
+    for (char c : name) {
+        id ^= static_cast<unsigned char>(c);
+        id *= 16777619u;
+    }
+    if (id == 0) id = 1;
+    
+    // Every sharded client must tag this server's ids the same way
+    if (tag > 0xFFFF) {
+        error = "Shard tag out of range";
+        return 0;
+    }
+    if (tag != 0 && shardTag != 0 && tag != shardTag) {
+        error = "Server ids are already tagged " + std::to_string(shardTag) +
+                "; clients must name every server the same way";
+        return 0;
+    }
+    
+    TypeLayout layout{name, size, pointerOffsets};
+    auto existing = layouts.find(id);
+    if (existing != layouts.end() && (existing->second.name != name || existing->second.size != size ||
+                                      existing->second.pointerOffsets != pointerOffsets)) {
+        error = "Layout " + name + " is already registered differently";
+        return 0;
+    }
+    bool newTag = tag != 0 && shardTag == 0;
+    if (newTag) {
+        shardTag = tag;
+    }
+    if (existing != layouts.end()) {
+        if (newTag) {
+            logLayout(id, existing->second);  // The record carries the tag
+        }
+        return id;
+    }
+    layouts[id] = layout;
+    logLayout(id, layout);
+    return id;
+}
+
+void MemoryManager::setCycleCollection(std::chrono::milliseconds interval, std::chrono::microseconds budget) {
+    ProfiledLock lock(mutex, profiler, __func__);
+    traceInterval = interval;
+    traceBudget = budget;
+}
+
+std::vector<uint32_t> MemoryManager::readLinks(const MemoryBlock& block) {
+    std::vector<uint32_t> links;
+    if (block.layout == 0) return links;
+    auto layout = layouts.find(block.layout);
+    if (layout == layouts.end()) return links;
+    
+    for (uint32_t offset : layout->second.pointerOffsets) {
+        uint64_t value = 0;
+        if (block.resident) {
+            std::memcpy(&value, address(block) + offset, sizeof(value));
+        } else if (!spill->read(block.spillSlot + offset, &value, sizeof(value))) {
+            continue;
+        }
+        // Sharded ids carry their server's tag: strip ours, and leave
+        // links to other shards to their own servers
+        uint64_t tag = value >> kShardShift;
+        if (tag != 0) {
+            if (tag != shardTag) continue;
+            value &= (uint64_t(1) << kShardShift) - 1;
+        }
+        if (value != 0 && value <= UINT32_MAX) {
+            links.push_back(static_cast<uint32_t>(value));
+        }
+    }
+    return links;
+}
+
+void MemoryManager::adjustLinks(const std::vector<uint32_t>& targets, int delta) {
+    for (uint32_t target : targets) {
+        MemoryBlock* block = findBlock(target);
+        if (!block) continue;
+        uint32_t& refs = refCount(*block);
+        if (delta > 0) {
+            refs++;
+        } else if (refs > 0) {
+            refs--;
+        } else {
+            continue;
+        }
+        logBlock(*block);
+        shade(block->id);
+    }
+}
+
+void MemoryManager::shade(uint32_t id) {
+    // Conservative barrier: anything touched mid-collection survives it
+    if (tracePhase == TracePhase::Idle) return;
+    if (traceMarked.insert(id).second && tracePhase != TracePhase::Sweep) {
+        traceGrey.push_back(id);
+    }
+}
+
+void MemoryManager::abortTrace() {
+    tracePhase = TracePhase::Idle;
+    traceCursor = 0;
+    traceFreed = 0;
+    internalRefs.clear();
+    traceMarked.clear();
+    traceGrey.clear();
+}
+
+void MemoryManager::traceStep(std::chrono::steady_clock::time_point now) {
+    // Called with mutex held, once per GC tick
+    if (tracePhase == TracePhase::Idle) {
+        if (layouts.empty() || now - lastTrace < traceInterval) return;
+        lastTrace = now;
+        tracePhase = TracePhase::Count;
+    }
+    
+    auto deadline = now + traceBudget;
+    size_t work = 0;
+    auto outOfTime = [&] {
+        return ++work % 64 == 0 && std::chrono::steady_clock::now() >= deadline;
+    };
+    
+    // Count: how many references each block receives from links
+    while (tracePhase == TracePhase::Count) {
+        if (traceCursor == blocks.size()) {
+            tracePhase = TracePhase::Mark;
+            traceCursor = 0;
+            break;
+        }
+        size_t slot = traceCursor++;
+        if (isUsed(slot) && blocks[slot].layout != 0) {
+            for (uint32_t target : readLinks(blocks[slot])) {
+                internalRefs[target]++;
+            }
+        }
+        if (outOfTime()) return;
+    }
+    
+    // Mark: roots are blocks referenced from outside (clients, reservations,
+    // links on other shards); everything reachable from them stays
+    while (tracePhase == TracePhase::Mark) {
+        if (!traceGrey.empty()) {
+            uint32_t id = traceGrey.back();
+            traceGrey.pop_back();
+            MemoryBlock* block = findBlock(id);
+            if (block && block->layout != 0) {
+                for (uint32_t target : readLinks(*block)) {
+                    shade(target);
+                }
+            }
+        } else if (traceCursor < blocks.size()) {
+            // Region blocks stay until their region goes, so they are roots too
+            size_t slot = traceCursor++;
+            if (isUsed(slot)) {
+                const MemoryBlock& block = blocks[slot];
+                if (block.region != 0 || refCounts[slot] > internalRefs[block.id]) {
+                    shade(block.id);
+                }
+            }
+        } else {
+            tracePhase = TracePhase::Sweep;
+            traceCursor = 0;
+            break;
+        }
+        if (outOfTime()) return;
+    }
+    
+    // Sweep: unmarked blocks are only held by each other
+    while (tracePhase == TracePhase::Sweep) {
+        if (traceCursor == blocks.size()) {
+            if (traceFreed > 0) {
+                MP_LOG_INFO("Cycle collector freed " << traceFreed << " unreachable blocks");
+                dumpMemoryState();
+            }
+            abortTrace();
+            releaseEmptySegments();
+            return;
+        }
+        size_t slot = traceCursor++;
+        MemoryBlock& block = blocks[slot];
+        if (isUsed(slot) && block.region == 0 && traceMarked.count(block.id) == 0) {
+            std::vector<uint32_t> links = readLinks(block);
+            freeBlock(block);
+            logFree(block.id);
+            traceFreed++;
+            // Survivors it pointed to lose that reference; garbage needs no update
+            for (uint32_t target : links) {
+                MemoryBlock* survivor = findBlock(target);
+                if (survivor && refCount(*survivor) > 0 && traceMarked.count(target) != 0) {
+                    refCount(*survivor)--;
+                    logBlock(*survivor);
+                }
+            }
+        }
+        if (outOfTime()) return;
+    }
+}
+
+void MemoryManager::appendMutation(memory_service::MutationRecord record) {
+    if (wal) {
+        pendingWalSequence = wal->append(record);
+    }
+    if (replicationLog.active()) {
+        replicationLog.append(std::move(record));
+    }
+}
+
+bool MemoryManager::awaitDurability() {
+    // Group commit: wait, without the mutex, for the batch holding our records
+    if (!wal || pendingWalSequence == 0) return true;
+    uint64_t sequence = pendingWalSequence;
+    pendingWalSequence = 0;
+    ProfiledPhase phase(profiler, "awaitDurability");
+    return wal->waitDurable(sequence);
+}
+
+void MemoryManager::logBlock(const MemoryBlock& block) {
+    uint32_t refs = refCounts[slotOf(block)];
+    allocTrace.record(TraceEvent::RefCount, block.id, 0, refs);
+    if (!replicationLog.active() && !wal) return;
+    memory_service::MutationRecord record;
+    record.set_type(memory_service::MUTATION_BLOCK);
+    record.set_id(block.id);
+    record.set_size(block.size);
+    record.set_block_type(blockTypeName(block.type));
+    record.set_ref_count(refs);
+    record.set_layout_id(block.layout);
+    record.set_alignment(block.alignment);
+    record.set_owner(block.owner);
+    record.set_region(block.region);
+    appendMutation(std::move(record));
+}
+
+void MemoryManager::logWrite(const MemoryBlock& block, size_t offset, size_t length) {
+    if (!replicationLog.active() && !wal) return;
+    memory_service::MutationRecord record;
+    record.set_type(memory_service::MUTATION_WRITE);
+    record.set_id(block.id);
+    record.set_offset(offset);
+    record.set_data(address(block) + offset, length);
+    appendMutation(std::move(record));
+}
+
+void MemoryManager::logLayout(uint32_t id, const TypeLayout& layout) {
+    if (!replicationLog.active() && !wal) return;
+    memory_service::MutationRecord record;
+    record.set_type(memory_service::MUTATION_LAYOUT);
+    record.set_layout_id(id);
+    record.set_shard_tag(shardTag);
+    record.set_block_type(layout.name);
+    record.set_size(layout.size);
+    for (uint32_t offset : layout.pointerOffsets) {
+        record.add_pointer_offsets(offset);
+    }
+    appendMutation(std::move(record));
+}
+
+void MemoryManager::logFree(uint32_t id) {
+    allocTrace.record(TraceEvent::Free, id);
+    if (!replicationLog.active() && !wal) return;
+    memory_service::MutationRecord record;
+    record.set_type(memory_service::MUTATION_FREE);
+    record.set_id(id);
+    appendMutation(std::move(record));
+}
+
+void MemoryManager::logReservation(uint32_t id, std::chrono::milliseconds lease) {
+    if (!replicationLog.active() && !wal) return;
+    memory_service::MutationRecord record;
+    record.set_type(lease.count() > 0 ? memory_service::MUTATION_RESERVE : memory_service::MUTATION_UNRESERVE);
+    record.set_id(id);
+    record.set_lease_ms(static_cast<uint32_t>(lease.count()));
+    appendMutation(std::move(record));
+}
+
+void MemoryManager::logSessionRef(uint64_t session, uint32_t id, int delta) {
+    if (!replicationLog.active() && !wal) return;
+    memory_service::MutationRecord record;
+    record.set_type(id != 0 ? memory_service::MUTATION_SESSION_REF : memory_service::MUTATION_SESSION_END);
+    record.set_session_id(session);
+    record.set_id(id);
+    record.set_delta(delta);
+    appendMutation(std::move(record));
+}
+
+void MemoryManager::logRegion(uint32_t id, const Region* region) {
+    if (!replicationLog.active() && !wal) return;
+    memory_service::MutationRecord record;
+    record.set_type(region ? memory_service::MUTATION_REGION_CREATE : memory_service::MUTATION_REGION_DESTROY);
+    record.set_id(id);
+    if (region) {
+        record.set_size(region->chunkSize);
+        record.set_session_id(region->session);
+    }
+    appendMutation(std::move(record));
+}
+
+bool MemoryManager::endReservation(uint32_t id) {
+    // Called with mutex held
+    if (reservations.erase(id) == 0) return false;
+    logReservation(id, std::chrono::milliseconds(0));
+    return true;
+}
+
+std::vector<memory_service::MutationRecord> MemoryManager::snapshotRecords() {
+    // Called with mutex held: the layouts and regions, then every live block
+    // with its contents
+    std::vector<memory_service::MutationRecord> records;
+    for (const auto& entry : layouts) {
+        memory_service::MutationRecord record;
+        record.set_type(memory_service::MUTATION_LAYOUT);
+        record.set_layout_id(entry.first);
+        record.set_shard_tag(shardTag);
+        record.set_block_type(entry.second.name);
+        record.set_size(entry.second.size);
+        for (uint32_t offset : entry.second.pointerOffsets) {
+            record.add_pointer_offsets(offset);
+        }
+        records.push_back(std::move(record));
+    }
+    // Regions come before their members, which are placed in their chunks
+    for (const auto& entry : regions) {
+        memory_service::MutationRecord record;
+        record.set_type(memory_service::MUTATION_REGION_CREATE);
+        record.set_id(entry.first);
+        record.set_size(entry.second.chunkSize);
+        record.set_session_id(entry.second.session);
+        records.push_back(std::move(record));
+    }
+    for (size_t slot = 0; slot < blocks.size(); ++slot) {
+        if (!isUsed(slot)) continue;
+        const MemoryBlock& block = blocks[slot];
+        memory_service::MutationRecord record;
+        record.set_type(memory_service::MUTATION_BLOCK);
+        record.set_id(block.id);
+        record.set_size(block.size);
+        record.set_block_type(blockTypeName(block.type));
+        record.set_ref_count(refCounts[slot]);
+        record.set_layout_id(block.layout);
+        record.set_alignment(block.alignment);
+        record.set_owner(block.owner);
+        record.set_region(block.region);
+        records.push_back(std::move(record));
+        record = memory_service::MutationRecord();
+        record.set_type(memory_service::MUTATION_WRITE);
+        record.set_id(block.id);
+        if (block.resident) {
+            record.set_data(address(block), block.size);
+        } else {
+            // Read spilled blocks in place rather than faulting them in
+            std::string data(block.size, '\0');
+            spill->read(block.spillSlot, &data[0], block.size);
+            record.set_data(std::move(data));
+        }
+        records.push_back(std::move(record));
     }
+    
+    // Then who owns the references: leases with the time they have left,
+    // and what each session holds
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& entry : reservations) {
+        memory_service::MutationRecord record;
+        record.set_type(memory_service::MUTATION_RESERVE);
+        record.set_id(entry.first);
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(entry.second - now);
+        record.set_lease_ms(static_cast<uint32_t>(std::max<int64_t>(left.count(), 1)));
+        records.push_back(std::move(record));
+    }
+    for (const auto& session : sessions) {
+        for (const auto& held : session.second.held) {
+            memory_service::MutationRecord record;
+            record.set_type(memory_service::MUTATION_SESSION_REF);
+            record.set_session_id(session.first);
+            record.set_id(held.first);
+            record.set_delta(static_cast<int32_t>(held.second));
+            records.push_back(std::move(record));
+        }
+    }
+    return records;
 }
 
-MemoryManager::~MemoryManager() {
-    stop();
-    if (memoryBlock) {
-        free(memoryBlock);
-    }
-}
-
-uint32_t MemoryManager::createBlock(size_t size, const std::string& type) {
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    // Find first fit
-    size_t currentOffset = 0;
-    for (const auto& block : blocks) {
-        if (!block.isUsed && block.size >= size) {
-            // Found a suitable block
-            MemoryBlock newBlock{
-                nextBlockId++,
-                size,
-                currentOffset,
-                type,
-                1,  // Initial ref count
-                true
-            };
-            blocks.push_back(newBlock);
-            dumpMemoryState();
-            return newBlock.id;
-        }
-        currentOffset += block.size;
-    }
-    
-    // No suitable block found, create at end if space available
-    if (currentOffset + size <= totalSize) {
-        MemoryBlock newBlock{
-            nextBlockId++,
-            size,
-            currentOffset,
-            type,
-            1,  // Initial ref count
-            true
-        };
-        blocks.push_back(newBlock);
-        dumpMemoryState();
-        return newBlock.id;
+bool MemoryManager::checkpoint() {
+    if (!wal) return false;
+    std::vector<memory_service::MutationRecord> snapshot;
+    uint64_t sequence;
+    {
+        ProfiledLock lock(mutex, profiler, __func__);
+        snapshot = snapshotRecords();
+        sequence = wal->mark();
     }
-    
-    // No space available
-    return -1;
+    // The file is written without holding up requests
+    return wal->writeCheckpoint(snapshot, sequence);
 }
 
-bool MemoryManager::setValue(uint32_t id, const void* value, size_t size) {
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    for (auto& block : blocks) {
-        if (block.id == id && block.isUsed) {
-            if (size > block.size) return false;
-            char* dest = static_cast<char*>(memoryBlock) + block.offset;
-            std::memcpy(dest, value, size);
-            dumpMemoryState();
-            return true;
+std::vector<memory_service::ReplicationBatch> MemoryManager::snapshotBatches(size_t maxRecords) {
+    // Called with mutex held
+    std::vector<memory_service::ReplicationBatch> batches(1);
+    batches.front().set_reset(true);
+    for (auto& record : snapshotRecords()) {
+        if (static_cast<size_t>(batches.back().records_size()) >= maxRecords) {
+            batches.emplace_back();
         }
+        *batches.back().add_records() = std::move(record);
     }
-    return false;
+    
+    // Only the last batch completes the snapshot
+    uint64_t sequence = replicationLog.lastSequence();
+    batches.back().set_sequence(sequence);
+    for (auto& batch : batches) {
+        batch.set_primary_sequence(sequence);
+        batch.set_log_id(replicationLog.id());
+    }
+    return batches;
 }
 
-bool MemoryManager::getValue(uint32_t id, void* value, size_t size) {
-    std::lock_guard<std::mutex> lock(mutex);
+void MemoryManager::startReplica(const std::string& address) {
+    primaryAddress = address;
+    replica = true;
+    following = true;
+    replicationThread = std::thread(&MemoryManager::followPrimary, this);
+}
+
+void MemoryManager::followPrimary() {
+    grpc::ChannelArguments args;
+    args.SetMaxReceiveMessageSize(-1);  // Snapshots carry whole blocks
+    auto channel = grpc::CreateCustomChannel(primaryAddress, grpc::InsecureChannelCredentials(), args);
+    auto stub = memory_service::MemoryManager::NewStub(channel);
     
-    for (const auto& block : blocks) {
-        if (block.id == id && block.isUsed) {
-            if (size > block.size) return false;
-            const char* src = static_cast<const char*>(memoryBlock) + block.offset;
-            std::memcpy(value, src, size);
-            return true;
+    while (following) {
+        grpc::ClientContext context;
+        {
+            std::lock_guard<std::mutex> lock(replicationContextMutex);
+            if (!following) break;
+            replicationContext = &context;
+        }
+        
+        memory_service::ReplicateRequest request;
+        {
+            ProfiledLock lock(mutex, profiler, __func__);
+            request.set_from_sequence(appliedSequence == 0 ? 0 : appliedSequence + 1);
+            request.set_log_id(appliedLogId);
+        }
+        
+        auto reader = stub->Replicate(&context, request);
+        memory_service::ReplicationBatch batch;
+        while (reader->Read(&batch)) {
+            applyBatch(batch);
+        }
+        grpc::Status status = reader->Finish();
+        
+        {
+            std::lock_guard<std::mutex> lock(replicationContextMutex);
+            replicationContext = nullptr;
+        }
+        if (following) {
+            MP_LOG_WARN("Replication from " << primaryAddress << " interrupted: "
+                     << status.error_message() << ", retrying");
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
         }
     }
-    return false;
 }
 
-bool MemoryManager::increaseRefCount(uint32_t id) {
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    for (auto& block : blocks) {
-        if (block.id == id && block.isUsed) {
-            block.refCount++;
-            dumpMemoryState();
-            return true;
+void MemoryManager::stopFollowing() {
+    {
+        std::lock_guard<std::mutex> lock(replicationContextMutex);
+        following = false;
+        if (replicationContext) {
+            replicationContext->TryCancel();
         }
     }
-    return false;
+    if (replicationThread.joinable()) {
+        replicationThread.join();
+    }
 }
 
-bool MemoryManager::decreaseRefCount(uint32_t id) {
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    for (auto& block : blocks) {
-        if (block.id == id && block.isUsed) {
-            if (block.refCount > 0) {
-                block.refCount--;
-                dumpMemoryState();
-                return true;
+void MemoryManager::applyMutation(const memory_service::MutationRecord& record) {
+    // Called with mutex held, for replication and WAL replay alike
+    uint32_t id = static_cast<uint32_t>(record.id());
+    MemoryBlock* block = findBlock(id);
+    switch (record.type()) {
+        case memory_service::MUTATION_BLOCK: {
+            if (block) {
+                refCount(*block) = record.ref_count();
+                if (block->owner != record.owner()) {
+                    accountBlock(*block, -1);
+                    block->owner = record.owner();
+                    accountBlock(*block, +1);
+                }
+                break;
+            }
+            // Records written before alignment existed carry 0
+            size_t alignment = validAlignment(record.alignment()) ? std::max<size_t>(record.alignment(), 1) : 1;
+            // Region members go back into chunks of their region
+            auto region = regions.find(record.region());
+            Region* owner = record.region() != 0 && region != regions.end() ? &region->second : nullptr;
+            uint32_t segment;
+            size_t offset = owner ? regionOffset(*owner, record.size(), alignment, segment)
+                                  : allocateOffset(record.size(), alignment, segment);
+            if (offset == kNoSpace) {
+                MP_LOG_ERROR("Not enough memory to restore block " << id);
+                break;
             }
+            MemoryBlock restored{id, segment, record.size(), offset};
+            restored.type = blockType(record.block_type());
+            restored.layout = record.layout_id();
+            restored.alignment = static_cast<uint16_t>(alignment);
+            restored.owner = record.owner();
+            restored.region = owner ? record.region() : 0;
+            addBlock(restored, record.ref_count());
+            if (owner) {
+                owner->blocks.push_back(id);
+            }
+            nextBlockId = std::max(nextBlockId, id + 1);
+            break;
+        }
+        case memory_service::MUTATION_LAYOUT:
+            layouts[record.layout_id()] = TypeLayout{record.block_type(), record.size(),
+                                                     {record.pointer_offsets().begin(),
+                                                      record.pointer_offsets().end()}};
+            if (record.shard_tag() != 0) {
+                shardTag = record.shard_tag();
+            }
+            break;
+        case memory_service::MUTATION_WRITE:
+            if (block && record.offset() <= block->size &&
+                record.data().size() <= block->size - record.offset()) {
+                char* data = blockData(*block);
+                if (data) {
+                    std::memcpy(data + record.offset(), record.data().data(), record.data().size());
+                }
+            }
+            break;
+        case memory_service::MUTATION_FREE:
+            if (block) {
+                freeBlock(*block);
+            }
+            break;
+        case memory_service::MUTATION_RESERVE:
+            // The lease restarts here: the client may still claim the block
+            reservations[id] = std::chrono::steady_clock::now() + std::chrono::milliseconds(record.lease_ms());
+            break;
+        case memory_service::MUTATION_UNRESERVE:
+            reservations.erase(id);
+            break;
+        case memory_service::MUTATION_SESSION_REF: {
+            // A recovered session gets a full lease to come back and renew it
+            auto session = sessions.find(record.session_id());
+            if (session == sessions.end()) {
+                session = sessions.emplace(record.session_id(), Session()).first;
+                session->second.expiry = std::chrono::steady_clock::now() + session->second.lease;
+            }
+            int64_t held = static_cast<int64_t>(session->second.held[id]) + record.delta();
+            if (held > 0) {
+                session->second.held[id] = static_cast<uint32_t>(held);
+            } else {
+                session->second.held.erase(id);
+            }
+            break;
         }
+        case memory_service::MUTATION_SESSION_END:
+            sessions.erase(record.session_id());
+            break;
+        case memory_service::MUTATION_REGION_CREATE:
+            regions[id] = Region{record.size(), record.session_id(), {}, {}};
+            nextRegionId = std::max(nextRegionId, id + 1);
+            break;
+        case memory_service::MUTATION_REGION_DESTROY:
+            releaseRegion(id);
+            break;
+        default:
+            break;
     }
-    return false;
 }
 
-void MemoryManager::defragment() {
-    std::lock_guard<std::mutex> lock(mutex);
+void MemoryManager::applyBatch(const memory_service::ReplicationBatch& batch) {
+    ProfiledLock lock(mutex, profiler, __func__);
     
-    // Sort blocks by offset
-    std::sort(blocks.begin(), blocks.end(), 
-              [](const MemoryBlock& a, const MemoryBlock& b) {
-                  return a.offset < b.offset;
-              });
+    if (batch.reset()) {
+        clearBlocks();
+        usage.clear();
+        layouts.clear();
+        shardTag = 0;
+        reservations.clear();
+        sessions.clear();
+        regions.clear();
+        nextRegionId = 1;
+        resetArena();
+        appliedSequence = 0;
+        appliedLogId = batch.log_id();
+    }
     
-    size_t newOffset = 0;
-    for (auto& block : blocks) {
-        if (block.isUsed) {
-            if (block.offset != newOffset) {
-                // Move memory
-                char* src = static_cast<char*>(memoryBlock) + block.offset;
-                char* dest = static_cast<char*>(memoryBlock) + newOffset;
-                std::memmove(dest, src, block.size);
-                block.offset = newOffset;
-            }
-            newOffset += block.size;
-        }
+    for (const auto& record : batch.records()) {
+        applyMutation(record);
     }
     
-    dumpMemoryState();
+    if (batch.sequence() != 0) {
+        appliedSequence = batch.sequence();
+        appliedLogId = batch.log_id();
+    }
+    // An idle primary keeps sending empty batches (sequence 0); they show
+    // the replica is still in sync just as well as a batch of records
+    if (batch.log_id() == appliedLogId && appliedSequence >= batch.primary_sequence()) {
+        caughtUpAtMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    if (batch.records_size() > 0) {
+        dumpMemoryState();
+    }
+}
+
+bool MemoryManager::withinStaleness(uint32_t maxStalenessMs) const {
+    int64_t caughtUp = caughtUpAtMs.load();
+    if (caughtUp == 0) return false;
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return now - caughtUp <= static_cast<int64_t>(maxStalenessMs);
+}
+
+bool MemoryManager::promote() {
+    if (!isReplica()) return false;
+    stopFollowing();
+    
+    ProfiledLock lock(mutex, profiler, __func__);
+    // New history: backups of this node start from a snapshot
+    replicationLog.reset(appliedSequence);
+    replica = false;
+    // Clients heartbeated the old primary; give them a full lease here
+    auto now = std::chrono::steady_clock::now();
+    for (auto& session : sessions) {
+        session.second.expiry = now + session.second.lease;
+    }
+    return true;
 }
 
 void MemoryManager::dumpMemoryState() {
+    if (!dumpsEnabled.load(std::memory_order_relaxed)) return;
+    ProfiledPhase phase(profiler, "dumpMemoryState");
+    
     auto now = std::chrono::system_clock::now();
     auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         now.time_since_epoch()
@@ -203,20 +2059,32 @@ void MemoryManager::dumpMemoryState() {
     
     dump << "Memory State Dump\n";
     dump << "Total Size: " << totalSize << " bytes\n";
+    dump << "Committed: " << committedSize << " bytes in " << segments.size() << " segments\n";
+    if (spill) {
+        dump << "Spilled: " << spill->used() << " bytes\n";
+    }
     dump << "Blocks:\n";
     
-    for (const auto& block : blocks) {
+    for (size_t slot = 0; slot < blocks.size(); ++slot) {
+        const MemoryBlock& block = blocks[slot];
+        bool used = isUsed(slot);
         dump << "ID: " << block.id
-             << ", Type: " << block.type
+             << ", Type: " << blockTypeName(block.type)
              << ", Size: " << block.size
+             << ", Segment: " << block.segment
              << ", Offset: " << block.offset
-             << ", RefCount: " << block.refCount
-             << ", Used: " << (block.isUsed ? "Yes" : "No")
-             << "\n";
+             << ", RefCount: " << refCounts[slot]
+             << ", Used: " << (used ? "Yes" : "No");
+        if (used && !block.resident) {
+            dump << ", Spilled: Yes";
+        } else if (used && sharedStorage.count(storage(block))) {
+            dump << ", Shared: Yes";
+        }
+        dump << "\n";
              
-        if (block.isUsed) {
+        if (used && block.resident) {
             dump << "Content (hex): ";
-            const unsigned char* data = static_cast<const unsigned char*>(memoryBlock) + block.offset;
+            const unsigned char* data = reinterpret_cast<const unsigned char*>(address(block));
             for (size_t i = 0; i < block.size && i < 32; ++i) {
                 dump << std::hex << std::setw(2) << std::setfill('0')
                      << static_cast<int>(data[i]) << " ";
@@ -228,13 +2096,10 @@ void MemoryManager::dumpMemoryState() {
     }
 }
 
-// GRPC Service Implementation
-grpc::Status MemoryManager::Create(grpc::ServerContext* context,
-                                  const memory_service::CreateRequest* request,
-                                  memory_service::CreateResponse* response) {
-    // Convertir el enum DataType a string
+// Convertir el enum DataType a string
+static std::string typeName(memory_service::DataType type) {
     std::string type_str;
-    switch (request->type()) {
+    switch (type) {
         case memory_service::INT:
             type_str = "INT";
             break;
@@ -256,8 +2121,41 @@ grpc::Status MemoryManager::Create(grpc::ServerContext* context,
         default:
             type_str = "UNKNOWN";
     }
+    return type_str;
+}
+
+// Backups only take writes through the replication stream
+template<typename Response>
+static grpc::Status rejectOnReplica(Response* response) {
+    response->set_success(false);
+    response->set_error_message("Backup is read-only; send writes to the primary");
+    return grpc::Status::OK;
+}
+
+// Acknowledged writes must survive a crash when the WAL is on
+template<typename Response>
+static grpc::Status rejectNotDurable(Response* response) {
+    response->set_success(false);
+    response->set_error_message("Write-ahead log failed; the change may not survive a restart");
+    return grpc::Status::OK;
+}
+
+// GRPC Service Implementation
+grpc::Status MemoryManager::Create(grpc::ServerContext* context,
+                                  const memory_service::CreateRequest* request,
+                                  memory_service::CreateResponse* response) {
+    RpcScope<memory_service::CreateResponse> scope(stats, profiler, ServerStats::Create, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    if (!validAlignment(request->alignment())) {
+        response->set_success(false);
+        response->set_error_message("Alignment must be a power of two up to 4096");
+        return grpc::Status::OK;
+    }
     
-    uint32_t id = createBlock(request->size(), type_str);
+    uint32_t id = createBlock(request->size(), typeName(request->type()), request->layout_id(),
+                              request->session_id(), static_cast<uint32_t>(request->region_id()),
+                              request->alignment());
     
     response->set_success(id != -1);
     if (id != -1) {
@@ -266,12 +2164,17 @@ grpc::Status MemoryManager::Create(grpc::ServerContext* context,
         response->set_error_message("Failed to allocate memory block");
     }
     
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
     return grpc::Status::OK;
 }
 
 grpc::Status MemoryManager::Set(grpc::ServerContext* context,
                                const memory_service::SetRequest* request,
                                memory_service::SetResponse* response) {
+    RpcScope<memory_service::SetResponse> scope(stats, profiler, ServerStats::Set, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
     bool success = setValue(request->id(),
                            request->value().data(),
                            request->value().size());
@@ -281,21 +2184,30 @@ grpc::Status MemoryManager::Set(grpc::ServerContext* context,
         response->set_error_message("Failed to set value");
     }
     
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
     return grpc::Status::OK;
 }
 
 grpc::Status MemoryManager::Get(grpc::ServerContext* context,
                                const memory_service::GetRequest* request,
                                memory_service::GetResponse* response) {
+    RpcScope<memory_service::GetResponse> scope(stats, profiler, ServerStats::Get, response);
+    // Bounded-staleness reads from a backup
+    if (request->max_staleness_ms() > 0 && isReplica() && !withinStaleness(request->max_staleness_ms())) {
+        response->set_success(false);
+        response->set_error_message("Backup is too far behind the primary");
+        return grpc::Status::OK;
+    }
+    
     // Find block size first
     size_t size = 0;
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        for (const auto& block : blocks) {
-            if (block.id == request->id() && block.isUsed) {
-                size = block.size;
-                break;
-            }
+        ProfiledLock lock(mutex, profiler, __func__);
+        ProfiledPhase phase(profiler, "lookup");
+        MemoryBlock* block = findBlock(static_cast<uint32_t>(request->id()));
+        if (block) {
+            size = block->size;
         }
     }
     
@@ -310,6 +2222,7 @@ grpc::Status MemoryManager::Get(grpc::ServerContext* context,
     
     response->set_success(success);
     if (success) {
+        ProfiledPhase phase(profiler, "serialize");
         response->set_value(buffer.data(), size);
     } else {
         response->set_error_message("Failed to get value");
@@ -321,26 +2234,331 @@ grpc::Status MemoryManager::Get(grpc::ServerContext* context,
 grpc::Status MemoryManager::IncreaseRefCount(grpc::ServerContext* context,
                                            const memory_service::RefCountRequest* request,
                                            memory_service::RefCountResponse* response) {
-    bool success = increaseRefCount(request->id());
+    RpcScope<memory_service::RefCountResponse> scope(stats, profiler, ServerStats::IncreaseRefCount, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    bool success = increaseRefCount(request->id(), request->session_id());
     
     response->set_success(success);
     if (!success) {
         response->set_error_message("Failed to increase reference count");
     }
     
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
     return grpc::Status::OK;
 }
 
 grpc::Status MemoryManager::DecreaseRefCount(grpc::ServerContext* context,
                                            const memory_service::RefCountRequest* request,
                                            memory_service::RefCountResponse* response) {
-    bool success = decreaseRefCount(request->id());
+    RpcScope<memory_service::RefCountResponse> scope(stats, profiler, ServerStats::DecreaseRefCount, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    bool success = decreaseRefCount(request->id(), request->session_id());
     
     response->set_success(success);
     if (!success) {
         response->set_error_message("Failed to decrease reference count");
     }
     
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::UpdateRefCounts(grpc::ServerContext* context,
+                                           const memory_service::RefCountBatchRequest* request,
+                                           memory_service::RefCountBatchResponse* response) {
+    RpcScope<memory_service::RefCountBatchResponse> scope(stats, profiler, ServerStats::UpdateRefCounts, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    size_t claimed = claimReservations(request->claim_ids().data(), request->claim_ids_size(),
+                                       request->session_id());
+    size_t applied = decreaseRefCounts(request->decrease_ids().data(),
+                                       request->decrease_ids_size(), request->session_id());
+    
+    response->set_applied(static_cast<uint32_t>(applied));
+    response->set_claimed(static_cast<uint32_t>(claimed));
+    response->set_success(applied == static_cast<size_t>(request->decrease_ids_size()));
+    if (!response->success()) {
+        response->set_error_message("Some reference counts could not be decreased");
+    }
+    
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::Reserve(grpc::ServerContext* context,
+                                   const memory_service::ReserveRequest* request,
+                                   memory_service::ReserveResponse* response) {
+    RpcScope<memory_service::ReserveResponse> scope(stats, profiler, ServerStats::Reserve, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    // Bounded so a single client cannot pin the arena for long
+    constexpr uint32_t kDefaultLeaseMs = 30000;
+    constexpr uint32_t kMaxLeaseMs = 600000;
+    constexpr uint32_t kMaxCount = 4096;
+    
+    uint32_t leaseMs = request->lease_ms() == 0 ? kDefaultLeaseMs
+                                                : std::min(request->lease_ms(), kMaxLeaseMs);
+    uint32_t count = std::min(request->count(), kMaxCount);
+    
+    if (!validAlignment(request->alignment())) {
+        response->set_success(false);
+        response->set_error_message("Alignment must be a power of two up to 4096");
+        return grpc::Status::OK;
+    }
+    
+    std::vector<uint32_t> ids = reserveBlocks(request->size(), typeName(request->type()), count,
+                                              std::chrono::milliseconds(leaseMs), request->layout_id(),
+                                              request->alignment());
+    
+    response->set_success(!ids.empty());
+    if (!ids.empty()) {
+        for (uint32_t id : ids) {
+            response->add_ids(id);
+        }
+        response->set_lease_ms(leaseMs);
+    } else {
+        response->set_error_message("Failed to reserve memory blocks");
+    }
+    
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::Compute(grpc::ServerContext* context,
+                                   const memory_service::ComputeRequest* request,
+                                   memory_service::ComputeResponse* response) {
+    RpcScope<memory_service::ComputeResponse> scope(stats, profiler, ServerStats::Compute, response);
+    const bool writes = request->op() == memory_service::SCALE || request->op() == memory_service::FILL ||
+                        request->op() == memory_service::ADD;
+    if (writes && isReplica()) return rejectOnReplica(response);
+    
+    double result = 0;
+    int64_t intResult = 0;
+    std::string error;
+    bool success = compute(request->op(), request->id(), request->other_id(),
+                           request->scalar(), result, intResult, error);
+
+    response->set_success(success);
+    if (success) {
+        response->set_result(result);
+        response->set_int_result(intResult);
+    } else {
+        response->set_error_message("Failed to compute: " + error);
+    }
+
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::Copy(grpc::ServerContext* context,
+                                const memory_service::CopyRequest* request,
+                                memory_service::CopyResponse* response) {
+    RpcScope<memory_service::CopyResponse> scope(stats, profiler, ServerStats::Copy, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    bool success = copyRange(request->src_id(), request->src_offset(),
+                             request->dst_id(), request->dst_offset(),
+                             request->length());
+    
+    response->set_success(success);
+    if (!success) {
+        response->set_error_message("Failed to copy: blocks must exist and the range must fit both");
+    }
+    
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::Clone(grpc::ServerContext* context,
+                                 const memory_service::CloneRequest* request,
+                                 memory_service::CloneResponse* response) {
+    RpcScope<memory_service::CloneResponse> scope(stats, profiler, ServerStats::Clone, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    uint32_t id = cloneBlock(request->id(), request->copy_on_write(), request->session_id());
+    
+    response->set_success(id != static_cast<uint32_t>(-1));
+    if (id != static_cast<uint32_t>(-1)) {
+        response->set_id(id);
+    } else {
+        response->set_error_message("Failed to clone memory block");
+    }
+    
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::Replicate(grpc::ServerContext* context,
+                                     const memory_service::ReplicateRequest* request,
+                                     grpc::ServerWriter<memory_service::ReplicationBatch>* writer) {
+    constexpr size_t kMaxRecordsPerBatch = 1024;
+    constexpr auto kHeartbeat = std::chrono::milliseconds(100);
+    
+    if (isReplica()) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Backups do not serve replication");
+    }
+    
+    // Resume from the log when it still holds what the backup needs,
+    // otherwise start over with a snapshot
+    uint64_t next = request->from_sequence();
+    std::vector<memory_service::ReplicationBatch> snapshot;
+    {
+        ProfiledLock lock(mutex, profiler, __func__);
+        replicationLog.activate();
+        memory_service::ReplicationBatch probe;
+        bool resumable = next != 0 && request->log_id() == replicationLog.id() &&
+                         next <= replicationLog.lastSequence() + 1 &&
+                         replicationLog.read(next, 0, probe);
+        if (!resumable) {
+            snapshot = snapshotBatches(kMaxRecordsPerBatch);
+            next = replicationLog.lastSequence() + 1;
+        }
+    }
+    for (const auto& batch : snapshot) {
+        if (!writer->Write(batch)) return grpc::Status::OK;
+    }
+    
+    // Records as they are logged; an empty batch every heartbeat otherwise
+    while (!context->IsCancelled() && !replicationLog.closed()) {
+        replicationLog.waitFor(next, kHeartbeat);
+        memory_service::ReplicationBatch batch;
+        if (!replicationLog.read(next, kMaxRecordsPerBatch, batch)) {
+            return grpc::Status(grpc::StatusCode::ABORTED, "Backup fell behind the replication log");
+        }
+        next += batch.records_size();
+        batch.set_sequence(next - 1);
+        if (!writer->Write(batch)) break;
+    }
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::Promote(grpc::ServerContext* context,
+                                   const memory_service::PromoteRequest* request,
+                                   memory_service::PromoteResponse* response) {
+    RpcScope<memory_service::PromoteResponse> scope(stats, profiler, ServerStats::Promote, response);
+    bool success = promote();
+    
+    response->set_success(success);
+    if (success) {
+        response->set_sequence(replicationLog.lastSequence());
+    } else {
+        response->set_error_message("Server is already a primary");
+    }
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::RegisterTypeLayout(grpc::ServerContext* context,
+                                              const memory_service::RegisterTypeLayoutRequest* request,
+                                              memory_service::RegisterTypeLayoutResponse* response) {
+    RpcScope<memory_service::RegisterTypeLayoutResponse> scope(stats, profiler, ServerStats::RegisterTypeLayout, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    std::string error;
+    std::vector<uint32_t> offsets(request->pointer_offsets().begin(), request->pointer_offsets().end());
+    uint32_t id = registerLayout(request->name(), request->size(), offsets, request->shard_tag(), error);
+    
+    response->set_success(id != 0);
+    if (id != 0) {
+        response->set_layout_id(id);
+    } else {
+        response->set_error_message(error);
+    }
+    
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::Heartbeat(grpc::ServerContext* context,
+                                     const memory_service::HeartbeatRequest* request,
+                                     memory_service::HeartbeatResponse* response) {
+    RpcScope<memory_service::HeartbeatResponse> scope(stats, profiler, ServerStats::Heartbeat, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    if (request->session_id() == 0) {
+        response->set_success(false);
+        response->set_error_message("Session id 0 is reserved");
+        return grpc::Status::OK;
+    }
+    
+    auto lease = heartbeat(request->session_id(), std::chrono::milliseconds(request->lease_ms()),
+                           request->resume());
+    if (lease.count() == 0) {
+        response->set_success(false);
+        response->set_expired(true);
+        response->set_error_message("Session expired; its references were dropped");
+        return grpc::Status::OK;
+    }
+    response->set_lease_ms(static_cast<uint32_t>(lease.count()));
+    response->set_success(true);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::CreateRegion(grpc::ServerContext* context,
+                                        const memory_service::CreateRegionRequest* request,
+                                        memory_service::CreateRegionResponse* response) {
+    RpcScope<memory_service::CreateRegionResponse> scope(stats, profiler, ServerStats::CreateRegion, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    uint32_t id = createRegion(request->chunk_size(), request->session_id());
+    response->set_success(id != 0);
+    if (id != 0) {
+        response->set_region_id(id);
+    } else {
+        response->set_error_message("Failed to create region");
+    }
+    
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::DestroyRegion(grpc::ServerContext* context,
+                                         const memory_service::DestroyRegionRequest* request,
+                                         memory_service::DestroyRegionResponse* response) {
+    RpcScope<memory_service::DestroyRegionResponse> scope(stats, profiler, ServerStats::DestroyRegion, response);
+    if (isReplica()) return rejectOnReplica(response);
+    
+    size_t freed = 0;
+    bool success = destroyRegion(static_cast<uint32_t>(request->region_id()), freed);
+    response->set_success(success);
+    if (success) {
+        response->set_freed(static_cast<uint32_t>(freed));
+    } else {
+        response->set_error_message("Region not found");
+    }
+    
+    if (!awaitDurability()) return rejectNotDurable(response);
+    
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::GetStats(grpc::ServerContext* context,
+                                    const memory_service::GetStatsRequest* request,
+                                    memory_service::GetStatsResponse* response) {
+    RpcScope<memory_service::GetStatsResponse> scope(stats, profiler, ServerStats::GetStats, response);
+    collectStats(*response);
+    response->set_success(true);
+    return grpc::Status::OK;
+}
+
+grpc::Status MemoryManager::GetUsage(grpc::ServerContext* context,
+                                    const memory_service::GetUsageRequest* request,
+                                    memory_service::GetUsageResponse* response) {
+    RpcScope<memory_service::GetUsageResponse> scope(stats, profiler, ServerStats::GetUsage, response);
+    collectUsage(*request, *response);
+    response->set_success(true);
     return grpc::Status::OK;
 }
 
@@ -361,17 +2579,42 @@ void MemoryManager::GarbageCollector::stop() {
 }
 
 void MemoryManager::GarbageCollector::run() {
+    // Wakes often so cycle collection advances in small slices; the
+    // reference count pass still runs once per interval
+    constexpr auto kTick = std::chrono::milliseconds(10);
+    auto lastPass = std::chrono::steady_clock::now();
     while (running) {
-        std::this_thread::sleep_for(interval);
-        std::lock_guard<std::mutex> lock(manager->mutex);
+        std::this_thread::sleep_for(kTick);
+        auto now = std::chrono::steady_clock::now();
+        bool pass = now - lastPass >= interval;
+        {
+            ProfiledLock lock(manager->mutex, manager->profiler, "collector");
+            manager->rollUsage(now);
+            
+            // A backup frees blocks only when the primary's log says so
+            if (manager->isReplica()) continue;
+            
+            if (pass) {
+                lastPass = now;
+                auto passStart = std::chrono::steady_clock::now();
+                
+                // Reservations and sessions past their lease give up their references
+                manager->expireReservations();
+                manager->expireSessions();
+                
+                size_t freed = manager->sweepUnreferenced();
+                manager->stats.recordGcPass(std::chrono::steady_clock::now() - passStart, freed);
+            }
+            
+            manager->traceStep(now);
+        }
         
-        // Check for blocks with zero references
-        for (auto it = manager->blocks.begin(); it != manager->blocks.end();) {
-            if (it->isUsed && it->refCount == 0) {
-                it->isUsed = false;
-                manager->dumpMemoryState();
+        // Periodic checkpoints keep the WAL short
+        if (manager->wal && now - manager->lastCheckpoint >= manager->checkpointInterval) {
+            if (!manager->checkpoint()) {
+                MP_LOG_ERROR("WAL: checkpoint failed");
             }
-            ++it;
+            manager->lastCheckpoint = now;
         }
     }
-}
\ No newline at end of file
+}
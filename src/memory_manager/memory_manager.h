@@ -3,22 +3,38 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 #include <memory>
 #include <thread>
 #include <chrono>
 #include <fstream>
 #include <filesystem>
+#include <atomic>
 #include <grpcpp/grpcpp.h>
 #include "memory_service.grpc.pb.h"
+#include "replication_log.h"
+#include "write_ahead_log.h"
+#include "spill_file.h"
+#include "alloc_trace.h"
+#include "server_stats.h"
+#include "metrics_server.h"
 
 class MemoryManager : public memory_service::MemoryManager::Service {
 public:
     // Singleton pattern
     static MemoryManager* getInstance();
 
-    // Initialize memory manager
-    bool initialize(uint16_t port, size_t memSize, const std::string& dumpFolder);
+    // Initialize memory manager; with a WAL enabled, the state logged in
+    // dumpFolder/wal is recovered first. A non-zero spillSize lets cold
+    // blocks move to dumpFolder/spill.bin when the arena is full. The arena
+    // grows in segments of segmentSize bytes up to memSize.
+    static constexpr size_t kDefaultSegmentSize = 4 * 1024 * 1024;
+    bool initialize(uint16_t port, size_t memSize, const std::string& dumpFolder,
+                    const WalOptions& walOptions = WalOptions(), size_t spillSize = 0,
+                    size_t segmentSize = kDefaultSegmentSize);
 
     // Server management
     void setServer(std::unique_ptr<grpc::Server> srv);
@@ -26,31 +42,165 @@ public:
     void start();
     void stop();
 
-    // Memory block management
-    uint32_t createBlock(size_t size, const std::string& type);
+    // Memory block management. A non-zero session records who holds the
+    // reference, so it can be dropped if that client stops heartbeating.
+    // Block addresses are multiples of `alignment`: a power of two up to
+    // kMaxAlignment, or 0 (like 1) to pack the block anywhere.
+    static constexpr size_t kMaxAlignment = 4096;
+    static bool validAlignment(size_t alignment) {
+        return alignment <= kMaxAlignment && (alignment & (alignment - 1)) == 0;
+    }
+    uint32_t createBlock(size_t size, const std::string& type, uint32_t layoutId = 0, uint64_t session = 0,
+                         uint32_t region = 0, size_t alignment = 0);
     bool setValue(uint32_t id, const void* value, size_t size);
     bool getValue(uint32_t id, void* value, size_t size);
-    bool increaseRefCount(uint32_t id);
-    bool decreaseRefCount(uint32_t id);
+    bool increaseRefCount(uint32_t id, uint64_t session = 0);
+    bool decreaseRefCount(uint32_t id, uint64_t session = 0);
+    size_t decreaseRefCounts(const uint64_t* ids, size_t count, uint64_t session = 0);
+
+    // Reservations: blocks handed to a client ahead of use. Unclaimed ones
+    // are freed by the GC once their lease expires.
+    std::vector<uint32_t> reserveBlocks(size_t size, const std::string& type, size_t count,
+                                        std::chrono::milliseconds lease, uint32_t layoutId = 0,
+                                        size_t alignment = 0);
+    size_t claimReservations(const uint64_t* ids, size_t count, uint64_t session = 0);
+    void expireReservations();
     void defragment();
+    // One reference-count pass, as the collector runs each interval;
+    // returns the blocks freed
+    size_t collectGarbage();
     void dumpMemoryState();
 
+    // Dumps are on by default; every mutation writes a full state file,
+    // which dominates the cost of each operation on large tables
+    void setDumps(bool enabled) { dumpsEnabled.store(enabled, std::memory_order_relaxed); }
+
+    // Allocation trace (mem-mgr --trace): creates, reference count changes,
+    // frees, compactions and regions go to a binary file for mem-replay.
+    // stop() ends the trace as well.
+    bool startTrace(const std::string& path);
+    void stopTrace();
+
+    // Request profile (mem-mgr --profile): lock wait and hold per call
+    // site, handler phases and the slowest requests. stopProfile() writes
+    // the Chrome trace file and prints a summary; stop() calls it.
+    bool startProfile(const std::string& path, size_t slowest = RequestProfiler::kDefaultSlowest);
+    void stopProfile();
+
+    // Arena occupancy. Fragmentation is the share of free space outside
+    // the largest free extent: 0 when all of it is one run.
+    struct ArenaStats {
+        size_t committed = 0;     // Bytes held by live segments
+        size_t segments = 0;
+        size_t liveBlocks = 0;
+        size_t liveBytes = 0;     // Sizes of resident blocks
+        size_t freeBytes = 0;     // Holes plus space above each segment's top
+        size_t largestFree = 0;
+        size_t metadataBytes = 0; // Block tables, not counting the id index
+        double fragmentation() const {
+            return freeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(largestFree) / freeBytes;
+        }
+    };
+    ArenaStats arenaStats();
+
+    // Everything GetStats reports. Request counters are summed from
+    // per-thread slabs here; block tables are walked here too, so the
+    // request path pays nothing for them.
+    void collectStats(memory_service::GetStatsResponse& response);
+
+    // GetUsage: the top consumers by session and type, from counters kept
+    // up to date as blocks come and go rather than a walk of the table
+    void collectUsage(const memory_service::GetUsageRequest& request, memory_service::GetUsageResponse& response);
+
+    // Serves the same metrics as Prometheus text on localhost:port
+    bool startMetrics(uint16_t port);
+
+    // Frees a block at once, whatever its reference count; mem-replay
+    // uses it to free blocks when the trace says the GC did
+    bool releaseBlock(uint32_t id);
+
+    // Type layouts name the 8-byte fields of a block that hold ids of other
+    // blocks. Each such link owns one reference on its target, which the
+    // server takes and drops as the block is written, cloned and freed.
+    // A sharded client also passes the tag it puts in this server's ids,
+    // so links tagged with it count and links to other shards do not.
+    // Returns the layout id (derived from the name), or 0 with an error.
+    uint32_t registerLayout(const std::string& name, size_t size, const std::vector<uint32_t>& pointerOffsets,
+                            uint32_t shardTag, std::string& error);
+
+    // Cycle collection: every `interval` the GC starts an incremental
+    // mark-sweep that frees blocks unreachable from outside references,
+    // running at most `budget` per 10 ms slice
+    void setCycleCollection(std::chrono::milliseconds interval, std::chrono::microseconds budget);
+
+    // Writes a WAL checkpoint and drops the log segments it covers
+    bool checkpoint();
+
+    // Numeric kernels over INT/FLOAT/DOUBLE blocks (see simd_kernels.h);
+    // on failure `error` says why
+    bool compute(memory_service::ComputeOp op, uint32_t id, uint32_t otherId,
+                 double scalar, double& result, int64_t& intResult, std::string& error);
+
+    // Server-side block duplication
+    bool copyRange(uint32_t srcId, size_t srcOffset, uint32_t dstId, size_t dstOffset, size_t length);
+    uint32_t cloneBlock(uint32_t id, bool copyOnWrite, uint64_t session = 0);
+
+    // Client sessions: opens or renews `session` for `lease` (0 selects the
+    // default) and returns the lease granted. The GC drops every reference
+    // of a session that misses its lease. With `resume`, an unknown session
+    // is not reopened: 0 is returned, as its references are already gone.
+    static constexpr std::chrono::milliseconds kDefaultSessionLease{10000};
+    std::chrono::milliseconds heartbeat(uint64_t session, std::chrono::milliseconds lease, bool resume = false);
+
+    // Regions: blocks created in a region are bump-allocated from chunks of
+    // chunkSize bytes (0 selects the default) and live until the whole
+    // region is destroyed, whatever their reference counts. A region owned
+    // by a session goes away with it. createRegion returns 0 on failure.
+    // Chunks start on kMaxAlignment so members stay aligned when one moves.
+    static constexpr size_t kDefaultRegionChunk = 64 * 1024;
+    uint32_t createRegion(size_t chunkSize, uint64_t session = 0);
+    bool destroyRegion(uint32_t region, size_t& freed);
+
+    // Replication: a backup mirrors the primary at primaryAddress through
+    // the Replicate stream and serves reads only, until it is promoted
+    void startReplica(const std::string& primaryAddress);
+    bool promote();
+    bool isReplica() const { return replica.load(std::memory_order_acquire); }
+
     ~MemoryManager();
 
     // Block structure
+    // Block descriptors. Reference counts and the used bitmap live apart,
+    // in dense arrays indexed by the same position as `blocks` (see
+    // refCount() and isUsed()), so passes over every block read 4 bytes and
+    // a bit per block and only touch descriptors of the blocks they act on.
     struct MemoryBlock {
         uint32_t id;
+        uint32_t segment;          // Arena segment, and the offset within it
         size_t size;
         size_t offset;
-        std::string type;
-        uint32_t refCount;
-        bool isUsed;
+        size_t spillSlot = 0;
+        uint64_t owner = 0;        // Session that created (or claimed) it, 0 for none
+        uint32_t layout = 0;       // Registered type layout, 0 for none
+        uint32_t region = 0;       // Region owning the storage, 0 for none
+        uint16_t alignment = 1;    // Of the address; kept when the block moves
+        uint8_t type = memory_service::CUSTOM;  // memory_service::DataType
+        bool resident = true;      // False while the contents live in the spill file
+        bool referenced = true;    // CLOCK bit, set on every access to the contents
+        bool pinned = false;       // Used by the current operation; never evicted
     };
+    static uint8_t blockType(const std::string& name);
+    static const std::string& blockTypeName(uint8_t type);
 
     // Made public to allow GC and service impl access
     std::mutex mutex;
     std::vector<MemoryBlock> blocks;
 
+    size_t slotOf(const MemoryBlock& block) const { return static_cast<size_t>(&block - blocks.data()); }
+    uint32_t& refCount(const MemoryBlock& block) { return refCounts[slotOf(block)]; }
+    bool isUsed(size_t slot) const { return (usedBits[slot / 64] >> (slot % 64)) & 1; }
+    bool isUsed(const MemoryBlock& block) const { return isUsed(slotOf(block)); }
+
 private:
     MemoryManager() = default;
     MemoryManager(const MemoryManager&) = delete;
@@ -58,10 +208,192 @@ private:
 
     static MemoryManager* instance;
 
-    void* memoryBlock = nullptr;
-    size_t totalSize = 0;
-    uint32_t nextBlockId = 0;
+    std::atomic<bool> dumpsEnabled{true};
+    size_t totalSize = 0;                        // Ceiling for all segments together
+    uint32_t nextBlockId = 1;
     std::string dumpFolderPath;
+
+    // Arena space management (callers hold mutex). The arena is a list of
+    // malloc'd segments added on demand; empty ones go back to the OS.
+    struct Segment {
+        char* base = nullptr;                    // Null once released
+        size_t size = 0;
+        size_t top = 0;                          // End of the highest allocation
+        std::map<size_t, size_t> freeExtents;    // Holes below top: offset -> size
+    };
+    static constexpr size_t kNoSpace = static_cast<size_t>(-1);
+    std::vector<Segment> segments;
+    size_t segmentSize = kDefaultSegmentSize;
+    size_t committedSize = 0;                    // Bytes held by live segments
+    // Copy-on-write storage (segment, offset) -> sharing blocks
+    std::map<std::pair<uint32_t, size_t>, uint32_t> sharedStorage;
+
+    char* address(const MemoryBlock& block) const { return segments[block.segment].base + block.offset; }
+    static std::pair<uint32_t, size_t> storage(const MemoryBlock& block) { return {block.segment, block.offset}; }
+
+    // Reserved block id -> lease expiry
+    std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> reservations;
+
+    // Client sessions (callers hold mutex); only blocks a session still
+    // references appear in `held`, with the number of references
+    struct Session {
+        std::chrono::milliseconds lease{kDefaultSessionLease};
+        std::chrono::steady_clock::time_point expiry;
+        std::unordered_map<uint32_t, uint32_t> held;
+    };
+    std::unordered_map<uint64_t, Session> sessions;
+    // Returns false for a release the session does not hold, e.g. one
+    // already dropped when the session expired
+    bool trackReference(uint64_t session, uint32_t id, int delta);
+    void expireSessions();
+
+    // Regions (callers hold mutex). Chunks are taken from the arena whole
+    // and every member block lives inside one; compaction moves a chunk
+    // as a unit.
+    struct Region {
+        struct Chunk {
+            uint32_t segment;
+            size_t offset;
+            size_t size;
+            size_t used;           // Bump pointer
+        };
+        size_t chunkSize;
+        uint64_t session;
+        std::vector<Chunk> chunks;
+        std::vector<uint32_t> blocks;
+    };
+    std::unordered_map<uint32_t, Region> regions;
+    uint32_t nextRegionId = 1;
+    size_t regionOffset(Region& region, size_t size, size_t alignment, uint32_t& segment);
+    size_t destroyRegionLocked(uint32_t id);
+    void releaseRegion(uint32_t id);  // Drops members and chunks without logging
+
+    uint32_t createBlockLocked(size_t size, const std::string& type, uint32_t layoutId = 0, uint32_t region = 0,
+                               uint64_t session = 0, size_t alignment = 0);
+    MemoryBlock& addBlock(const MemoryBlock& block, uint32_t refs);  // Returns the stored copy
+    std::vector<uint32_t> refCounts;   // By position in blocks
+    std::vector<uint64_t> usedBits;    // Bit i set while blocks[i] is live
+    void setUsed(size_t slot, bool used);
+    void clearBlocks();
+    // Calls visit(slot) for each live block, in position order, a bitmap
+    // word at a time; visit may free the block it is given
+    template <typename Visit>
+    void forEachUsed(Visit&& visit) const {
+        for (size_t word = 0; word < usedBits.size(); ++word) {
+            for (uint64_t bits = usedBits[word]; bits != 0; bits &= bits - 1) {
+                visit(word * 64 + static_cast<size_t>(__builtin_ctzll(bits)));
+            }
+        }
+    }
+
+    // Live usage per owner session and type (callers hold mutex). Growth
+    // is measured against a snapshot between one and two windows old.
+    struct Usage {
+        uint64_t blocks = 0;
+        uint64_t bytes = 0;
+        uint64_t allocatedBytes = 0;
+        uint64_t freedBytes = 0;
+        uint64_t baseBytes = 0;
+        std::chrono::steady_clock::time_point baseTime;
+        uint64_t pendingBytes = 0;
+        std::chrono::steady_clock::time_point pendingTime;
+    };
+    static constexpr std::chrono::seconds kUsageWindow{10};
+    std::unordered_map<uint64_t, std::unordered_map<uint8_t, Usage>> usage;
+    std::chrono::steady_clock::time_point lastUsageRoll;
+    void accountBlock(const MemoryBlock& block, int delta);
+    void rollUsage(std::chrono::steady_clock::time_point now);
+    size_t allocateOffset(size_t size, size_t alignment, uint32_t& segment);
+    size_t carveOffset(size_t size, size_t alignment, uint32_t& segment);
+    bool addSegment(size_t minSize, uint32_t& segment);
+    void releaseOffset(uint32_t segment, size_t offset, size_t size);
+    void releaseEmptySegments();
+    void resetArena();
+    void freeBlock(MemoryBlock& block);
+    size_t sweepUnreferenced();
+    bool ensureExclusive(MemoryBlock& block);
+    MemoryBlock* findBlock(uint32_t id);
+    std::unordered_map<uint32_t, size_t> blockIndex;   // Id -> position in blocks
+
+    // Type layouts and the references links hold (callers hold mutex)
+    struct TypeLayout {
+        std::string name;
+        size_t size;
+        std::vector<uint32_t> pointerOffsets;
+    };
+    std::unordered_map<uint32_t, TypeLayout> layouts;
+    static constexpr int kShardShift = 48;  // Id tag position, as in ShardedTransport
+    uint32_t shardTag = 0;                  // Tag of this server's ids, 0 if not sharded
+    std::vector<uint32_t> readLinks(const MemoryBlock& block);
+    void adjustLinks(const std::vector<uint32_t>& targets, int delta);
+
+    // Incremental cycle collector (callers hold mutex). Counts the links
+    // each block receives, marks from blocks with references beyond those
+    // links, then sweeps whatever stayed unmarked.
+    enum class TracePhase { Idle, Count, Mark, Sweep };
+    TracePhase tracePhase = TracePhase::Idle;
+    std::chrono::milliseconds traceInterval{5000};
+    std::chrono::microseconds traceBudget{1000};
+    std::chrono::steady_clock::time_point lastTrace;
+    size_t traceCursor = 0;
+    size_t traceFreed = 0;
+    std::unordered_map<uint32_t, uint32_t> internalRefs;
+    std::unordered_set<uint32_t> traceMarked;
+    std::vector<uint32_t> traceGrey;
+    void shade(uint32_t id);
+    void traceStep(std::chrono::steady_clock::time_point now);
+    void abortTrace();
+
+    // Tiered storage (callers hold mutex)
+    std::unique_ptr<SpillFile> spill;
+    size_t clockHand = 0;
+    char* blockData(MemoryBlock& block);
+    bool evictOne();
+
+    AllocTrace allocTrace;
+    ServerStats stats;
+    RequestProfiler profiler;
+    std::unique_ptr<MetricsServer> metrics;
+    ArenaStats arenaStatsLocked() const;
+    void traceCreate(const MemoryBlock& block);
+
+    // Mutation log for backups and the WAL (callers hold mutex; no-ops until
+    // a backup subscribes or the WAL is enabled)
+    ReplicationLog replicationLog;
+    std::unique_ptr<WriteAheadLog> wal;
+    std::chrono::seconds checkpointInterval{60};
+    std::chrono::steady_clock::time_point lastCheckpoint;
+    void appendMutation(memory_service::MutationRecord record);
+    void applyMutation(const memory_service::MutationRecord& record);
+    bool awaitDurability();
+    std::vector<memory_service::MutationRecord> snapshotRecords();
+    void logBlock(const MemoryBlock& block);
+    void logWrite(const MemoryBlock& block, size_t offset, size_t length);
+    void logFree(uint32_t id);
+    void logLayout(uint32_t id, const TypeLayout& layout);
+    // Reservations and session references are logged too, so recovery and
+    // backups know who owns each reference: a zero lease ends a
+    // reservation, a zero id ends a session
+    void logReservation(uint32_t id, std::chrono::milliseconds lease);
+    void logSessionRef(uint64_t session, uint32_t id, int delta);
+    void logRegion(uint32_t id, const Region* region);  // nullptr: destroyed
+    bool endReservation(uint32_t id);
+    std::vector<memory_service::ReplicationBatch> snapshotBatches(size_t maxRecords);
+
+    // Backup side
+    std::atomic<bool> replica{false};
+    std::atomic<bool> following{false};
+    std::string primaryAddress;
+    std::thread replicationThread;
+    std::mutex replicationContextMutex;
+    grpc::ClientContext* replicationContext = nullptr;
+    uint64_t appliedSequence = 0;                  // Guarded by mutex
+    uint64_t appliedLogId = 0;                     // Guarded by mutex
+    std::atomic<int64_t> caughtUpAtMs{0};          // Last time fully in sync (steady clock)
+    void followPrimary();
+    void stopFollowing();
+    void applyBatch(const memory_service::ReplicationBatch& batch);
+    bool withinStaleness(uint32_t maxStalenessMs) const;
     
     std::unique_ptr<grpc::Server> server;
     
@@ -89,6 +421,57 @@ private:
     grpc::Status DecreaseRefCount(grpc::ServerContext* context,
                                 const memory_service::RefCountRequest* request,
                                 memory_service::RefCountResponse* response) override;
+
+    grpc::Status UpdateRefCounts(grpc::ServerContext* context,
+                                const memory_service::RefCountBatchRequest* request,
+                                memory_service::RefCountBatchResponse* response) override;
+
+    grpc::Status Reserve(grpc::ServerContext* context,
+                        const memory_service::ReserveRequest* request,
+                        memory_service::ReserveResponse* response) override;
+
+    grpc::Status Compute(grpc::ServerContext* context,
+                        const memory_service::ComputeRequest* request,
+                        memory_service::ComputeResponse* response) override;
+
+    grpc::Status Copy(grpc::ServerContext* context,
+                     const memory_service::CopyRequest* request,
+                     memory_service::CopyResponse* response) override;
+
+    grpc::Status Clone(grpc::ServerContext* context,
+                      const memory_service::CloneRequest* request,
+                      memory_service::CloneResponse* response) override;
+
+    grpc::Status Replicate(grpc::ServerContext* context,
+                          const memory_service::ReplicateRequest* request,
+                          grpc::ServerWriter<memory_service::ReplicationBatch>* writer) override;
+
+    grpc::Status Promote(grpc::ServerContext* context,
+                        const memory_service::PromoteRequest* request,
+                        memory_service::PromoteResponse* response) override;
+
+    grpc::Status RegisterTypeLayout(grpc::ServerContext* context,
+                                   const memory_service::RegisterTypeLayoutRequest* request,
+                                   memory_service::RegisterTypeLayoutResponse* response) override;
+
+    grpc::Status Heartbeat(grpc::ServerContext* context,
+                          const memory_service::HeartbeatRequest* request,
+                          memory_service::HeartbeatResponse* response) override;
+
+    grpc::Status CreateRegion(grpc::ServerContext* context,
+                             const memory_service::CreateRegionRequest* request,
+                             memory_service::CreateRegionResponse* response) override;
+
+    grpc::Status DestroyRegion(grpc::ServerContext* context,
+                              const memory_service::DestroyRegionRequest* request,
+                              memory_service::DestroyRegionResponse* response) override;
+
+    grpc::Status GetStats(grpc::ServerContext* context,
+                         const memory_service::GetStatsRequest* request,
+                         memory_service::GetStatsResponse* response) override;
+    grpc::Status GetUsage(grpc::ServerContext* context,
+                         const memory_service::GetUsageRequest* request,
+                         memory_service::GetUsageResponse* response) override;
 };
 
 // Garbage Collector
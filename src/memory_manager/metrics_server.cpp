@@ -0,0 +1,155 @@
+#include "metrics_server.h"
+#include <sstream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(uint16_t port, std::function<std::string()> renderBody) {
+    stop();
+    listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) return false;
+    int reuse = 1;
+    ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd, 16) < 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    render = std::move(renderBody);
+    running = true;
+    thread = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        listenFd = -1;
+    }
+}
+
+void MetricsServer::serve() {
+    while (running) {
+        // Wake up now and then to notice stop()
+        pollfd pending{listenFd, POLLIN, 0};
+        if (::poll(&pending, 1, 200) <= 0) continue;
+        int client = ::accept(listenFd, nullptr, nullptr);
+        if (client < 0) continue;
+
+        // Connections are served one at a time, so a client that stalls
+        // is dropped rather than blocking the others and stop()
+        timeval timeout{};
+        timeout.tv_sec = 1;
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // The request itself does not matter: every path gets the metrics
+        char request[1024];
+        if (::recv(client, request, sizeof(request), 0) <= 0) {
+            ::close(client);
+            continue;
+        }
+
+        std::string body = render();
+        std::ostringstream response;
+        response << "HTTP/1.1 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << body;
+        std::string data = response.str();
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        ::close(client);
+    }
+}
+
+std::string MetricsServer::format(const memory_service::GetStatsResponse& stats) {
+    std::ostringstream out;
+    auto metric = [&out](const char* name, const char* type, const char* help) {
+        out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+    };
+
+    metric("mpointers_committed_bytes", "gauge", "Bytes held by arena segments");
+    out << "mpointers_committed_bytes " << stats.committed_bytes() << '\n';
+    metric("mpointers_live_bytes", "gauge", "Bytes of resident live blocks");
+    out << "mpointers_live_bytes " << stats.live_bytes() << '\n';
+    metric("mpointers_free_bytes", "gauge", "Free bytes inside arena segments");
+    out << "mpointers_free_bytes " << stats.free_bytes() << '\n';
+    metric("mpointers_largest_free_bytes", "gauge", "Largest free extent");
+    out << "mpointers_largest_free_bytes " << stats.largest_free_bytes() << '\n';
+    metric("mpointers_fragmentation_ratio", "gauge", "Share of free space outside the largest free extent");
+    out << "mpointers_fragmentation_ratio " << stats.fragmentation() << '\n';
+    metric("mpointers_segments", "gauge", "Arena segments");
+    out << "mpointers_segments " << stats.segments() << '\n';
+    metric("mpointers_spilled_bytes", "gauge", "Bytes of blocks in the spill file");
+    out << "mpointers_spilled_bytes " << stats.spilled_bytes() << '\n';
+
+    metric("mpointers_live_blocks", "gauge", "Live blocks by type");
+    for (const auto& type : stats.types()) {
+        out << "mpointers_live_blocks{type=\"" << type.type() << "\"} " << type.blocks() << '\n';
+    }
+    metric("mpointers_type_bytes", "gauge", "Live block bytes by type");
+    for (const auto& type : stats.types()) {
+        out << "mpointers_type_bytes{type=\"" << type.type() << "\"} " << type.bytes() << '\n';
+    }
+    metric("mpointers_size_class_blocks", "gauge", "Live blocks by power-of-two size class");
+    for (const auto& size_class : stats.size_classes()) {
+        out << "mpointers_size_class_blocks{max=\"" << size_class.max_size() << "\"} " << size_class.blocks() << '\n';
+    }
+
+    metric("mpointers_gc_runs_total", "counter", "Reference count GC passes");
+    out << "mpointers_gc_runs_total " << stats.gc_runs() << '\n';
+    metric("mpointers_gc_seconds_total", "counter", "Time spent in GC passes");
+    out << "mpointers_gc_seconds_total " << stats.gc_total_us() / 1e6 << '\n';
+    metric("mpointers_gc_freed_blocks_total", "counter", "Blocks freed by GC passes");
+    out << "mpointers_gc_freed_blocks_total " << stats.gc_freed_blocks() << '\n';
+    metric("mpointers_compactions_total", "counter", "Arena compactions");
+    out << "mpointers_compactions_total " << stats.compactions() << '\n';
+    metric("mpointers_compaction_seconds_total", "counter", "Time spent compacting");
+    out << "mpointers_compaction_seconds_total " << stats.compaction_total_us() / 1e6 << '\n';
+
+    metric("mpointers_rpc_errors_total", "counter", "RPCs answered with success = false");
+    for (const auto& rpc : stats.rpcs()) {
+        out << "mpointers_rpc_errors_total{method=\"" << rpc.method() << "\"} " << rpc.errors() << '\n';
+    }
+    metric("mpointers_rpc_latency_seconds", "histogram", "RPC handler latency");
+    for (const auto& rpc : stats.rpcs()) {
+        uint64_t cumulative = 0;
+        for (int b = 0; b < rpc.latency_buckets_size(); ++b) {
+            cumulative += rpc.latency_buckets(b);
+            out << "mpointers_rpc_latency_seconds_bucket{method=\"" << rpc.method() << "\",le=\"";
+            if (b + 1 == rpc.latency_buckets_size()) {
+                out << "+Inf";
+            } else {
+                out << static_cast<double>(1ull << b) / 1e6;
+            }
+            out << "\"} " << cumulative << '\n';
+        }
+        out << "mpointers_rpc_latency_seconds_sum{method=\"" << rpc.method() << "\"} " << rpc.total_us() / 1e6 << '\n';
+        out << "mpointers_rpc_latency_seconds_count{method=\"" << rpc.method() << "\"} " << rpc.calls() << '\n';
+    }
+    return out.str();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include "memory_service.pb.h"
+
+// Plain-text Prometheus endpoint (mem-mgr --metricsPort). Listens on
+// localhost only and answers every request with the current metrics,
+// one connection at a time. A client gets 1 s to send its request and to
+// take the response before it is disconnected.
+class MetricsServer {
+public:
+    ~MetricsServer();
+
+    // `render` produces the response body; false if the port is taken
+    bool start(uint16_t port, std::function<std::string()> render);
+    void stop();
+
+    // Prometheus text exposition of a GetStats response
+    static std::string format(const memory_service::GetStatsResponse& stats);
+
+private:
+    int listenFd = -1;
+    std::atomic<bool> running{false};
+    std::function<std::string()> render;
+    std::thread thread;
+
+    void serve();
+};
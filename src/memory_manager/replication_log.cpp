@@ -0,0 +1,70 @@
+#include "replication_log.h"
+#include <random>
+
+static uint64_t newLogId() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+ReplicationLog::ReplicationLog(size_t capacity) : capacity_(capacity), id_(newLogId()) {}
+
+void ReplicationLog::activate() {
+    active_.store(true, std::memory_order_release);
+}
+
+void ReplicationLog::append(memory_service::MutationRecord record) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        record.set_sequence(++lastSequence_);
+        records_.push_back(std::move(record));
+        if (records_.size() > capacity_) {
+            records_.pop_front();
+        }
+    }
+    changed_.notify_all();
+}
+
+uint64_t ReplicationLog::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastSequence_;
+}
+
+void ReplicationLog::reset(uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id_ = newLogId();  // A new history starts here
+    records_.clear();
+    lastSequence_ = sequence;
+}
+
+bool ReplicationLog::read(uint64_t from, size_t max, memory_service::ReplicationBatch& batch) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch.set_primary_sequence(lastSequence_);
+    batch.set_log_id(id_);
+    if (from > lastSequence_) {
+        return true;  // Nothing new yet
+    }
+
+    uint64_t first = lastSequence_ - records_.size() + 1;
+    if (from < first) {
+        return false;
+    }
+    for (size_t i = from - first; i < records_.size() && max > 0; ++i, --max) {
+        *batch.add_records() = records_[i];
+    }
+    return true;
+}
+
+void ReplicationLog::waitFor(uint64_t from, std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait_for(lock, timeout, [&] {
+        return lastSequence_ >= from || closed_.load(std::memory_order_acquire);
+    });
+}
+
+void ReplicationLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_.store(true, std::memory_order_release);
+    }
+    changed_.notify_all();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "memory_service.pb.h"
+
+// Ordered log of mutations a primary streams to its backups. Records are
+// physical (block metadata, written bytes, frees) rather than requests, so a
+// backup reaches the same blocks and contents whatever its allocator does.
+// The log stays inactive, and costs nothing, until the first backup
+// subscribes; it then keeps the most recent `capacity` records so a backup
+// that reconnects can resume instead of taking a new snapshot.
+class ReplicationLog {
+public:
+    explicit ReplicationLog(size_t capacity = 65536);
+
+    // Identifies this log's history; a backup only resumes from a log with
+    // the id it followed before
+    uint64_t id() const { return id_; }
+
+    bool active() const { return active_.load(std::memory_order_acquire); }
+    void activate();
+
+    // Appends a record and assigns its sequence number. Callers hold the
+    // memory manager mutex, which keeps the log in mutation order.
+    void append(memory_service::MutationRecord record);
+
+    // Last sequence number handed out (0 before the first record)
+    uint64_t lastSequence() const;
+
+    // Drops every record and continues numbering after `sequence`
+    void reset(uint64_t sequence);
+
+    // Copies up to `max` records starting at `from` into `batch`. Returns
+    // false if `from` is older than the oldest record still kept.
+    bool read(uint64_t from, size_t max, memory_service::ReplicationBatch& batch) const;
+
+    // Waits until a record at or after `from` exists, the timeout passes or
+    // the log is closed
+    void waitFor(uint64_t from, std::chrono::milliseconds timeout) const;
+
+    // Wakes every waiter for shutdown
+    void close();
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    size_t capacity_;
+    uint64_t id_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable changed_;
+    std::deque<memory_service::MutationRecord> records_;
+    uint64_t lastSequence_ = 0;
+    std::atomic<bool> active_{false};
+    std::atomic<bool> closed_{false};
+};
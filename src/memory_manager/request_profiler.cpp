@@ -0,0 +1,299 @@
+#include "request_profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace {
+
+// Spans past this many in one request only count toward the lock totals
+constexpr size_t kMaxSpansPerRequest = 1024;
+
+uint64_t toNanos(RequestProfiler::Clock::duration elapsed) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+std::string spanName(const RequestProfiler::Span& span) {
+    switch (span.kind) {
+        case RequestProfiler::Span::LockWait: return std::string("wait ") + span.name;
+        case RequestProfiler::Span::LockHold: return std::string("hold ") + span.name;
+        default: return span.name;
+    }
+}
+
+void writeEvent(std::ostream& out, bool& first, const std::string& name, const char* category,
+                double ts, double dur, int pid, uint32_t tid, const std::string& args = "") {
+    out << (first ? "\n" : ",\n");
+    first = false;
+    out << "{\"name\":\"" << name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"ts\":" << ts
+        << ",\"dur\":" << dur << ",\"pid\":" << pid << ",\"tid\":" << tid;
+    if (!args.empty()) {
+        out << ",\"args\":{" << args << "}";
+    }
+    out << "}";
+}
+
+void writeName(std::ostream& out, bool& first, const char* kind, int pid, uint32_t tid, const std::string& name) {
+    out << (first ? "\n" : ",\n");
+    first = false;
+    out << "{\"name\":\"" << kind << "\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+        << ",\"args\":{\"name\":\"" << name << "\"}}";
+}
+
+}  // namespace
+
+bool RequestProfiler::start(const std::string& path, size_t slowest) {
+    active.store(false, std::memory_order_release);
+    // Fail now rather than after a long run
+    if (!std::ofstream(path)) return false;
+
+    this->path = path;
+    slowestLimit = std::max<size_t>(slowest, 1);
+    origin = Clock::now();
+    events.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    buffers.for_each([](Buffer& buffer) {
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.inRequest = false;
+        buffer.timeline.clear();
+        buffer.sites.clear();
+    });
+    {
+        std::lock_guard<std::mutex> lock(slowestMutex);
+        slowestRequests.clear();
+        slowestFloorNs.store(0, std::memory_order_relaxed);
+    }
+    active.store(true, std::memory_order_release);
+    return true;
+}
+
+bool RequestProfiler::stop(std::string& error) {
+    if (path.empty()) return true;
+    active.store(false, std::memory_order_release);
+    bool written = writeTrace(error);
+    path.clear();
+    return written;
+}
+
+RequestProfiler::Buffer& RequestProfiler::localBuffer() {
+    Buffer& buffer = buffers.local();
+    if (buffer.thread == 0) {
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.thread = tracks.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    return buffer;
+}
+
+void RequestProfiler::beginRequest(const char* name, Clock::time_point start) {
+    Buffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.inRequest = true;
+    buffer.current.name = name;
+    buffer.current.thread = buffer.thread;
+    buffer.current.start = start;
+    buffer.current.spans.clear();
+}
+
+void RequestProfiler::endRequest(Clock::time_point end) {
+    Buffer& buffer = localBuffer();
+    Request request;
+    {
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        // Started before the profiler was (re)started
+        if (!buffer.inRequest) return;
+        buffer.inRequest = false;
+        buffer.current.end = end;
+        request = std::move(buffer.current);
+    }
+
+    int64_t elapsedNs = static_cast<int64_t>(toNanos(request.elapsed()));
+    if (elapsedNs > slowestFloorNs.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(slowestMutex);
+        auto at = std::find_if(slowestRequests.begin(), slowestRequests.end(),
+                               [&](const Request& kept) { return kept.elapsed() < request.elapsed(); });
+        slowestRequests.insert(at, request);
+        if (slowestRequests.size() > slowestLimit) {
+            slowestRequests.pop_back();
+        }
+        if (slowestRequests.size() == slowestLimit) {
+            slowestFloorNs.store(static_cast<int64_t>(toNanos(slowestRequests.back().elapsed())),
+                                 std::memory_order_relaxed);
+        }
+    }
+    keep(buffer, std::move(request));
+}
+
+void RequestProfiler::keep(Buffer& buffer, Request&& request) {
+    uint64_t count = 1 + request.spans.size();
+    if (events.fetch_add(count, std::memory_order_relaxed) + count > kMaxEvents) {
+        dropped.fetch_add(count, std::memory_order_relaxed);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.timeline.push_back(std::move(request));
+}
+
+void RequestProfiler::recordSpan(Span::Kind kind, const char* name, Clock::time_point start, Clock::time_point end) {
+    Buffer& buffer = localBuffer();
+    Span span{kind, name, start, end};
+    bool loose = false;
+    {
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        if (kind != Span::Phase) {
+            LockSite& site = buffer.sites.try_emplace(name, LockSite{name}).first->second;
+            uint64_t nanos = toNanos(end - start);
+            if (kind == Span::LockWait) {
+                site.acquisitions++;
+                site.waitNs += nanos;
+                site.maxWaitNs = std::max(site.maxWaitNs, nanos);
+            } else {
+                site.holdNs += nanos;
+                site.maxHoldNs = std::max(site.maxHoldNs, nanos);
+            }
+        }
+        if (buffer.inRequest) {
+            if (buffer.current.spans.size() < kMaxSpansPerRequest) {
+                buffer.current.spans.push_back(span);
+            }
+        } else {
+            loose = true;
+        }
+    }
+    // Background work (the collector, checkpoints) has no request around it
+    if (loose) {
+        Request request;
+        request.thread = buffer.thread;
+        request.start = start;
+        request.end = end;
+        request.spans.push_back(span);
+        keep(buffer, std::move(request));
+    }
+}
+
+std::vector<RequestProfiler::LockSite> RequestProfiler::lockSites() const {
+    // Sites are keyed by name here: the same literal may have several addresses
+    std::map<std::string, LockSite> merged;
+    buffers.for_each([&](Buffer& buffer) {
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        for (const auto& entry : buffer.sites) {
+            const LockSite& site = entry.second;
+            LockSite& total = merged.try_emplace(site.name, LockSite{site.name}).first->second;
+            total.acquisitions += site.acquisitions;
+            total.waitNs += site.waitNs;
+            total.holdNs += site.holdNs;
+            total.maxWaitNs = std::max(total.maxWaitNs, site.maxWaitNs);
+            total.maxHoldNs = std::max(total.maxHoldNs, site.maxHoldNs);
+        }
+    });
+    std::vector<LockSite> sites;
+    for (const auto& entry : merged) {
+        sites.push_back(entry.second);
+    }
+    std::sort(sites.begin(), sites.end(),
+              [](const LockSite& a, const LockSite& b) { return a.waitNs > b.waitNs; });
+    return sites;
+}
+
+std::vector<RequestProfiler::Request> RequestProfiler::slowest() const {
+    std::lock_guard<std::mutex> lock(slowestMutex);
+    return slowestRequests;
+}
+
+std::string RequestProfiler::summary() const {
+    auto us = [](uint64_t nanos) { return nanos / 1000.0; };
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+
+    out << "Lock sites (wait total/mean/max, hold total/mean/max, in us):\n";
+    for (const auto& site : lockSites()) {
+        uint64_t n = std::max<uint64_t>(site.acquisitions, 1);
+        out << "  " << std::left << std::setw(24) << site.name << std::right << std::setw(10) << site.acquisitions
+            << "  wait " << us(site.waitNs) << " / " << us(site.waitNs / n) << " / " << us(site.maxWaitNs)
+            << "  hold " << us(site.holdNs) << " / " << us(site.holdNs / n) << " / " << us(site.maxHoldNs) << "\n";
+    }
+
+    out << "Slowest requests (us):\n";
+    std::vector<Request> requests = slowest();
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const Request& request = requests[i];
+        out << "  " << (i + 1) << ". " << request.name << " " << us(toNanos(request.elapsed()))
+            << " on thread " << request.thread;
+        // Repeated spans (a lock taken twice) are summed
+        std::vector<std::pair<std::string, uint64_t>> parts;
+        for (const auto& span : request.spans) {
+            std::string name = spanName(span);
+            auto it = std::find_if(parts.begin(), parts.end(), [&](const auto& part) { return part.first == name; });
+            if (it == parts.end()) {
+                parts.emplace_back(name, toNanos(span.end - span.start));
+            } else {
+                it->second += toNanos(span.end - span.start);
+            }
+        }
+        for (size_t p = 0; p < parts.size(); ++p) {
+            out << (p == 0 ? ": " : ", ") << parts[p].first << " " << us(parts[p].second);
+        }
+        out << "\n";
+    }
+    if (droppedEvents() > 0) {
+        out << "Timeline full: " << droppedEvents() << " events left out of the trace file\n";
+    }
+    return out.str();
+}
+
+bool RequestProfiler::writeTrace(std::string& error) const {
+    std::ofstream out(path);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    auto ts = [this](Clock::time_point at) {
+        return std::chrono::duration<double, std::micro>(at - origin).count();
+    };
+    auto dur = [](Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration<double, std::micro>(end - start).count();
+    };
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+
+    // Process 1 is the timeline, one track per server thread
+    writeName(out, first, "process_name", 1, 0, "mem-mgr");
+    buffers.for_each([&](Buffer& buffer) {
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        if (buffer.timeline.empty()) return;
+        writeName(out, first, "thread_name", 1, buffer.thread, "thread " + std::to_string(buffer.thread));
+        for (const auto& request : buffer.timeline) {
+            if (request.name) {
+                writeEvent(out, first, request.name, "rpc", ts(request.start),
+                           dur(request.start, request.end), 1, request.thread);
+            }
+            for (const auto& span : request.spans) {
+                writeEvent(out, first, spanName(span), span.kind == Span::Phase ? "phase" : "lock",
+                           ts(span.start), dur(span.start, span.end), 1, request.thread);
+            }
+        }
+    });
+
+    // Process 2 repeats the slowest requests, one per track, slowest first
+    writeName(out, first, "process_name", 2, 0, "slowest requests");
+    std::vector<Request> requests = slowest();
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const Request& request = requests[i];
+        uint32_t track = static_cast<uint32_t>(i + 1);
+        writeName(out, first, "thread_name", 2, track,
+                  "#" + std::to_string(track) + " " + request.name + " (thread " + std::to_string(request.thread) + ")");
+        writeEvent(out, first, request.name, "rpc", ts(request.start), dur(request.start, request.end), 2, track,
+                   "\"rank\":" + std::to_string(track));
+        for (const auto& span : request.spans) {
+            writeEvent(out, first, spanName(span), span.kind == Span::Phase ? "phase" : "lock",
+                       ts(span.start), dur(span.start, span.end), 2, track);
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
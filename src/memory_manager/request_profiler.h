@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/thread_slots.h"
+
+// Opt-in request profiler (mem-mgr --profile FILE). While it runs, every
+// handler records how long it waited for and then held each lock, and how
+// long its phases (lookup, copy, dump, durability wait, ...) took. The
+// profiler totals lock wait and hold per call site, keeps the slowest
+// requests with their breakdown, and writes everything as a Chrome
+// trace-event file (chrome://tracing, Perfetto). Each thread records into
+// its own buffer; when off, every hook is one relaxed load.
+class RequestProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kDefaultSlowest = 20;
+    // Timeline events kept for the trace file; later ones only count
+    static constexpr size_t kMaxEvents = 1 << 20;
+
+    struct Span {
+        enum Kind : uint8_t { Phase, LockWait, LockHold };
+        Kind kind;
+        const char* name;    // Phase or lock call site
+        Clock::time_point start;
+        Clock::time_point end;
+    };
+
+    struct Request {
+        const char* name = nullptr;
+        uint32_t thread = 0;
+        Clock::time_point start;
+        Clock::time_point end;
+        std::vector<Span> spans;
+
+        Clock::duration elapsed() const { return end - start; }
+    };
+
+    struct LockSite {
+        const char* name;
+        uint64_t acquisitions = 0;
+        uint64_t waitNs = 0;
+        uint64_t holdNs = 0;
+        uint64_t maxWaitNs = 0;
+        uint64_t maxHoldNs = 0;
+    };
+
+    // Clears earlier results and starts recording; the trace goes to `path`
+    // on stop(). False if the file cannot be created.
+    bool start(const std::string& path, size_t slowest = kDefaultSlowest);
+    // Writes the trace file; false (with `error`) if that fails
+    bool stop(std::string& error);
+
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    // Hooks for the scopes below; a request's spans are kept with it
+    void beginRequest(const char* name, Clock::time_point start);
+    void endRequest(Clock::time_point end);
+    void recordSpan(Span::Kind kind, const char* name, Clock::time_point start, Clock::time_point end);
+
+    std::vector<LockSite> lockSites() const;     // Most waited on first
+    std::vector<Request> slowest() const;        // Slowest first
+    uint64_t droppedEvents() const { return dropped.load(std::memory_order_relaxed); }
+    std::string summary() const;
+
+private:
+    // Filled by its thread; the mutex is only contended while stop() reads.
+    // A new thread takes over the buffer (and track) of an exited one.
+    struct Buffer {
+        std::mutex mutex;
+        uint32_t thread = 0;             // Trace track, numbered on first use
+        bool inRequest = false;
+        Request current;
+        std::vector<Request> timeline;   // Spans outside a request come as name-less requests
+        std::unordered_map<const char*, LockSite> sites;
+    };
+
+    std::atomic<bool> active{false};
+    std::string path;
+    Clock::time_point origin;
+    size_t slowestLimit = kDefaultSlowest;
+    std::atomic<uint64_t> events{0};
+    std::atomic<uint64_t> dropped{0};
+
+    ThreadSlots<Buffer> buffers;
+    std::atomic<uint32_t> tracks{0};
+
+    mutable std::mutex slowestMutex;
+    std::vector<Request> slowestRequests;          // Sorted, slowest first
+    std::atomic<int64_t> slowestFloorNs{0};        // Fastest kept once full
+
+    Buffer& localBuffer();
+    void keep(Buffer& buffer, Request&& request);
+    bool writeTrace(std::string& error) const;
+};
+
+// Drop-in for std::lock_guard that reports wait and hold time for `site`
+class ProfiledLock {
+public:
+    ProfiledLock(std::mutex& mutex, RequestProfiler& profiler, const char* site)
+        : mutex(mutex), profiler(profiler.enabled() ? &profiler : nullptr), site(site) {
+        if (!this->profiler) {
+            mutex.lock();
+            return;
+        }
+        auto requested = RequestProfiler::Clock::now();
+        mutex.lock();
+        acquired = RequestProfiler::Clock::now();
+        this->profiler->recordSpan(RequestProfiler::Span::LockWait, site, requested, acquired);
+    }
+    ~ProfiledLock() {
+        if (!profiler) {
+            mutex.unlock();
+            return;
+        }
+        auto released = RequestProfiler::Clock::now();
+        mutex.unlock();
+        profiler->recordSpan(RequestProfiler::Span::LockHold, site, acquired, released);
+    }
+    ProfiledLock(const ProfiledLock&) = delete;
+    ProfiledLock& operator=(const ProfiledLock&) = delete;
+
+private:
+    std::mutex& mutex;
+    RequestProfiler* profiler;
+    const char* site;
+    RequestProfiler::Clock::time_point acquired;
+};
+
+// Times one phase of the current request
+class ProfiledPhase {
+public:
+    ProfiledPhase(RequestProfiler& profiler, const char* name)
+        : profiler(profiler.enabled() ? &profiler : nullptr), name(name) {
+        if (this->profiler) start = RequestProfiler::Clock::now();
+    }
+    ~ProfiledPhase() {
+        if (profiler) profiler->recordSpan(RequestProfiler::Span::Phase, name, start, RequestProfiler::Clock::now());
+    }
+    ProfiledPhase(const ProfiledPhase&) = delete;
+    ProfiledPhase& operator=(const ProfiledPhase&) = delete;
+
+private:
+    RequestProfiler* profiler;
+    const char* name;
+    RequestProfiler::Clock::time_point start;
+};
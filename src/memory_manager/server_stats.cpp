@@ -0,0 +1,97 @@
+#include "server_stats.h"
+#include <algorithm>
+#include <cmath>
+
+static uint64_t toMicros(std::chrono::steady_clock::duration elapsed) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+const char* ServerStats::rpcName(Rpc rpc) {
+    static const char* names[kRpcCount] = {
+        "Create", "Set", "Get", "IncreaseRefCount", "DecreaseRefCount", "UpdateRefCounts", "Reserve", "Compute",
+        "Copy", "Clone", "Promote", "RegisterTypeLayout", "Heartbeat", "CreateRegion", "DestroyRegion", "GetStats",
+        "GetUsage",
+    };
+    return names[rpc];
+}
+
+void ServerStats::recordRpc(Rpc rpc, bool ok, std::chrono::steady_clock::duration elapsed) {
+    uint64_t nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    uint64_t micros = nanos / 1000;
+    size_t bucket = micros == 0 ? 0 : static_cast<size_t>(64 - __builtin_clzll(micros));
+    bucket = std::min(bucket, kLatencyBuckets - 1);
+
+    Slab& slab = slabs.local();
+    slab.calls[rpc].add(1);
+    if (!ok) {
+        slab.errors[rpc].add(1);
+    }
+    slab.totalNs[rpc].add(nanos);
+    slab.buckets[rpc][bucket].add(1);
+}
+
+std::vector<ServerStats::RpcTotals> ServerStats::rpcTotals() const {
+    std::vector<RpcTotals> totals(kRpcCount);
+    std::vector<uint64_t> totalNs(kRpcCount, 0);
+    slabs.for_each([&](const Slab& slab) {
+        for (size_t rpc = 0; rpc < kRpcCount; ++rpc) {
+            totals[rpc].calls += slab.calls[rpc].get();
+            totals[rpc].errors += slab.errors[rpc].get();
+            totalNs[rpc] += slab.totalNs[rpc].get();
+            for (size_t b = 0; b < kLatencyBuckets; ++b) {
+                totals[rpc].buckets[b] += slab.buckets[rpc][b].get();
+            }
+        }
+    });
+    for (size_t rpc = 0; rpc < kRpcCount; ++rpc) {
+        totals[rpc].totalUs = totalNs[rpc] / 1000;
+    }
+    return totals;
+}
+
+double ServerStats::RpcTotals::percentileUs(double percentile) const {
+    uint64_t count = 0;
+    for (uint64_t n : buckets) {
+        count += n;
+    }
+    if (count == 0) return 0.0;
+
+    double rank = percentile / 100.0 * count;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kLatencyBuckets; ++b) {
+        if (buckets[b] == 0 || seen + buckets[b] < rank) {
+            seen += buckets[b];
+            continue;
+        }
+        double lower = b == 0 ? 0.0 : std::ldexp(1.0, static_cast<int>(b) - 1);
+        if (b == kLatencyBuckets - 1) return lower;
+        double upper = std::ldexp(1.0, static_cast<int>(b));
+        return lower + (upper - lower) * (rank - seen) / buckets[b];
+    }
+    return std::ldexp(1.0, static_cast<int>(kLatencyBuckets) - 2);
+}
+
+void ServerStats::record(Pass& pass, std::chrono::steady_clock::duration elapsed, size_t freed) {
+    uint64_t micros = toMicros(elapsed);
+    pass.runs.fetch_add(1, std::memory_order_relaxed);
+    pass.totalUs.fetch_add(micros, std::memory_order_relaxed);
+    pass.lastUs.store(micros, std::memory_order_relaxed);
+    pass.freed.fetch_add(freed, std::memory_order_relaxed);
+}
+
+ServerStats::PassTotals ServerStats::load(const Pass& pass) {
+    PassTotals totals;
+    totals.runs = pass.runs.load(std::memory_order_relaxed);
+    totals.totalUs = pass.totalUs.load(std::memory_order_relaxed);
+    totals.lastUs = pass.lastUs.load(std::memory_order_relaxed);
+    totals.freed = pass.freed.load(std::memory_order_relaxed);
+    return totals;
+}
+
+void ServerStats::recordGcPass(std::chrono::steady_clock::duration elapsed, size_t freed) {
+    record(gc, elapsed, freed);
+}
+
+void ServerStats::recordCompaction(std::chrono::steady_clock::duration elapsed) {
+    record(compaction, elapsed, 0);
+}
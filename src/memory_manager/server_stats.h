@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "common/thread_slots.h"
+#include "request_profiler.h"
+
+// Request counters for GetStats and the metrics endpoint. Each thread
+// counts into its own slab with plain (relaxed load + store) updates; a
+// reader sums all slabs. Nothing a request touches is shared with another
+// thread, so counting costs a few non-atomic adds.
+class ServerStats {
+public:
+    enum Rpc {
+        Create, Set, Get, IncreaseRefCount, DecreaseRefCount, UpdateRefCounts, Reserve, Compute,
+        Copy, Clone, Promote, RegisterTypeLayout, Heartbeat, CreateRegion, DestroyRegion, GetStats, GetUsage,
+        kRpcCount
+    };
+    static const char* rpcName(Rpc rpc);
+
+    // Bucket i counts latencies under 2^i microseconds; the last is unbounded
+    static constexpr size_t kLatencyBuckets = 24;
+
+    struct RpcTotals {
+        uint64_t calls = 0;
+        uint64_t errors = 0;
+        uint64_t totalUs = 0;
+        uint64_t buckets[kLatencyBuckets] = {};
+
+        // Interpolated within the bucket, as Prometheus histogram_quantile does
+        double percentileUs(double percentile) const;
+    };
+
+    struct PassTotals {
+        uint64_t runs = 0;
+        uint64_t totalUs = 0;
+        uint64_t lastUs = 0;
+        uint64_t freed = 0;
+    };
+
+    void recordRpc(Rpc rpc, bool ok, std::chrono::steady_clock::duration elapsed);
+    std::vector<RpcTotals> rpcTotals() const;  // kRpcCount entries
+
+    // GC passes and compactions run on one thread at a time and rarely
+    void recordGcPass(std::chrono::steady_clock::duration elapsed, size_t freed);
+    void recordCompaction(std::chrono::steady_clock::duration elapsed);
+    PassTotals gcTotals() const { return load(gc); }
+    PassTotals compactionTotals() const { return load(compaction); }
+
+private:
+    // Written by one thread only, so increments need no read-modify-write
+    struct Counter {
+        std::atomic<uint64_t> value{0};
+        void add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+        uint64_t get() const { return value.load(std::memory_order_relaxed); }
+    };
+
+    struct Slab {
+        Counter calls[kRpcCount];
+        Counter errors[kRpcCount];
+        Counter totalNs[kRpcCount];
+        Counter buckets[kRpcCount][kLatencyBuckets];
+    };
+
+    struct Pass {
+        std::atomic<uint64_t> runs{0};
+        std::atomic<uint64_t> totalUs{0};
+        std::atomic<uint64_t> lastUs{0};
+        std::atomic<uint64_t> freed{0};
+    };
+
+    ThreadSlots<Slab> slabs;  // Slabs of exited threads keep their counts
+    Pass gc;
+    Pass compaction;
+
+    static void record(Pass& pass, std::chrono::steady_clock::duration elapsed, size_t freed);
+    static PassTotals load(const Pass& pass);
+};
+
+// Times one handler and records it when the handler returns; the call
+// counts as an error if the response says success = false. While the
+// profiler runs, the handler is also a request on its timeline.
+template<typename Response>
+class RpcScope {
+public:
+    RpcScope(ServerStats& stats, RequestProfiler& profiler, ServerStats::Rpc rpc, const Response* response)
+        : stats(stats), profiler(profiler.enabled() ? &profiler : nullptr), rpc(rpc), response(response),
+          start(std::chrono::steady_clock::now()) {
+        if (this->profiler) this->profiler->beginRequest(ServerStats::rpcName(rpc), start);
+    }
+    ~RpcScope() {
+        auto end = std::chrono::steady_clock::now();
+        stats.recordRpc(rpc, response->success(), end - start);
+        if (profiler) profiler->endRequest(end);
+    }
+
+private:
+    ServerStats& stats;
+    RequestProfiler* profiler;
+    ServerStats::Rpc rpc;
+    const Response* response;
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,112 @@
+#include "simd_kernels.h"
+#include "simd_kernels_impl.h"
+#include <stdexcept>
+#include <string>
+
+namespace simd {
+namespace scalar {
+
+// One-lane "vectors": the generic kernels degrade to plain loops
+template<typename Elem, typename Accum>
+struct ScalarOps {
+    using T = Elem;
+    using V = Elem;
+    using A = Accum;
+    using Acc = Accum;
+    static constexpr size_t W = 1;
+
+    static V load(const T* p) { return *p; }
+    static void store(T* p, V v) { *p = v; }
+    static V set1(T x) { return x; }
+    static V add(V a, V b) { return wrapAdd(a, b); }
+    static V mul(V a, V b) { return wrapMul(a, b); }
+    static V vmin(V a, V b) { return b < a ? b : a; }
+    static V vmax(V a, V b) { return b > a ? b : a; }
+
+    static A accZero() { return A{}; }
+    static A accAdd(A acc, V v) { return acc + v; }
+    static A accMulAdd(A acc, V a, V b) { return acc + static_cast<A>(a) * static_cast<A>(b); }
+    static A accCombine(A a, A b) { return a + b; }
+    static Acc accReduce(A acc) { return acc; }
+    static T hmin(V v) { return v; }
+    static T hmax(V v) { return v; }
+};
+
+template<> const KernelTable<float>& table<float>() {
+    static const KernelTable<float> t = makeKernelTable<ScalarOps<float, double>>();
+    return t;
+}
+
+template<> const KernelTable<double>& table<double>() {
+    static const KernelTable<double> t = makeKernelTable<ScalarOps<double, double>>();
+    return t;
+}
+
+template<> const KernelTable<int32_t>& table<int32_t>() {
+    static const KernelTable<int32_t> t = makeKernelTable<ScalarOps<int32_t, int64_t>>();
+    return t;
+}
+
+} // namespace scalar
+
+bool isSupported(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar:
+            return true;
+#if defined(MM_HAVE_X86_SIMD)
+        case Isa::SSE:
+            return __builtin_cpu_supports("sse4.1");
+        case Isa::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+Isa detectIsa() {
+    static const Isa best = isSupported(Isa::AVX2) ? Isa::AVX2
+                          : isSupported(Isa::SSE) ? Isa::SSE
+                          : Isa::Scalar;
+    return best;
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::SSE: return "SSE4.1";
+        case Isa::AVX2: return "AVX2";
+        default: return "scalar";
+    }
+}
+
+template<typename T>
+const KernelTable<T>& kernels(Isa isa) {
+    if (!isSupported(isa)) {
+        throw std::invalid_argument(std::string("Instruction set not supported: ") + isaName(isa));
+    }
+    switch (isa) {
+#if defined(MM_HAVE_X86_SIMD)
+        case Isa::SSE:
+            return sse::table<T>();
+        case Isa::AVX2:
+            return avx2::table<T>();
+#endif
+        default:
+            return scalar::table<T>();
+    }
+}
+
+template<typename T>
+const KernelTable<T>& kernels() {
+    static const KernelTable<T>& best = kernels<T>(detectIsa());
+    return best;
+}
+
+template const KernelTable<float>& kernels<float>(Isa);
+template const KernelTable<double>& kernels<double>(Isa);
+template const KernelTable<int32_t>& kernels<int32_t>(Isa);
+template const KernelTable<float>& kernels<float>();
+template const KernelTable<double>& kernels<double>();
+template const KernelTable<int32_t>& kernels<int32_t>();
+
+} // namespace simd
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Numeric kernels that run in place on arena memory. Every kernel exists in a
+// scalar, an SSE4.1 and an AVX2 flavour; the best one the CPU supports is
+// picked at runtime. Pointers do not need to be aligned.
+namespace simd {
+
+enum class Isa {
+    Scalar,
+    SSE,
+    AVX2
+};
+
+// Best instruction set supported by the running CPU
+Isa detectIsa();
+bool isSupported(Isa isa);
+const char* isaName(Isa isa);
+
+// Accumulator type used by reductions (sum, dot)
+template<typename T> struct Accumulator { using type = double; };
+template<> struct Accumulator<int32_t> { using type = int64_t; };
+
+template<typename T>
+struct KernelTable {
+    using Acc = typename Accumulator<T>::type;
+
+    Acc (*sum)(const T* data, size_t count);
+    T (*min)(const T* data, size_t count);
+    T (*max)(const T* data, size_t count);
+    Acc (*dot)(const T* a, const T* b, size_t count);
+    void (*scale)(T* data, size_t count, T factor);
+    void (*fill)(T* data, size_t count, T value);
+    void (*add)(T* dst, const T* src, size_t count);
+};
+
+// Kernel table for a given instruction set (must be supported)
+template<typename T>
+const KernelTable<T>& kernels(Isa isa);
+
+// Kernel table for the best supported instruction set
+template<typename T>
+const KernelTable<T>& kernels();
+
+} // namespace simd
@@ -0,0 +1,168 @@
+// AVX2 kernels. This file is compiled with -mavx2 and must only be entered
+// after simd::isSupported(Isa::AVX2) returned true.
+#include "simd_kernels_impl.h"
+
+#if defined(MM_HAVE_X86_SIMD)
+#include <immintrin.h>
+
+namespace simd {
+namespace avx2 {
+
+struct FloatOps {
+    using T = float;
+    using V = __m256;
+    using A = __m256d;  // four double partial sums, as the scalar kernel adds in double
+    using Acc = double;
+    static constexpr size_t W = 8;
+
+    static V load(const T* p) { return _mm256_loadu_ps(p); }
+    static void store(T* p, V v) { _mm256_storeu_ps(p, v); }
+    static V set1(T x) { return _mm256_set1_ps(x); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V vmin(V a, V b) { return _mm256_min_ps(a, b); }
+    static V vmax(V a, V b) { return _mm256_max_ps(a, b); }
+
+    static __m256d lo64(V v) { return _mm256_cvtps_pd(_mm256_castps256_ps128(v)); }
+    static __m256d hi64(V v) { return _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)); }
+
+    static A accZero() { return _mm256_setzero_pd(); }
+    static A accAdd(A acc, V v) {
+        return _mm256_add_pd(acc, _mm256_add_pd(lo64(v), hi64(v)));
+    }
+    static A accMulAdd(A acc, V a, V b) {
+        __m256d lo = _mm256_mul_pd(lo64(a), lo64(b));
+        __m256d hi = _mm256_mul_pd(hi64(a), hi64(b));
+        return _mm256_add_pd(acc, _mm256_add_pd(lo, hi));
+    }
+    static A accCombine(A a, A b) { return _mm256_add_pd(a, b); }
+    static Acc accReduce(A acc) {
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, acc);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+    static T hmin(V v) {
+        alignas(32) T lanes[W];
+        _mm256_store_ps(lanes, v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane < result) result = lane;
+        return result;
+    }
+    static T hmax(V v) {
+        alignas(32) T lanes[W];
+        _mm256_store_ps(lanes, v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane > result) result = lane;
+        return result;
+    }
+};
+
+struct DoubleOps {
+    using T = double;
+    using V = __m256d;
+    using A = __m256d;
+    using Acc = double;
+    static constexpr size_t W = 4;
+
+    static V load(const T* p) { return _mm256_loadu_pd(p); }
+    static void store(T* p, V v) { _mm256_storeu_pd(p, v); }
+    static V set1(T x) { return _mm256_set1_pd(x); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V vmin(V a, V b) { return _mm256_min_pd(a, b); }
+    static V vmax(V a, V b) { return _mm256_max_pd(a, b); }
+
+    static A accZero() { return _mm256_setzero_pd(); }
+    static A accAdd(A acc, V v) { return _mm256_add_pd(acc, v); }
+    static A accMulAdd(A acc, V a, V b) { return _mm256_add_pd(acc, _mm256_mul_pd(a, b)); }
+    static A accCombine(A a, A b) { return _mm256_add_pd(a, b); }
+    static Acc accReduce(A acc) {
+        alignas(32) T lanes[W];
+        _mm256_store_pd(lanes, acc);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+    static T hmin(V v) {
+        alignas(32) T lanes[W];
+        _mm256_store_pd(lanes, v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane < result) result = lane;
+        return result;
+    }
+    static T hmax(V v) {
+        alignas(32) T lanes[W];
+        _mm256_store_pd(lanes, v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane > result) result = lane;
+        return result;
+    }
+};
+
+struct IntOps {
+    using T = int32_t;
+    using V = __m256i;
+    using A = __m256i;  // four 64-bit partial sums
+    using Acc = int64_t;
+    static constexpr size_t W = 8;
+
+    static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(T* p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static V set1(T x) { return _mm256_set1_epi32(x); }
+    static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+    static V vmin(V a, V b) { return _mm256_min_epi32(a, b); }
+    static V vmax(V a, V b) { return _mm256_max_epi32(a, b); }
+
+    static __m256i lo64(V v) { return _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)); }
+    static __m256i hi64(V v) { return _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)); }
+
+    static A accZero() { return _mm256_setzero_si256(); }
+    static A accAdd(A acc, V v) {
+        return _mm256_add_epi64(acc, _mm256_add_epi64(lo64(v), hi64(v)));
+    }
+    static A accMulAdd(A acc, V a, V b) {
+        // mul_epi32 multiplies the sign-extended low halves of each 64-bit lane
+        __m256i lo = _mm256_mul_epi32(lo64(a), lo64(b));
+        __m256i hi = _mm256_mul_epi32(hi64(a), hi64(b));
+        return _mm256_add_epi64(acc, _mm256_add_epi64(lo, hi));
+    }
+    static A accCombine(A a, A b) { return _mm256_add_epi64(a, b); }
+    static Acc accReduce(A acc) {
+        alignas(32) int64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    static T hmin(V v) {
+        alignas(32) T lanes[W];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane < result) result = lane;
+        return result;
+    }
+    static T hmax(V v) {
+        alignas(32) T lanes[W];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane > result) result = lane;
+        return result;
+    }
+};
+
+template<> const KernelTable<float>& table<float>() {
+    static const KernelTable<float> t = makeKernelTable<FloatOps>();
+    return t;
+}
+
+template<> const KernelTable<double>& table<double>() {
+    static const KernelTable<double> t = makeKernelTable<DoubleOps>();
+    return t;
+}
+
+template<> const KernelTable<int32_t>& table<int32_t>() {
+    static const KernelTable<int32_t> t = makeKernelTable<IntOps>();
+    return t;
+}
+
+} // namespace avx2
+} // namespace simd
+
+#endif // MM_HAVE_X86_SIMD
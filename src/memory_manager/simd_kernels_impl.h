@@ -0,0 +1,169 @@
+#pragma once
+
+// Generic kernel bodies shared by every instruction set. Each ISA translation
+// unit instantiates them with traits types declared in its own namespace, so
+// code built with different target flags never collides at link time. A
+// traits type describes its vector operations:
+//
+//   T, V, A, Acc, W          element, vector, accumulator vector, result, lanes
+//   load/store/set1          unaligned memory access and broadcast
+//   add/mul/vmin/vmax        lane-wise arithmetic
+//   accZero/accAdd/accMulAdd/accCombine/accReduce   widening reductions
+//   hmin/hmax                horizontal min/max of one vector
+
+#include <cstddef>
+#include <type_traits>
+#include "simd_kernels.h"
+
+namespace simd {
+namespace scalar { template<typename T> const KernelTable<T>& table(); }
+namespace sse { template<typename T> const KernelTable<T>& table(); }
+namespace avx2 { template<typename T> const KernelTable<T>& table(); }
+} // namespace simd
+
+// Integer lanes wrap on overflow like the SIMD instructions do; done in
+// unsigned arithmetic because signed overflow is undefined in C++
+template<typename T>
+T wrapAdd(T a, T b) {
+    if constexpr (std::is_integral_v<T>) {
+        using U = std::make_unsigned_t<T>;
+        return static_cast<T>(static_cast<U>(a) + static_cast<U>(b));
+    } else {
+        return a + b;
+    }
+}
+
+template<typename T>
+T wrapMul(T a, T b) {
+    if constexpr (std::is_integral_v<T>) {
+        using U = std::make_unsigned_t<T>;
+        return static_cast<T>(static_cast<U>(a) * static_cast<U>(b));
+    } else {
+        return a * b;
+    }
+}
+
+template<typename Tr>
+typename Tr::Acc kernelSum(const typename Tr::T* data, size_t count) {
+    typename Tr::A acc0 = Tr::accZero();
+    typename Tr::A acc1 = Tr::accZero();
+    size_t i = 0;
+    // Two independent accumulators hide the add latency
+    for (; i + 2 * Tr::W <= count; i += 2 * Tr::W) {
+        acc0 = Tr::accAdd(acc0, Tr::load(data + i));
+        acc1 = Tr::accAdd(acc1, Tr::load(data + i + Tr::W));
+    }
+    for (; i + Tr::W <= count; i += Tr::W) {
+        acc0 = Tr::accAdd(acc0, Tr::load(data + i));
+    }
+    typename Tr::Acc result = Tr::accReduce(Tr::accCombine(acc0, acc1));
+    for (; i < count; ++i) {
+        result += data[i];
+    }
+    return result;
+}
+
+template<typename Tr>
+typename Tr::Acc kernelDot(const typename Tr::T* a, const typename Tr::T* b, size_t count) {
+    typename Tr::A acc0 = Tr::accZero();
+    typename Tr::A acc1 = Tr::accZero();
+    size_t i = 0;
+    for (; i + 2 * Tr::W <= count; i += 2 * Tr::W) {
+        acc0 = Tr::accMulAdd(acc0, Tr::load(a + i), Tr::load(b + i));
+        acc1 = Tr::accMulAdd(acc1, Tr::load(a + i + Tr::W), Tr::load(b + i + Tr::W));
+    }
+    for (; i + Tr::W <= count; i += Tr::W) {
+        acc0 = Tr::accMulAdd(acc0, Tr::load(a + i), Tr::load(b + i));
+    }
+    typename Tr::Acc result = Tr::accReduce(Tr::accCombine(acc0, acc1));
+    for (; i < count; ++i) {
+        result += static_cast<typename Tr::Acc>(a[i]) * static_cast<typename Tr::Acc>(b[i]);
+    }
+    return result;
+}
+
+template<typename Tr>
+typename Tr::T kernelMin(const typename Tr::T* data, size_t count) {
+    using T = typename Tr::T;
+    if (count == 0) return T{};
+    T result = data[0];
+    size_t i = 0;
+    if (count >= Tr::W) {
+        typename Tr::V m = Tr::load(data);
+        for (i = Tr::W; i + Tr::W <= count; i += Tr::W) {
+            m = Tr::vmin(m, Tr::load(data + i));
+        }
+        result = Tr::hmin(m);
+    }
+    for (; i < count; ++i) {
+        if (data[i] < result) result = data[i];
+    }
+    return result;
+}
+
+template<typename Tr>
+typename Tr::T kernelMax(const typename Tr::T* data, size_t count) {
+    using T = typename Tr::T;
+    if (count == 0) return T{};
+    T result = data[0];
+    size_t i = 0;
+    if (count >= Tr::W) {
+        typename Tr::V m = Tr::load(data);
+        for (i = Tr::W; i + Tr::W <= count; i += Tr::W) {
+            m = Tr::vmax(m, Tr::load(data + i));
+        }
+        result = Tr::hmax(m);
+    }
+    for (; i < count; ++i) {
+        if (data[i] > result) result = data[i];
+    }
+    return result;
+}
+
+template<typename Tr>
+void kernelScale(typename Tr::T* data, size_t count, typename Tr::T factor) {
+    const typename Tr::V f = Tr::set1(factor);
+    size_t i = 0;
+    for (; i + Tr::W <= count; i += Tr::W) {
+        Tr::store(data + i, Tr::mul(Tr::load(data + i), f));
+    }
+    for (; i < count; ++i) {
+        data[i] = wrapMul(data[i], factor);
+    }
+}
+
+template<typename Tr>
+void kernelFill(typename Tr::T* data, size_t count, typename Tr::T value) {
+    const typename Tr::V v = Tr::set1(value);
+    size_t i = 0;
+    for (; i + Tr::W <= count; i += Tr::W) {
+        Tr::store(data + i, v);
+    }
+    for (; i < count; ++i) {
+        data[i] = value;
+    }
+}
+
+template<typename Tr>
+void kernelAdd(typename Tr::T* dst, const typename Tr::T* src, size_t count) {
+    size_t i = 0;
+    for (; i + Tr::W <= count; i += Tr::W) {
+        Tr::store(dst + i, Tr::add(Tr::load(dst + i), Tr::load(src + i)));
+    }
+    for (; i < count; ++i) {
+        dst[i] = wrapAdd(dst[i], src[i]);
+    }
+}
+
+template<typename Tr>
+simd::KernelTable<typename Tr::T> makeKernelTable() {
+    return {
+        &kernelSum<Tr>,
+        &kernelMin<Tr>,
+        &kernelMax<Tr>,
+        &kernelDot<Tr>,
+        &kernelScale<Tr>,
+        &kernelFill<Tr>,
+        &kernelAdd<Tr>
+    };
+}
@@ -0,0 +1,164 @@
+// SSE4.1 kernels. This file is compiled with -msse4.1 and must only be entered
+// after simd::isSupported(Isa::SSE) returned true.
+#include "simd_kernels_impl.h"
+
+#if defined(MM_HAVE_X86_SIMD)
+#include <smmintrin.h>
+
+namespace simd {
+namespace sse {
+
+struct FloatOps {
+    using T = float;
+    using V = __m128;
+    using A = __m128d;  // two double partial sums, as the scalar kernel adds in double
+    using Acc = double;
+    static constexpr size_t W = 4;
+
+    static V load(const T* p) { return _mm_loadu_ps(p); }
+    static void store(T* p, V v) { _mm_storeu_ps(p, v); }
+    static V set1(T x) { return _mm_set1_ps(x); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V vmin(V a, V b) { return _mm_min_ps(a, b); }
+    static V vmax(V a, V b) { return _mm_max_ps(a, b); }
+
+    static __m128d lo64(V v) { return _mm_cvtps_pd(v); }
+    static __m128d hi64(V v) { return _mm_cvtps_pd(_mm_movehl_ps(v, v)); }
+
+    static A accZero() { return _mm_setzero_pd(); }
+    static A accAdd(A acc, V v) {
+        return _mm_add_pd(acc, _mm_add_pd(lo64(v), hi64(v)));
+    }
+    static A accMulAdd(A acc, V a, V b) {
+        __m128d lo = _mm_mul_pd(lo64(a), lo64(b));
+        __m128d hi = _mm_mul_pd(hi64(a), hi64(b));
+        return _mm_add_pd(acc, _mm_add_pd(lo, hi));
+    }
+    static A accCombine(A a, A b) { return _mm_add_pd(a, b); }
+    static Acc accReduce(A acc) {
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, acc);
+        return lanes[0] + lanes[1];
+    }
+    static T hmin(V v) {
+        alignas(16) T lanes[W];
+        _mm_store_ps(lanes, v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane < result) result = lane;
+        return result;
+    }
+    static T hmax(V v) {
+        alignas(16) T lanes[W];
+        _mm_store_ps(lanes, v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane > result) result = lane;
+        return result;
+    }
+};
+
+struct DoubleOps {
+    using T = double;
+    using V = __m128d;
+    using A = __m128d;
+    using Acc = double;
+    static constexpr size_t W = 2;
+
+    static V load(const T* p) { return _mm_loadu_pd(p); }
+    static void store(T* p, V v) { _mm_storeu_pd(p, v); }
+    static V set1(T x) { return _mm_set1_pd(x); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V vmin(V a, V b) { return _mm_min_pd(a, b); }
+    static V vmax(V a, V b) { return _mm_max_pd(a, b); }
+
+    static A accZero() { return _mm_setzero_pd(); }
+    static A accAdd(A acc, V v) { return _mm_add_pd(acc, v); }
+    static A accMulAdd(A acc, V a, V b) { return _mm_add_pd(acc, _mm_mul_pd(a, b)); }
+    static A accCombine(A a, A b) { return _mm_add_pd(a, b); }
+    static Acc accReduce(A acc) {
+        alignas(16) T lanes[W];
+        _mm_store_pd(lanes, acc);
+        return lanes[0] + lanes[1];
+    }
+    static T hmin(V v) {
+        alignas(16) T lanes[W];
+        _mm_store_pd(lanes, v);
+        return lanes[1] < lanes[0] ? lanes[1] : lanes[0];
+    }
+    static T hmax(V v) {
+        alignas(16) T lanes[W];
+        _mm_store_pd(lanes, v);
+        return lanes[1] > lanes[0] ? lanes[1] : lanes[0];
+    }
+};
+
+struct IntOps {
+    using T = int32_t;
+    using V = __m128i;
+    using A = __m128i;  // two 64-bit partial sums
+    using Acc = int64_t;
+    static constexpr size_t W = 4;
+
+    static V load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(T* p, V v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static V set1(T x) { return _mm_set1_epi32(x); }
+    static V add(V a, V b) { return _mm_add_epi32(a, b); }
+    static V mul(V a, V b) { return _mm_mullo_epi32(a, b); }
+    static V vmin(V a, V b) { return _mm_min_epi32(a, b); }
+    static V vmax(V a, V b) { return _mm_max_epi32(a, b); }
+
+    static __m128i lo64(V v) { return _mm_cvtepi32_epi64(v); }
+    static __m128i hi64(V v) { return _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)); }
+
+    static A accZero() { return _mm_setzero_si128(); }
+    static A accAdd(A acc, V v) {
+        return _mm_add_epi64(acc, _mm_add_epi64(lo64(v), hi64(v)));
+    }
+    static A accMulAdd(A acc, V a, V b) {
+        // mul_epi32 multiplies the sign-extended low halves of each 64-bit lane
+        __m128i lo = _mm_mul_epi32(lo64(a), lo64(b));
+        __m128i hi = _mm_mul_epi32(hi64(a), hi64(b));
+        return _mm_add_epi64(acc, _mm_add_epi64(lo, hi));
+    }
+    static A accCombine(A a, A b) { return _mm_add_epi64(a, b); }
+    static Acc accReduce(A acc) {
+        alignas(16) int64_t lanes[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        return lanes[0] + lanes[1];
+    }
+    static T hmin(V v) {
+        alignas(16) T lanes[W];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane < result) result = lane;
+        return result;
+    }
+    static T hmax(V v) {
+        alignas(16) T lanes[W];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v);
+        T result = lanes[0];
+        for (T lane : lanes) if (lane > result) result = lane;
+        return result;
+    }
+};
+
+template<> const KernelTable<float>& table<float>() {
+    static const KernelTable<float> t = makeKernelTable<FloatOps>();
+    return t;
+}
+
+template<> const KernelTable<double>& table<double>() {
+    static const KernelTable<double> t = makeKernelTable<DoubleOps>();
+    return t;
+}
+
+template<> const KernelTable<int32_t>& table<int32_t>() {
+    static const KernelTable<int32_t> t = makeKernelTable<IntOps>();
+    return t;
+}
+
+} // namespace sse
+} // namespace simd
+
+#endif // MM_HAVE_X86_SIMD
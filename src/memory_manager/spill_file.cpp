@@ -0,0 +1,110 @@
+#include "spill_file.h"
+#include "common/log.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+
+SpillFile::SpillFile(const std::string& path, size_t capacity) : path(path), capacity(capacity) {
+    // Contents never outlive the process; a restart recovers from the WAL
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        MP_LOG_ERROR("Cannot open spill file " << path << ": " << std::strerror(errno));
+    }
+}
+
+SpillFile::~SpillFile() {
+    if (fd >= 0) {
+        ::close(fd);
+        std::remove(path.c_str());
+    }
+}
+
+size_t SpillFile::write(const void* data, size_t size) {
+    if (fd < 0) return kNoSlot;
+
+    size_t slot = kNoSlot;
+    for (auto it = freeSlots.begin(); it != freeSlots.end(); ++it) {
+        if (it->second >= size) {
+            slot = it->first;
+            size_t remaining = it->second - size;
+            freeSlots.erase(it);
+            if (remaining > 0) {
+                freeSlots[slot + size] = remaining;
+            }
+            break;
+        }
+    }
+    if (slot == kNoSlot) {
+        if (top + size > capacity) return kNoSlot;
+        slot = top;
+        top += size;
+    }
+
+    const char* bytes = static_cast<const char*>(data);
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = ::pwrite(fd, bytes + written, size - written, slot + written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            MP_LOG_ERROR("Spill write failed: " << std::strerror(errno));
+            freeRange(slot, size);
+            return kNoSlot;
+        }
+        written += static_cast<size_t>(n);
+    }
+    usedBytes += size;
+    return slot;
+}
+
+bool SpillFile::read(size_t slot, void* data, size_t size) const {
+    char* bytes = static_cast<char*>(data);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, bytes + done, size - done, slot + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void SpillFile::release(size_t slot, size_t size) {
+    usedBytes -= size;
+    freeRange(slot, size);
+}
+
+void SpillFile::clear() {
+    freeSlots.clear();
+    top = 0;
+    usedBytes = 0;
+    if (fd >= 0 && ::ftruncate(fd, 0) != 0) {
+        MP_LOG_ERROR("Spill truncate failed: " << std::strerror(errno));
+    }
+}
+
+void SpillFile::freeRange(size_t slot, size_t size) {
+    if (size == 0) return;
+
+    // Coalesce with neighbouring holes, as the arena does
+    auto next = freeSlots.lower_bound(slot);
+    if (next != freeSlots.end() && slot + size == next->first) {
+        size += next->second;
+        next = freeSlots.erase(next);
+    }
+    if (next != freeSlots.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == slot) {
+            slot = prev->first;
+            size += prev->second;
+            freeSlots.erase(prev);
+        }
+    }
+    if (slot + size == top) {
+        top = slot;
+    } else {
+        freeSlots[slot] = size;
+    }
+}
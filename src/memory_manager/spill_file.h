@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+// Backing store for blocks evicted from the arena (mem-mgr --spillMB).
+// Slots are carved first-fit out of one file in the dump folder and reused
+// once a block is faulted back in or freed. Callers hold the memory
+// manager mutex.
+class SpillFile {
+public:
+    static constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+    SpillFile(const std::string& path, size_t capacity);
+    ~SpillFile();
+
+    bool isOpen() const { return fd >= 0; }
+
+    // Stores `size` bytes and returns the slot offset, or kNoSlot when full
+    size_t write(const void* data, size_t size);
+    bool read(size_t slot, void* data, size_t size) const;
+    void release(size_t slot, size_t size);
+
+    // Forgets every slot (a backup starting over from a snapshot)
+    void clear();
+
+    size_t used() const { return usedBytes; }
+
+private:
+    int fd = -1;
+    std::string path;
+    size_t capacity;
+    size_t top = 0;                        // End of the highest slot
+    size_t usedBytes = 0;
+    std::map<size_t, size_t> freeSlots;    // Holes below top: offset -> size
+
+    void freeRange(size_t slot, size_t size);
+};
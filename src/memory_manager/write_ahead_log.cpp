@@ -0,0 +1,296 @@
+#include "write_ahead_log.h"
+#include "common/log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kCheckpointMagic[4] = {'M', 'P', 'C', 'K'};
+constexpr size_t kNoRoll = static_cast<size_t>(-1);
+constexpr uint32_t kMaxFrame = 1u << 30;
+
+uint32_t fnv1a(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Reads frames until the end or the first damaged one
+void readFrames(std::istream& in, const std::function<void(const memory_service::MutationRecord&)>& visit) {
+    std::string payload;
+    while (true) {
+        uint32_t header[2];
+        if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) return;
+        if (header[0] > kMaxFrame) return;
+        payload.resize(header[0]);
+        if (!in.read(&payload[0], header[0])) return;
+        if (fnv1a(payload.data(), payload.size()) != header[1]) return;
+        memory_service::MutationRecord record;
+        if (!record.ParseFromString(payload)) return;
+        visit(record);
+    }
+}
+
+void syncDirectory(const std::string& directory) {
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& directory, std::chrono::microseconds commitWindow,
+                             size_t commitBytes)
+    : directory_(directory), commitWindow_(commitWindow), commitBytes_(commitBytes), rollOffset_(kNoRoll) {
+    std::filesystem::create_directories(directory_);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    stop();
+}
+
+std::string WriteAheadLog::segmentPath(uint64_t firstSequence) const {
+    std::ostringstream name;
+    name << directory_ << "/wal-" << std::setw(20) << std::setfill('0') << firstSequence << ".log";
+    return name.str();
+}
+
+std::vector<std::pair<uint64_t, std::string>> WriteAheadLog::listSegments() const {
+    std::vector<std::pair<uint64_t, std::string>> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() > 8 && name.compare(0, 4, "wal-") == 0 && name.compare(name.size() - 4, 4, ".log") == 0) {
+            segments.emplace_back(std::stoull(name.substr(4, name.size() - 8)), entry.path().string());
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+void WriteAheadLog::frame(const memory_service::MutationRecord& record, std::string& out) {
+    std::string payload = record.SerializeAsString();
+    uint32_t header[2] = {static_cast<uint32_t>(payload.size()), fnv1a(payload.data(), payload.size())};
+    out.append(reinterpret_cast<const char*>(header), sizeof(header));
+    out.append(payload);
+}
+
+uint64_t WriteAheadLog::replay(const std::function<void(const memory_service::MutationRecord&)>& apply) {
+    uint64_t covered = 0;
+    std::ifstream checkpoint(directory_ + "/checkpoint.bin", std::ios::binary);
+    if (checkpoint) {
+        char magic[sizeof(kCheckpointMagic)];
+        if (checkpoint.read(magic, sizeof(magic)) && std::memcmp(magic, kCheckpointMagic, sizeof(magic)) == 0 &&
+            checkpoint.read(reinterpret_cast<char*>(&covered), sizeof(covered))) {
+            readFrames(checkpoint, apply);
+        } else {
+            MP_LOG_WARN("WAL: ignoring unreadable checkpoint");
+            covered = 0;
+        }
+    }
+
+    uint64_t last = covered;
+    for (const auto& segment : listSegments()) {
+        std::ifstream in(segment.second, std::ios::binary);
+        readFrames(in, [&](const memory_service::MutationRecord& record) {
+            if (record.sequence() > covered) {
+                apply(record);
+            }
+            last = std::max(last, record.sequence());
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    lastSequence_ = last;
+    durableSequence_ = last;
+    return last;
+}
+
+bool WriteAheadLog::openSegment(uint64_t firstSequence) {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    // A leftover file with this name can only hold a torn, unacknowledged tail
+    fd_ = ::open(segmentPath(firstSequence).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd_ < 0) {
+        MP_LOG_ERROR("WAL: cannot open segment: " << std::strerror(errno));
+        return false;
+    }
+    syncDirectory(directory_);
+    return true;
+}
+
+bool WriteAheadLog::start() {
+    uint64_t first;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first = lastSequence_ + 1;
+        stopping_ = false;
+    }
+    if (!openSegment(first)) {
+        return false;
+    }
+    flusher_ = std::thread(&WriteAheadLog::flushLoop, this);
+    return true;
+}
+
+void WriteAheadLog::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    pendingCv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+uint64_t WriteAheadLog::append(memory_service::MutationRecord record) {
+    bool wake;
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sequence = ++lastSequence_;
+        record.set_sequence(sequence);
+        wake = pending_.empty();
+        frame(record, pending_);
+        wake = wake || pending_.size() >= commitBytes_;
+    }
+    if (wake) {
+        pendingCv_.notify_one();
+    }
+    return sequence;
+}
+
+bool WriteAheadLog::waitDurable(uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    durableCv_.wait(lock, [&] { return durableSequence_ >= sequence || failed_; });
+    return durableSequence_ >= sequence;
+}
+
+uint64_t WriteAheadLog::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastSequence_;
+}
+
+bool WriteAheadLog::writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            MP_LOG_ERROR("WAL: write failed: " << std::strerror(errno));
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void WriteAheadLog::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        pendingCv_.wait(lock, [&] { return stopping_ || !pending_.empty() || rollOffset_ != kNoRoll; });
+        if (pending_.empty() && rollOffset_ == kNoRoll) {
+            break;  // Stopping with nothing left
+        }
+
+        // Group commit: let concurrent writers join this batch
+        if (commitWindow_.count() > 0 && !stopping_) {
+            pendingCv_.wait_for(lock, commitWindow_, [&] {
+                return stopping_ || pending_.size() >= commitBytes_;
+            });
+        }
+
+        std::string batch;
+        batch.swap(pending_);
+        uint64_t batchLast = lastSequence_;
+        size_t rollAt = rollOffset_;
+        uint64_t rollSequence = rollSequence_;
+        rollOffset_ = kNoRoll;
+        lock.unlock();
+
+        bool ok;
+        if (rollAt != kNoRoll) {
+            // Records up to the checkpoint mark finish the old segment
+            ok = writeAll(fd_, batch.data(), rollAt) && ::fdatasync(fd_) == 0 &&
+                 openSegment(rollSequence + 1) &&
+                 writeAll(fd_, batch.data() + rollAt, batch.size() - rollAt);
+        } else {
+            ok = writeAll(fd_, batch.data(), batch.size());
+        }
+        ok = ok && ::fdatasync(fd_) == 0;
+
+        lock.lock();
+        if (ok) {
+            durableSequence_ = batchLast;
+        } else {
+            failed_ = true;
+        }
+        durableCv_.notify_all();
+        if (!ok) {
+            break;
+        }
+    }
+}
+
+uint64_t WriteAheadLog::mark() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rollOffset_ = pending_.size();
+    rollSequence_ = lastSequence_;
+    pendingCv_.notify_one();  // Roll even if nothing else is written for a while
+    return lastSequence_;
+}
+
+bool WriteAheadLog::writeCheckpoint(const std::vector<memory_service::MutationRecord>& snapshot,
+                                    uint64_t sequence) {
+    std::string data(kCheckpointMagic, sizeof(kCheckpointMagic));
+    data.append(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+    for (const auto& record : snapshot) {
+        frame(record, data);
+    }
+
+    // Write-then-rename so a crash leaves either checkpoint intact
+    std::string path = directory_ + "/checkpoint.bin";
+    std::string temp = path + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = writeAll(fd, data.data(), data.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    syncDirectory(directory_);
+
+    {
+        // Only delete once the flusher has moved on to the new segment
+        std::unique_lock<std::mutex> lock(mutex_);
+        durableCv_.wait(lock, [&] { return rollOffset_ == kNoRoll || failed_ || stopping_; });
+    }
+
+    // A segment is redundant once the next one starts at or before sequence + 1
+    auto segments = listSegments();
+    for (size_t i = 0; i + 1 < segments.size(); ++i) {
+        if (segments[i + 1].first <= sequence + 1) {
+            std::filesystem::remove(segments[i].second);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "memory_service.pb.h"
+
+// Durability settings (mem-mgr --walCommitUs / --walCommitKB / --checkpointSec)
+struct WalOptions {
+    bool enabled = false;
+    std::chrono::microseconds commitWindow{1000};  // How long a group commit waits for company
+    size_t commitBytes = 256 * 1024;               // ...or until this much is pending
+    std::chrono::seconds checkpointInterval{60};
+};
+
+// Append-only log of the same mutation records the replication stream uses,
+// so the exact state can be rebuilt after a crash. Appends only buffer; a
+// flusher thread writes and fsyncs whole batches (group commit), and
+// writers wait for the batch holding their record before acknowledging.
+//
+// On disk, in its own directory:
+//   wal-<first sequence>.log   segments of framed records
+//   checkpoint.bin             full snapshot covering a sequence number
+// A checkpoint lets every older segment be deleted. Each frame is
+// [length][FNV-1a checksum][serialized MutationRecord]; replay stops a
+// segment at the first torn or corrupt frame.
+class WriteAheadLog {
+public:
+    WriteAheadLog(const std::string& directory, std::chrono::microseconds commitWindow, size_t commitBytes);
+    ~WriteAheadLog();
+
+    // Applies the checkpoint and every later record in order; call before start()
+    uint64_t replay(const std::function<void(const memory_service::MutationRecord&)>& apply);
+
+    // Opens a fresh segment and starts the flusher
+    bool start();
+    void stop();
+
+    // Buffers a record and returns its sequence number (callers hold the
+    // memory manager mutex, which keeps the log in mutation order)
+    uint64_t append(memory_service::MutationRecord record);
+
+    // Blocks until `sequence` is on disk; false if the log failed
+    bool waitDurable(uint64_t sequence);
+
+    // Checkpointing is two steps: mark() under the memory manager mutex,
+    // together with taking the snapshot, returns the sequence it covers and
+    // starts a new segment for later records; writeCheckpoint() then stores
+    // the snapshot and deletes the segments it makes redundant.
+    uint64_t mark();
+    bool writeCheckpoint(const std::vector<memory_service::MutationRecord>& snapshot, uint64_t sequence);
+
+    uint64_t lastSequence() const;
+
+private:
+    std::string directory_;
+    std::chrono::microseconds commitWindow_;
+    size_t commitBytes_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable pendingCv_;   // Flusher waits for appends
+    std::condition_variable durableCv_;   // Writers wait for fsync
+    std::string pending_;                 // Framed records not yet written
+    uint64_t lastSequence_ = 0;
+    uint64_t durableSequence_ = 0;
+    size_t rollOffset_;                   // Bytes of pending_ that stay in the current segment
+    uint64_t rollSequence_ = 0;
+    bool stopping_ = false;
+    bool failed_ = false;
+
+    int fd_ = -1;                         // Current segment (flusher thread only)
+    std::thread flusher_;
+
+    void flushLoop();
+    bool openSegment(uint64_t firstSequence);
+    bool writeAll(int fd, const char* data, size_t size);
+    std::string segmentPath(uint64_t firstSequence) const;
+    std::vector<std::pair<uint64_t, std::string>> listSegments() const;
+    static void frame(const memory_service::MutationRecord& record, std::string& out);
+};
@@ -0,0 +1,218 @@
+#include "client_runtime.h"
+#include "sharded_transport.h"
+#include "replicated_transport.h"
+#include "ref_registry.h"
+#include "release_queue.h"
+#include "common/log.h"
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+static uint64_t random_session_id() {
+    std::random_device random;
+    uint64_t id = 0;
+    while (id == 0) {
+        id = (static_cast<uint64_t>(random()) << 32) | random();
+    }
+    return id;
+}
+
+ClientRuntime& ClientRuntime::getInstance() {
+    static ClientRuntime* instance = new ClientRuntime();
+    return *instance;
+}
+
+void ClientRuntime::init(const std::string& server_address, const ClientOptions& options) {
+    init(std::vector<std::string>{server_address}, options);
+}
+
+void ClientRuntime::init(const std::vector<std::string>& server_addresses, const ClientOptions& options) {
+    if (server_addresses.empty()) {
+        throw std::invalid_argument("At least one server address is required");
+    }
+    if (!options.read_replicas.empty() && server_addresses.size() != 1) {
+        throw std::invalid_argument("Read replicas need a single primary server");
+    }
+
+    auto connect = [&options](const std::string& address) {
+        grpc::ChannelArguments args;
+        // Without a local pool, channels to the same target share one
+        // subchannel and therefore one connection
+        args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+        auto channel = grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), args);
+        return std::make_shared<GrpcTransport>(channel, options.timeout);
+    };
+
+    auto state = std::make_shared<State>();
+    state->policy = options.policy;
+
+    size_t channels = options.channels > 0 ? options.channels : 1;
+    for (size_t i = 0; i < channels; ++i) {
+        if (!options.read_replicas.empty()) {
+            std::vector<std::shared_ptr<Transport>> replicas;
+            for (const auto& address : options.read_replicas) {
+                replicas.push_back(connect(address));
+            }
+            state->transports.push_back(std::make_shared<ReplicatedTransport>(
+                connect(server_addresses[0]), std::move(replicas), options.max_staleness));
+            continue;
+        }
+        if (server_addresses.size() == 1) {
+            // Plain ids, compatible with unsharded clients
+            state->transports.push_back(connect(server_addresses[0]));
+            continue;
+        }
+        std::vector<std::pair<std::string, std::shared_ptr<Transport>>> shards;
+        for (const auto& address : server_addresses) {
+            shards.emplace_back(address, connect(address));
+        }
+        state->transports.push_back(std::make_shared<ShardedTransport>(std::move(shards)));
+    }
+
+    std::atomic_store(&state_, std::shared_ptr<const State>(std::move(state)));
+    generation_.fetch_add(1, std::memory_order_release);
+    start_session(options.session_lease);
+}
+
+void ClientRuntime::init(std::shared_ptr<Transport> transport) {
+    auto state = std::make_shared<State>();
+    state->policy = ChannelPolicy::RoundRobin;
+    state->transports.push_back(std::move(transport));
+
+    std::atomic_store(&state_, std::shared_ptr<const State>(std::move(state)));
+    generation_.fetch_add(1, std::memory_order_release);
+    // The server lives and dies with this process
+    start_session(std::chrono::milliseconds(0));
+}
+
+bool ClientRuntime::is_initialized() const {
+    return snapshot() != nullptr;
+}
+
+std::shared_ptr<const ClientRuntime::State> ClientRuntime::snapshot() const {
+    return std::atomic_load(&state_);
+}
+
+std::shared_ptr<Transport> ClientRuntime::transport() {
+    auto state = snapshot();
+    if (!state) {
+        throw std::runtime_error("MPointer not initialized. Call Init() first.");
+    }
+
+    size_t index;
+    if (state->policy == ChannelPolicy::ThreadAffinity) {
+        thread_local size_t slot = next_thread_slot_.fetch_add(1, std::memory_order_relaxed);
+        index = slot;
+    } else {
+        index = next_channel_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return state->transports[index % state->transports.size()];
+}
+
+size_t ClientRuntime::channel_count() const {
+    auto state = snapshot();
+    return state ? state->transports.size() : 0;
+}
+
+uint64_t ClientRuntime::generation() const {
+    return generation_.load(std::memory_order_acquire);
+}
+
+uint64_t ClientRuntime::session_id() const {
+    return session_lease_ms_.load(std::memory_order_acquire) > 0 ? session_id_.load(std::memory_order_relaxed) : 0;
+}
+
+void ClientRuntime::start_session(std::chrono::milliseconds lease) {
+    if (lease.count() <= 0) {
+        session_lease_ms_.store(0, std::memory_order_release);
+        return;
+    }
+    if (session_id_.load(std::memory_order_relaxed) == 0) {
+        session_id_.store(random_session_id(), std::memory_order_relaxed);
+    }
+    session_lease_ms_.store(lease.count(), std::memory_order_release);
+    // A new backend may never have seen the session
+    session_open_.store(false, std::memory_order_relaxed);
+
+    // Open the session before the first reference is taken; a server
+    // without sessions simply ignores the session id on requests
+    send_heartbeat();
+    if (!heartbeat_started_.exchange(true)) {
+        // Never joined: the runtime lives until the process exits
+        std::thread(&ClientRuntime::heartbeat_loop, this).detach();
+    }
+}
+
+bool ClientRuntime::send_heartbeat() {
+    int64_t lease_ms = session_lease_ms_.load(std::memory_order_acquire);
+    auto state = snapshot();
+    if (lease_ms <= 0 || !state) {
+        return false;
+    }
+
+    memory_service::HeartbeatRequest request;
+    memory_service::HeartbeatResponse response;
+    request.set_session_id(session_id_.load(std::memory_order_relaxed));
+    request.set_lease_ms(static_cast<uint32_t>(lease_ms));
+    request.set_resume(session_open_.load(std::memory_order_relaxed));
+    // Every channel reaches the same servers, so one is enough
+    grpc::Status status = state->transports.front()->Heartbeat(request, &response);
+    if (status.ok() && response.expired()) {
+        renew_session();
+        return false;
+    }
+    bool ok = status.ok() && response.success();
+    if (ok) {
+        session_open_.store(true, std::memory_order_relaxed);
+    }
+    return ok;
+}
+
+void ClientRuntime::renew_session() {
+    // The server already dropped the old session's references, so releases
+    // stamped with it are ignored; take them again under a new one. Blocks
+    // freed in the meantime are gone and their handles dangle.
+    //
+    // The swap happens with the release queue idle and the registry locked.
+    // Ids whose claim is still queued are skipped: the claim goes out under
+    // the new session and hands it the reservation's reference, so taking
+    // one here as well would leave a reference nobody releases. Likewise a
+    // handle's 0->1 reads the session under the registry lock, so it is
+    // either in the list (old session) or takes its own (new session).
+    uint64_t session = random_session_id();
+    std::vector<uint64_t> held;
+    ReleaseQueue::getInstance().while_idle([&] {
+        held = RefRegistry::getInstance().renew([&] {
+            session_id_.store(session, std::memory_order_relaxed);
+            session_open_.store(false, std::memory_order_relaxed);
+        });
+    });
+    if (!send_heartbeat()) {
+        return;
+    }
+
+    size_t retaken = 0;
+    size_t lost = 0;
+    for (uint64_t id : held) {
+        memory_service::RefCountRequest request;
+        memory_service::RefCountResponse response;
+        request.set_id(id);
+        request.set_session_id(session);
+        grpc::Status status = transport()->IncreaseRefCount(request, &response);
+        if (status.ok() && response.success()) {
+            retaken++;
+        } else {
+            lost++;
+        }
+    }
+    MP_LOG_WARN("Session expired; reopened with " << retaken << " references, " << lost
+                << " blocks already freed");
+}
+
+void ClientRuntime::heartbeat_loop() {
+    while (true) {
+        int64_t lease_ms = session_lease_ms_.load(std::memory_order_acquire);
+        std::this_thread::sleep_for(std::chrono::milliseconds(lease_ms > 0 ? lease_ms / 3 : 1000));
+        send_heartbeat();
+    }
+}
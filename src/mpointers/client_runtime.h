@@ -0,0 +1,97 @@
+#ifndef CLIENT_RUNTIME_H
+#define CLIENT_RUNTIME_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "transport.h"
+
+// How calls are spread over the channel pool
+enum class ChannelPolicy {
+    RoundRobin,      // Each call takes the next channel
+    ThreadAffinity   // Each thread sticks to one channel
+};
+
+struct ClientOptions {
+    size_t channels = 1;  // Independent HTTP/2 connections to the server
+    ChannelPolicy policy = ChannelPolicy::RoundRobin;
+    std::chrono::milliseconds timeout = std::chrono::seconds(5);
+
+    // Backups of a single primary (mem-mgr --replicaOf) that may serve reads
+    // no older than max_staleness; writes always go to the primary
+    std::vector<std::string> read_replicas;
+    std::chrono::milliseconds max_staleness = std::chrono::seconds(1);
+
+    // References this process holds are tied to a session renewed every
+    // third of the lease; if the process dies, the server drops them once
+    // the lease runs out. Zero disables sessions.
+    std::chrono::milliseconds session_lease = std::chrono::seconds(10);
+};
+
+// Process-wide connection state shared by every MPointer<T> instantiation:
+// one pool of transports to the memory manager, used by all types and threads.
+class ClientRuntime {
+public:
+    // Never destroyed: deferred releases are flushed at exit through it
+    static ClientRuntime& getInstance();
+
+    // (Re)connects the pool; handles keep working across re-initialization
+    void init(const std::string& server_address, const ClientOptions& options);
+
+    // Several servers: blocks are sharded over them (see ShardedTransport)
+    void init(const std::vector<std::string>& server_addresses, const ClientOptions& options);
+
+    // Uses a single caller-provided transport (e.g. InProcessTransport)
+    void init(std::shared_ptr<Transport> transport);
+
+    bool is_initialized() const;
+
+    // Transport for the next call according to the channel policy (throws
+    // std::runtime_error if not initialized)
+    std::shared_ptr<Transport> transport();
+
+    size_t channel_count() const;
+
+    // Bumped by every init; state tied to the previous backend is stale
+    uint64_t generation() const;
+
+    // Session to stamp on requests that take or drop references; 0 when
+    // sessions are disabled (always for a caller-provided transport). If
+    // the server reports the session expired (the process stalled longer
+    // than the lease), a new one is opened and live handles take their
+    // references again.
+    uint64_t session_id() const;
+
+private:
+    ClientRuntime() = default;
+    ClientRuntime(const ClientRuntime&) = delete;
+    ClientRuntime& operator=(const ClientRuntime&) = delete;
+
+    struct State {
+        std::vector<std::shared_ptr<Transport>> transports;
+        ChannelPolicy policy;
+    };
+
+    // Replaced wholesale on init; readers take a snapshot
+    std::shared_ptr<const State> state_;
+    std::atomic<size_t> next_channel_{0};
+    std::atomic<size_t> next_thread_slot_{0};
+    std::atomic<uint64_t> generation_{0};
+
+    // One session per process, shared by every server it talks to
+    std::atomic<uint64_t> session_id_{0};
+    std::atomic<int64_t> session_lease_ms_{0};
+    std::atomic<bool> session_open_{false};  // A heartbeat got through since init or renewal
+    std::atomic<bool> heartbeat_started_{false};
+
+    std::shared_ptr<const State> snapshot() const;
+    void start_session(std::chrono::milliseconds lease);
+    bool send_heartbeat();
+    void renew_session();
+    void heartbeat_loop();
+};
+
+#endif // CLIENT_RUNTIME_H
@@ -1,5 +1,8 @@
 #include "mpointer.h"
 #include "node.h"
+#include "ref_registry.h"
+#include "release_queue.h"
+#include "reservation_pool.h"
 #include <grpcpp/grpcpp.h>
 #include <sstream>
 #include <cstring>
@@ -8,37 +11,143 @@
 #include "../../build/src/proto/memory_service.pb.h"
 #include "../../build/src/proto/memory_service.grpc.pb.h"
 
-// Forward declare the specialization before any use
-template<>
-void MPointer<Node>::set_id_directly(uint64_t id);
-
 // Implementación de la función auxiliar set_mpointer_id para Node
 void Node::set_mpointer_id(MPointer<Node>& ptr, uint64_t id) {
     // Acceder directamente al campo privado id_ a través de un método amigo
     ptr.set_id_directly(id);
 }
 
-// Método auxiliar para set_id_directly en MPointer<Node>
-template<>
-void MPointer<Node>::set_id_directly(uint64_t id) {
+// Adopts a raw id as a counted reference
+template<typename T>
+void MPointer<T>::set_id_directly(uint64_t id) {
+    if (id == id_) {
+        return;
+    }
+    reset();
     id_ = id;
+    if (id_ != 0) {
+        increase_ref_count();
+    }
 }
 
 template<typename T>
-std::unique_ptr<memory_service::MemoryManager::Stub> MPointer<T>::stub_;
+void MPointer<T>::Init(const std::string& server_address, std::chrono::milliseconds timeout) {
+    ClientOptions options;
+    options.timeout = timeout;
+    Init(server_address, options);
+}
 
 template<typename T>
-std::chrono::milliseconds MPointer<T>::timeout_ = std::chrono::seconds(5);
+void MPointer<T>::Init(const std::string& server_address, const ClientOptions& options) {
+    ClientRuntime::getInstance().init(server_address, options);
+    ReleaseQueue::getInstance().start();
+}
 
 template<typename T>
-std::mutex MPointer<T>::stub_mutex_;
+void MPointer<T>::Init(const std::vector<std::string>& server_addresses, const ClientOptions& options) {
+    ClientRuntime::getInstance().init(server_addresses, options);
+    ReleaseQueue::getInstance().start();
+}
 
 template<typename T>
-void MPointer<T>::Init(const std::string& server_address, std::chrono::milliseconds timeout) {
-    std::lock_guard<std::mutex> lock(stub_mutex_);
-    auto channel = grpc::CreateChannel(server_address, grpc::InsecureChannelCredentials());
-    stub_ = memory_service::MemoryManager::NewStub(channel);
-    timeout_ = timeout;
+void MPointer<T>::Init(std::shared_ptr<Transport> transport) {
+    ClientRuntime::getInstance().init(std::move(transport));
+    ReleaseQueue::getInstance().start();
+}
+
+template<typename T>
+std::shared_ptr<Transport> MPointer<T>::transport() {
+    return ClientRuntime::getInstance().transport();
+}
+
+template<typename T>
+void MPointer<T>::flush() {
+    ReleaseQueue::getInstance().flush();
+}
+
+template<typename T>
+uint64_t MPointer<T>::CreateRegion(size_t chunk_size) {
+    check_connection();
+    
+    memory_service::CreateRegionRequest request;
+    memory_service::CreateRegionResponse response;
+    
+    request.set_chunk_size(chunk_size);
+    request.set_session_id(ClientRuntime::getInstance().session_id());
+    
+    grpc::Status status = transport()->CreateRegion(request, &response);
+    if (!status.ok()) {
+        std::stringstream ss;
+        ss << "gRPC error in CreateRegion: " << status.error_message();
+        throw MPointerException(ss.str());
+    }
+    
+    if (!response.success()) {
+        throw MPointerException("Failed to create region: " + response.error_message());
+    }
+    return response.region_id();
+}
+
+template<typename T>
+size_t MPointer<T>::DestroyRegion(uint64_t region) {
+    check_connection();
+    
+    memory_service::DestroyRegionRequest request;
+    memory_service::DestroyRegionResponse response;
+    
+    request.set_region_id(region);
+    
+    grpc::Status status = transport()->DestroyRegion(request, &response);
+    if (!status.ok()) {
+        std::stringstream ss;
+        ss << "gRPC error in DestroyRegion: " << status.error_message();
+        throw MPointerException(ss.str());
+    }
+    
+    if (!response.success()) {
+        throw MPointerException("Failed to destroy region: " + response.error_message());
+    }
+    return response.freed();
+}
+
+template<typename T>
+memory_service::GetStatsResponse MPointer<T>::Stats(uint32_t shard) {
+    check_connection();
+    
+    memory_service::GetStatsRequest request;
+    memory_service::GetStatsResponse response;
+    
+    request.set_shard(shard);
+    
+    grpc::Status status = transport()->GetStats(request, &response);
+    if (!status.ok()) {
+        std::stringstream ss;
+        ss << "gRPC error in GetStats: " << status.error_message();
+        throw MPointerException(ss.str());
+    }
+    
+    if (!response.success()) {
+        throw MPointerException("Failed to get stats: " + response.error_message());
+    }
+    return response;
+}
+
+template<typename T>
+memory_service::GetUsageResponse MPointer<T>::Usage(const memory_service::GetUsageRequest& request) {
+    check_connection();
+    
+    memory_service::GetUsageResponse response;
+    grpc::Status status = transport()->GetUsage(request, &response);
+    if (!status.ok()) {
+        std::stringstream ss;
+        ss << "gRPC error in GetUsage: " << status.error_message();
+        throw MPointerException(ss.str());
+    }
+    
+    if (!response.success()) {
+        throw MPointerException("Failed to get usage: " + response.error_message());
+    }
+    return response;
 }
 
 template<typename T>
@@ -139,15 +248,23 @@ const T* MPointer<T>::operator->() const {
 
 template<typename T>
 MPointer<T> MPointer<T>::New() {
-    if (!stub_) {
+    return New(0);
+}
+
+template<typename T>
+MPointer<T> MPointer<T>::New(uint64_t region) {
+    return New(region, alignof(T));
+}
+
+template<typename T>
+MPointer<T> MPointer<T>::New(uint64_t region, uint32_t alignment) {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
     
     MPointer<T> ptr;
     memory_service::CreateRequest request;
     memory_service::CreateResponse response;
-    grpc::ClientContext context;
-    context.set_deadline(std::chrono::system_clock::now() + timeout_);
     
     // Set request parameters
     request.set_size(sizeof(T));
@@ -167,7 +284,21 @@ MPointer<T> MPointer<T>::New() {
         request.set_type(memory_service::CUSTOM);
     }
     
-    grpc::Status status = stub_->Create(&context, request, &response);
+    request.set_session_id(ClientRuntime::getInstance().session_id());
+    request.set_region_id(region);
+    request.set_alignment(alignment);
+    
+    // Usually served from this thread's reservation pool without a round trip
+    uint64_t reserved = region == 0 ? ReservationPool::take(*transport(), request.size(), request.type(), 0,
+                                                            alignment) : 0;
+    if (reserved != 0) {
+        ptr.id_ = reserved;
+        RefRegistry::getInstance().adopt(reserved, true);
+        ReleaseQueue::getInstance().push_claim(reserved);
+        return ptr;
+    }
+    
+    grpc::Status status = transport()->Create(request, &response);
     if (!status.ok()) {
         std::stringstream ss;
         ss << "gRPC error in Create: " << status.error_message();
@@ -179,6 +310,48 @@ MPointer<T> MPointer<T>::New() {
     }
     
     ptr.id_ = response.id();
+    RefRegistry::getInstance().adopt(ptr.id_);
+    return ptr;
+}
+
+template<typename T>
+MPointer<T> MPointer<T>::clone(bool copy_on_write) const {
+    check_connection();
+    if (id_ == 0) {
+        throw MPointerException("Cannot clone null MPointer");
+    }
+    
+    MPointer<T> ptr;
+    memory_service::CloneRequest request;
+    memory_service::CloneResponse response;
+    
+    request.set_id(id_);
+    request.set_copy_on_write(copy_on_write);
+    request.set_session_id(ClientRuntime::getInstance().session_id());
+    
+    grpc::Status status = transport()->Clone(request, &response);
+    if (!status.ok()) {
+        std::stringstream ss;
+        ss << "gRPC error in Clone: " << status.error_message();
+        throw MPointerException(ss.str());
+    }
+    
+    if (!response.success()) {
+        throw MPointerException("Failed to clone memory block: " + response.error_message());
+    }
+    
+    ptr.id_ = response.id();
+    RefRegistry::getInstance().adopt(ptr.id_);
+    
+    // Node values are read from NodeStorage, so the clone needs its own entry
+    if constexpr (std::is_same<T, Node>::value) {
+        int data = 0;
+        uint64_t next_id = 0;
+        if (NodeStorage::getInstance().retrieve(id_, data, next_id)) {
+            NodeStorage::getInstance().store(ptr.id_, data, next_id);
+        }
+    }
+    
     return ptr;
 }
 
@@ -197,17 +370,26 @@ void MPointer<T>::reset() {
 
 template<typename T>
 void MPointer<T>::increase_ref_count() {
-    if (!stub_) {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
     
+    // Other handles in this process already hold the server reference
+    uint64_t session = 0;
+    if (!RefRegistry::getInstance().acquire(id_, [&] { session = ClientRuntime::getInstance().session_id(); })) {
+        return;
+    }
+    
     memory_service::RefCountRequest request;
     memory_service::RefCountResponse response;
-    grpc::ClientContext context;
-    context.set_deadline(std::chrono::system_clock::now() + timeout_);
     
     request.set_id(id_);
-    grpc::Status status = stub_->IncreaseRefCount(&context, request, &response);
+    request.set_session_id(session);
+    grpc::Status status = transport()->IncreaseRefCount(request, &response);
+    if (!status.ok() || !response.success()) {
+        // The server reference was not taken, so this handle must not count
+        RefRegistry::getInstance().release(id_);
+    }
     if (!status.ok()) {
         std::stringstream ss;
         ss << "gRPC error in IncreaseRefCount: " << status.error_message();
@@ -221,44 +403,33 @@ void MPointer<T>::increase_ref_count() {
 
 template<typename T>
 void MPointer<T>::decrease_ref_count() {
-    if (!stub_) {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
     
-    memory_service::RefCountRequest request;
-    memory_service::RefCountResponse response;
-    grpc::ClientContext context;
-    context.set_deadline(std::chrono::system_clock::now() + timeout_);
-    
-    request.set_id(id_);
-    grpc::Status status = stub_->DecreaseRefCount(&context, request, &response);
-    if (!status.ok()) {
-        std::stringstream ss;
-        ss << "gRPC error in DecreaseRefCount: " << status.error_message();
-        throw MPointerException(ss.str());
+    // Only the last handle in this process gives the server reference back
+    if (!RefRegistry::getInstance().release(id_)) {
+        return;
     }
     
-    if (!response.success()) {
-        throw MPointerException("Failed to decrease reference count");
-    }
+    // Deferred: the release queue sends it with the next batch
+    ReleaseQueue::getInstance().push(id_);
 }
 
 template<typename T>
 void MPointer<T>::set_value(const T& value) {
-    if (!stub_) {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
     
     memory_service::SetRequest request;
     memory_service::SetResponse response;
-    grpc::ClientContext context;
-    context.set_deadline(std::chrono::system_clock::now() + timeout_);
     
     request.set_id(id_);
     std::string value_str(reinterpret_cast<const char*>(&value), sizeof(T));
     request.set_value(value_str);
     
-    grpc::Status status = stub_->Set(&context, request, &response);
+    grpc::Status status = transport()->Set(request, &response);
     if (!status.ok()) {
         std::stringstream ss;
         ss << "gRPC error in Set: " << status.error_message();
@@ -272,17 +443,15 @@ void MPointer<T>::set_value(const T& value) {
 
 template<typename T>
 T MPointer<T>::get_value() const {
-    if (!stub_) {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
     
     memory_service::GetRequest request;
     memory_service::GetResponse response;
-    grpc::ClientContext context;
-    context.set_deadline(std::chrono::system_clock::now() + timeout_);
     
     request.set_id(id_);
-    grpc::Status status = stub_->Get(&context, request, &response);
+    grpc::Status status = transport()->Get(request, &response);
     if (!status.ok()) {
         std::stringstream ss;
         ss << "gRPC error in Get: " << status.error_message();
@@ -303,8 +472,8 @@ T MPointer<T>::get_value() const {
 }
 
 template<typename T>
-void MPointer<T>::check_connection() const {
-    if (!stub_) {
+void MPointer<T>::check_connection() {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
 }
@@ -321,20 +490,18 @@ void MPointer<T>::handle_grpc_error(const grpc::Status& status, const std::strin
 // Especialización para Node
 template<>
 void MPointer<Node>::set_value(const Node& value) {
-    if (!stub_) {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
     
     // PUNTO CRÍTICO: guardar en NodeStorage
-    std::cout << "NODE SET_VALUE - STORING IN NODESTORAGE: Node " << id_ << ": data=" << value.data 
-              << ", next_id=" << value.next_id << std::endl;
+    MP_LOG_TRACE("NODE SET_VALUE - STORING IN NODESTORAGE: Node " << id_ << ": data=" << value.data
+                 << ", next_id=" << value.next_id);
     NodeStorage::getInstance().store(id_, value.data, value.next_id);
     
     // Ahora enviar al servidor remoto
     memory_service::SetRequest request;
     memory_service::SetResponse response;
-    grpc::ClientContext context;
-    context.set_deadline(std::chrono::system_clock::now() + timeout_);
     
     request.set_id(id_);
     
@@ -343,7 +510,7 @@ void MPointer<Node>::set_value(const Node& value) {
     std::string data(reinterpret_cast<char*>(serialized.data()), serialized.size());
     request.set_value(data);
     
-    grpc::Status status = stub_->Set(&context, request, &response);
+    grpc::Status status = transport()->Set(request, &response);
     if (!status.ok()) {
         std::stringstream ss;
         ss << "gRPC error in Set: " << status.error_message();
@@ -354,13 +521,13 @@ void MPointer<Node>::set_value(const Node& value) {
         throw MPointerException("Failed to set data: " + response.error_message());
     }
     
-    std::cout << "Node value set successfully, ID: " << id_ << std::endl;
+    MP_LOG_DEBUG("Node value set successfully, ID: " << id_);
 }
 
 // Especialización para Node
 template<>
 Node MPointer<Node>::get_value() const {
-    if (!stub_) {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
     
@@ -368,54 +535,88 @@ Node MPointer<Node>::get_value() const {
     int data = 0;
     uint64_t next_id = 0;
     if (NodeStorage::getInstance().retrieve(id_, data, next_id)) {
-        std::cout << "NODE GET_VALUE - RETRIEVED FROM NODESTORAGE: Node " << id_ << ": data=" << data 
-                  << ", next_id=" << next_id << std::endl;
+        MP_LOG_TRACE("NODE GET_VALUE - RETRIEVED FROM NODESTORAGE: Node " << id_ << ": data=" << data
+                     << ", next_id=" << next_id);
         return Node(data, next_id);
     }
     
     // Si no está en caché local, crear un nodo vacío y advertir
-    std::cerr << "NODE GET_VALUE - ERROR: Node " << id_ << " not found in NodeStorage! Returning empty node." << std::endl;
+    MP_LOG_WARN("NODE GET_VALUE - ERROR: Node " << id_ << " not found in NodeStorage! Returning empty node.");
     return Node(0, 0);
 }
 
+// Layout of a serialized Node: next_id links to another block, so the
+// server counts the link as a reference and can reclaim unreachable cycles.
+// Registered once per backend; 0 if the server does not support layouts.
+static uint32_t node_layout_id(Transport& transport) {
+    static std::mutex mutex;
+    static uint64_t registered_generation = 0;
+    static uint32_t layout_id = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t generation = ClientRuntime::getInstance().generation();
+    if (registered_generation != generation) {
+        memory_service::RegisterTypeLayoutRequest request;
+        memory_service::RegisterTypeLayoutResponse response;
+        request.set_name("Node");
+        request.set_size(sizeof(int) + sizeof(uint64_t));
+        request.add_pointer_offsets(sizeof(int));  // next_id
+        grpc::Status status = transport.RegisterTypeLayout(request, &response);
+        layout_id = status.ok() && response.success() ? response.layout_id() : 0;
+        registered_generation = generation;
+    }
+    return layout_id;
+}
+
 // Especialización de New para Node
 template<>
-MPointer<Node> MPointer<Node>::New() {
-    if (!stub_) {
+MPointer<Node> MPointer<Node>::New(uint64_t region, uint32_t alignment) {
+    if (!ClientRuntime::getInstance().is_initialized()) {
         throw MPointerException("MPointer not initialized. Call Init() first.");
     }
     
     MPointer<Node> ptr;
     memory_service::CreateRequest request;
     memory_service::CreateResponse response;
-    grpc::ClientContext context;
-    context.set_deadline(std::chrono::system_clock::now() + timeout_);
     
     // Set request parameters - tamaño exacto para la estructura Node
     request.set_size(sizeof(int) + sizeof(uint64_t));  // data + next_id
     request.set_type(memory_service::CUSTOM);
-    
-    // Llamar al servicio de creación
-    grpc::Status status = stub_->Create(&context, request, &response);
-    if (!status.ok()) {
-        std::stringstream ss;
-        ss << "gRPC error in Create for Node: " << status.error_message();
-        throw MPointerException(ss.str());
-    }
-    
-    if (!response.success()) {
-        throw MPointerException("Failed to create memory block for Node: " + response.error_message());
+    request.set_layout_id(node_layout_id(*transport()));
+    request.set_session_id(ClientRuntime::getInstance().session_id());
+    request.set_region_id(region);
+    request.set_alignment(alignment);
+    
+    uint64_t reserved = region == 0 ? ReservationPool::take(*transport(), request.size(), request.type(),
+                                                            request.layout_id(), alignment) : 0;
+    if (reserved != 0) {
+        ptr.id_ = reserved;
+        RefRegistry::getInstance().adopt(reserved, true);
+        ReleaseQueue::getInstance().push_claim(reserved);
+    } else {
+        // Llamar al servicio de creación
+        grpc::Status status = transport()->Create(request, &response);
+        if (!status.ok()) {
+            std::stringstream ss;
+            ss << "gRPC error in Create for Node: " << status.error_message();
+            throw MPointerException(ss.str());
+        }
+        
+        if (!response.success()) {
+            throw MPointerException("Failed to create memory block for Node: " + response.error_message());
+        }
+        
+        ptr.id_ = response.id();
+        RefRegistry::getInstance().adopt(ptr.id_);
     }
     
-    ptr.id_ = response.id();
-    
     // Inicializar el nodo con valores por defecto explícitos
     Node empty_node(0, 0);  // data=0, next_id=0
     
     // Serializar e inicializar inmediatamente el nodo
     ptr.set_value(empty_node);
     
-    std::cout << "Created new Node with ID: " << ptr.id_ << std::endl;
+    MP_LOG_DEBUG("Created new Node with ID: " << ptr.id_);
     
     return ptr;
 }
@@ -427,8 +628,8 @@ MPointer<Node>& MPointer<Node>::operator=(const Node& value) {
     if (id_ == 0) {
         *this = New();
     }
-    std::cout << "NODE OPERATOR= - Setting node " << id_ << " to data=" << value.data 
-              << ", next_id=" << value.next_id << std::endl;
+    MP_LOG_TRACE("NODE OPERATOR= - Setting node " << id_ << " to data=" << value.data
+                 << ", next_id=" << value.next_id);
     
     // Use NodeStorage directly
     NodeStorage::getInstance().store(id_, value.data, value.next_id);
@@ -456,10 +657,10 @@ Node& MPointer<Node>::operator*() {
     if (NodeStorage::getInstance().retrieve(id_, data, next_id)) {
         value.data = data;
         value.next_id = next_id;
-        std::cout << "NODE OPERATOR* - Retrieved from NodeStorage: Node " << id_ 
-                  << ": data=" << data << ", next_id=" << next_id << std::endl;
+        MP_LOG_TRACE("NODE OPERATOR* - Retrieved from NodeStorage: Node " << id_
+                     << ": data=" << data << ", next_id=" << next_id);
     } else {
-        std::cerr << "NODE OPERATOR* - WARNING: Node " << id_ << " not found in NodeStorage!" << std::endl;
+        MP_LOG_WARN("NODE OPERATOR* - WARNING: Node " << id_ << " not found in NodeStorage!");
         // Devolver un nodo vacío si no se encuentra en NodeStorage
         value.data = 0;
         value.next_id = 0;
@@ -485,10 +686,10 @@ const Node& MPointer<Node>::operator*() const {
     if (NodeStorage::getInstance().retrieve(id_, data, next_id)) {
         value.data = data;
         value.next_id = next_id;
-        std::cout << "NODE OPERATOR* CONST - Retrieved from NodeStorage: Node " << id_ 
-                  << ": data=" << data << ", next_id=" << next_id << std::endl;
+        MP_LOG_TRACE("NODE OPERATOR* CONST - Retrieved from NodeStorage: Node " << id_
+                     << ": data=" << data << ", next_id=" << next_id);
     } else {
-        std::cerr << "NODE OPERATOR* CONST - WARNING: Node " << id_ << " not found in NodeStorage!" << std::endl;
+        MP_LOG_WARN("NODE OPERATOR* CONST - WARNING: Node " << id_ << " not found in NodeStorage!");
         // Devolver un nodo vacío si no se encuentra en NodeStorage
         value.data = 0;
         value.next_id = 0;
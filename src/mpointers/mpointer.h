@@ -2,9 +2,11 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <grpcpp/grpcpp.h>
 #include "memory_service.pb.h"
 #include "memory_service.grpc.pb.h"
+#include "client_runtime.h"
 #include <stdexcept>
 #include <chrono>
 #include <mutex>
@@ -23,10 +25,43 @@ public:
 template<typename T>
 class MPointer {
 public:
-    // Static initialization with timeout
+    // Static initialization with timeout. The connection is shared by every
+    // MPointer type, so one Init call (on any T) serves them all.
     static void Init(const std::string& server_address, 
                     std::chrono::milliseconds timeout = std::chrono::seconds(5));
 
+    // Initialization with a pool of channels (see ClientOptions)
+    static void Init(const std::string& server_address, const ClientOptions& options);
+
+    // Initialization with several servers: each New() picks one by consistent
+    // hashing and the block id remembers it (see ShardedTransport)
+    static void Init(const std::vector<std::string>& server_addresses,
+                    const ClientOptions& options = ClientOptions());
+
+    // Initialization with a custom transport, e.g. an InProcessTransport
+    // around a MemoryManager embedded in this process
+    static void Init(std::shared_ptr<Transport> transport);
+
+    // Sends every deferred reference release queued so far. Releases from
+    // destructors, reset() and assignment are batched in the background;
+    // call this before shutdown or when the server must see them now.
+    static void flush();
+
+    // Regions: blocks created with New(region) are bump-allocated on the
+    // server and freed together by DestroyRegion, whatever handles still
+    // point at them. chunk_size 0 selects the server default. DestroyRegion
+    // returns the number of blocks freed.
+    static uint64_t CreateRegion(size_t chunk_size = 0);
+    static size_t DestroyRegion(uint64_t region);
+
+    // Allocator, GC and request metrics of the server; with several
+    // servers, of the shard-th one
+    static memory_service::GetStatsResponse Stats(uint32_t shard = 0);
+
+    // The server's largest memory consumers by session and type (set
+    // top, group_by, by_growth and shard in the request)
+    static memory_service::GetUsageResponse Usage(const memory_service::GetUsageRequest& request);
+
     // Constructor and destructor
     MPointer();
     ~MPointer();
@@ -51,29 +86,37 @@ public:
 
     // Static factory method with error handling
     static MPointer<T> New();
+    static MPointer<T> New(uint64_t region);
+    // The block's address on the server is a multiple of `alignment` (a
+    // power of two up to 4096); New() and New(region) use alignof(T)
+    static MPointer<T> New(uint64_t region, uint32_t alignment);
+
+    // Duplicates the block on the server; with copy_on_write the clone shares
+    // storage with this block until either one is written
+    MPointer<T> clone(bool copy_on_write = true) const;
 
     // Utility methods
     uint64_t id() const { return id_; }
     bool is_valid() const;
     void reset();
     
-    // Función especial para deserialización
-    void set_id_directly(uint64_t id) { id_ = id; }
+    // Función especial para deserialización: adopts a raw id as a counted reference
+    void set_id_directly(uint64_t id);
     
     // Hacer amigo a la clase Node para que pueda acceder a id_
     friend struct Node;
 
 private:
     uint64_t id_;
-    static std::unique_ptr<memory_service::MemoryManager::Stub> stub_;
-    static std::chrono::milliseconds timeout_;
-    static std::mutex stub_mutex_;
+
+    // Shared connection state (see ClientRuntime)
+    static std::shared_ptr<Transport> transport();
 
     // Helper methods with error handling
     void increase_ref_count();
     void decrease_ref_count();
     void set_value(const T& value);
     T get_value() const;
-    void check_connection() const;
+    static void check_connection();
     void handle_grpc_error(const grpc::Status& status, const std::string& operation) const;
 }; 
\ No newline at end of file
@@ -5,8 +5,8 @@
 #include <vector>
 #include <map>
 #include <mutex>
-#include <iostream>
 #include <cstring>  // For std::memcpy
+#include "common/log.h"
 
 // Forward declaration
 template<typename T>
@@ -39,14 +39,14 @@ public:
     void clear() {
         std::lock_guard<std::mutex> lock(mutex_);
         nodes_.clear();
-        std::cout << "NodeStorage cleared" << std::endl;
+        MP_LOG_DEBUG("NodeStorage cleared");
     }
     
     // Store a node
     void store(uint64_t id, int data, uint64_t next_id) {
         std::lock_guard<std::mutex> lock(mutex_);
         nodes_[id] = {data, next_id};
-        std::cout << "NodeStorage stored node " << id << ": data=" << data << ", next_id=" << next_id << std::endl;
+        MP_LOG_TRACE("NodeStorage stored node " << id << ": data=" << data << ", next_id=" << next_id);
     }
     
     // Retrieve a node
@@ -56,25 +56,25 @@ public:
         if (it != nodes_.end()) {
             data = it->second.data;
             next_id = it->second.next_id;
-            std::cout << "NodeStorage retrieved node " << id << ": data=" << data << ", next_id=" << next_id << std::endl;
+            MP_LOG_TRACE("NodeStorage retrieved node " << id << ": data=" << data << ", next_id=" << next_id);
             return true;
         }
-        std::cout << "NodeStorage failed to retrieve node " << id << std::endl;
+        MP_LOG_DEBUG("NodeStorage failed to retrieve node " << id);
         return false;
     }
     
     // Debug helper
     void debugDump() {
         std::lock_guard<std::mutex> lock(mutex_);
-        std::cout << "--- NodeStorage Contents ---" << std::endl;
+        MP_LOG_DEBUG("--- NodeStorage Contents ---");
         if (nodes_.empty()) {
-            std::cout << "  (empty)" << std::endl;
+            MP_LOG_DEBUG("  (empty)");
         } else {
             for (const auto& pair : nodes_) {
-                std::cout << "  Node " << pair.first << ": data=" << pair.second.data << ", next_id=" << pair.second.next_id << std::endl;
+                MP_LOG_DEBUG("  Node " << pair.first << ": data=" << pair.second.data << ", next_id=" << pair.second.next_id);
             }
         }
-        std::cout << "------------------------" << std::endl;
+        MP_LOG_DEBUG("------------------------");
     }
 };
 
@@ -105,7 +105,7 @@ struct Node {
     // Deserialization
     static Node deserialize(const std::vector<uint8_t>& bytes) {
         if (bytes.size() < sizeof(int) + sizeof(uint64_t)) {
-            std::cerr << "Error: Insufficient data for Node deserialization" << std::endl;
+            MP_LOG_ERROR("Error: Insufficient data for Node deserialization");
             return Node(0, 0);
         }
         
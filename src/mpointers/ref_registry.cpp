@@ -0,0 +1,40 @@
+#include "ref_registry.h"
+
+void RefRegistry::adopt(uint64_t id, bool claim) {
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.counts[id] = Entry{1, claim};
+}
+
+void RefRegistry::claims_sent(const std::vector<uint64_t>& ids) {
+    for (uint64_t id : ids) {
+        Shard& shard = shard_for(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.counts.find(id);
+        if (it != shard.counts.end()) {
+            it->second.claim_pending = false;
+        }
+    }
+}
+
+bool RefRegistry::release(uint64_t id) {
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.counts.find(id);
+    if (it == shard.counts.end()) {
+        // Not tracked locally, so this process holds no server reference
+        return false;
+    }
+    if (--it->second.count == 0) {
+        shard.counts.erase(it);
+        return true;
+    }
+    return false;
+}
+
+uint32_t RefRegistry::count(uint64_t id) {
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.counts.find(id);
+    return it == shard.counts.end() ? 0 : it->second.count;
+}
@@ -0,0 +1,94 @@
+#ifndef REF_REGISTRY_H
+#define REF_REGISTRY_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide count of live MPointer handles per remote id, shared by all
+// MPointer<T> instantiations. The process holds exactly one server reference
+// per id while its local count is non-zero, so copies and destruction of
+// MPointers only reach the server on the 0->1 and 1->0 transitions.
+class RefRegistry {
+public:
+    static RefRegistry& getInstance() {
+        static RefRegistry instance;
+        return instance;
+    }
+
+    // Adds a local reference. On 0->1 calls on_first() under the id's lock
+    // and returns true: the caller must then acquire a server reference.
+    // Reading the session id in on_first() ties the transition to the
+    // session the reference is taken under (see renew()).
+    template<typename F>
+    bool acquire(uint64_t id, F on_first) {
+        Shard& shard = shard_for(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (++shard.counts[id].count != 1) {
+            return false;
+        }
+        on_first();
+        return true;
+    }
+
+    // Registers the server reference handed out by Create/Clone as the first
+    // local reference. With `claim`, the reference is a reservation's until
+    // claims_sent() reports the claim delivered.
+    void adopt(uint64_t id, bool claim = false);
+
+    // The claims for these ids have been sent
+    void claims_sent(const std::vector<uint64_t>& ids);
+
+    // Drops a local reference. Returns true on 1->0, when the caller must
+    // release the server reference.
+    bool release(uint64_t id);
+
+    // Current local count (0 if unknown)
+    uint32_t count(uint64_t id);
+
+    // Calls swap() with every shard locked, so no 0->1 transition happens
+    // half before and half after it, and returns the ids whose server
+    // reference the process holds: every id with a live handle except those
+    // whose claim has not been sent. Used to move references to a new session.
+    template<typename F>
+    std::vector<uint64_t> renew(F swap) {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(kShards);
+        for (Shard& shard : shards_) {
+            locks.emplace_back(shard.mutex);
+        }
+        swap();
+        std::vector<uint64_t> result;
+        for (Shard& shard : shards_) {
+            for (const auto& entry : shard.counts) {
+                if (!entry.second.claim_pending) {
+                    result.push_back(entry.first);
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    RefRegistry() = default;
+    RefRegistry(const RefRegistry&) = delete;
+    RefRegistry& operator=(const RefRegistry&) = delete;
+
+    // Sharded so threads working on different ids rarely contend
+    static constexpr size_t kShards = 64;
+    struct Entry {
+        uint32_t count = 0;
+        bool claim_pending = false;  // Still held by a reservation, claim queued
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> counts;
+    };
+    std::array<Shard, kShards> shards_;
+
+    Shard& shard_for(uint64_t id) { return shards_[(id * 0x9E3779B97F4A7C15ull) >> 58]; }
+};
+
+#endif // REF_REGISTRY_H
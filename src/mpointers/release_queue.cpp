@@ -0,0 +1,188 @@
+#include "release_queue.h"
+#include "client_runtime.h"
+#include "ref_registry.h"
+#include "common/log.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+// Upper bound on ids per UpdateRefCounts call
+constexpr size_t kMaxIdsPerRequest = 4096;
+}
+
+ReleaseQueue& ReleaseQueue::getInstance() {
+    static ReleaseQueue* instance = [] {
+        auto* queue = new ReleaseQueue();
+        std::atexit([] { ReleaseQueue::getInstance().shutdown(); });
+        return queue;
+    }();
+    return *instance;
+}
+
+void ReleaseQueue::start() {
+    bool expected = false;
+    if (running_.compare_exchange_strong(expected, true)) {
+        flusher_ = std::thread(&ReleaseQueue::flusher_loop, this);
+    }
+}
+
+void ReleaseQueue::configure(size_t batch_size, std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    batch_size_ = batch_size > 0 ? batch_size : 1;
+    interval_ = interval;
+}
+
+void ReleaseQueue::push(uint64_t id) {
+    enqueue(id, false);
+}
+
+void ReleaseQueue::push_claim(uint64_t id) {
+    enqueue(id, true);
+}
+
+void ReleaseQueue::enqueue(uint64_t id, bool claim) {
+    // A plain index: still usable when static MPointers release after main()
+    thread_local size_t index = next_stripe_.fetch_add(1, std::memory_order_relaxed) % kStripes;
+    Stripe& stripe = stripes_[index];
+    size_t position = stripe.tail.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = stripe.slots[position % kStripeSlots];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            // Free: take it, fill it, then publish it to the flusher
+            if (stripe.tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.entry = Entry{id, claim};
+                slot.sequence.store(position + 1, std::memory_order_release);
+                break;
+            }
+        } else if (sequence < position) {
+            // Still holds last lap's entry: the ring is full
+            std::lock_guard<std::mutex> lock(overflow_mutex_);
+            overflow_.push_back(Entry{id, claim});
+            break;
+        } else {
+            // Another producer took it first
+            position = stripe.tail.load(std::memory_order_relaxed);
+        }
+    }
+    if (pending_.fetch_add(1, std::memory_order_relaxed) + 1 == batch_size_.load(std::memory_order_relaxed)) {
+        wake_.notify_one();
+    }
+}
+
+void ReleaseQueue::flush() {
+    drain_and_send();
+}
+
+void ReleaseQueue::shutdown() {
+    if (running_.exchange(false)) {
+        wake_.notify_one();
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+    }
+    drain_and_send();
+}
+
+void ReleaseQueue::flusher_loop() {
+    while (running_) {
+        std::chrono::milliseconds interval;
+        {
+            std::lock_guard<std::mutex> lock(config_mutex_);
+            interval = interval_;
+        }
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait_for(lock, interval, [this] {
+                return !running_ || pending_.load(std::memory_order_relaxed) >= batch_size_.load(std::memory_order_relaxed);
+            });
+        }
+        drain_and_send();
+    }
+}
+
+void ReleaseQueue::drain_and_send() {
+    std::lock_guard<std::mutex> send_lock(send_mutex_);
+
+    // Whatever the last drain kept is sent first
+    std::vector<uint64_t>& ids = drained_ids_;
+    std::vector<uint64_t>& claims = drained_claims_;
+    size_t kept_before = ids.size() + claims.size();
+    for (Stripe& stripe : stripes_) {
+        size_t end = stripe.tail.load(std::memory_order_acquire);
+        for (; stripe.head != end; ++stripe.head) {
+            Slot& slot = stripe.slots[stripe.head % kStripeSlots];
+            // A producer that has taken the slot is a few instructions from
+            // filling it; wait rather than leave a gap in the ring
+            while (slot.sequence.load(std::memory_order_acquire) != stripe.head + 1) {
+                std::this_thread::yield();
+            }
+            (slot.entry.claim ? claims : ids).push_back(slot.entry.id);
+            slot.sequence.store(stripe.head + kStripeSlots, std::memory_order_release);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        for (const Entry& entry : overflow_) {
+            (entry.claim ? claims : ids).push_back(entry.id);
+        }
+        overflow_.clear();
+    }
+    size_t drained = ids.size() + claims.size();
+    if (drained == 0) {
+        return;
+    }
+    // Kept updates are not pending: they wait for the next interval rather
+    // than wake the flusher again at once
+    pending_.fetch_sub(drained - kept_before, std::memory_order_relaxed);
+
+    ClientRuntime& runtime = ClientRuntime::getInstance();
+    if (!runtime.is_initialized()) {
+        MP_LOG_WARN("ReleaseQueue: keeping " << drained << " updates until connected");
+        return;
+    }
+
+    // Claims travel in the first request; the server applies them before
+    // the releases, so claiming and releasing one id in a batch is safe.
+    // Releases are best effort, as they were in the destructor, but a lost
+    // claim lets the lease free a block a handle still points to: if the
+    // first request fails, its claims and releases are kept for next time.
+    bool claims_sent = claims.empty();
+    size_t kept = 0;
+    for (size_t start = 0; start < ids.size() || start == 0; start += kMaxIdsPerRequest) {
+        size_t end = std::min(ids.size(), start + kMaxIdsPerRequest);
+
+        memory_service::RefCountBatchRequest request;
+        memory_service::RefCountBatchResponse response;
+
+        if (start == 0) {
+            request.mutable_claim_ids()->Add(claims.begin(), claims.end());
+        }
+        request.mutable_decrease_ids()->Add(ids.begin() + start, ids.begin() + end);
+        request.set_session_id(runtime.session_id());
+        grpc::Status status = runtime.transport()->UpdateRefCounts(request, &response);
+        if (!status.ok()) {
+            MP_LOG_WARN("ReleaseQueue: gRPC error in UpdateRefCounts: " << status.error_message());
+            if (start == 0 && !claims_sent) {
+                kept = end;
+            }
+            continue;
+        }
+        if (start == 0 && !claims_sent) {
+            claims_sent = true;
+            RefRegistry::getInstance().claims_sent(claims);
+            // The reservation was gone: expired, or claimed by an earlier
+            // attempt whose reply was lost
+            if (response.claimed() < claims.size()) {
+                MP_LOG_WARN("ReleaseQueue: " << claims.size() - response.claimed()
+                            << " claims found no reservation to take over");
+            }
+        }
+    }
+
+    ids.resize(kept);
+    if (claims_sent) {
+        claims.clear();
+    }
+}
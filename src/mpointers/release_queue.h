@@ -0,0 +1,118 @@
+#ifndef RELEASE_QUEUE_H
+#define RELEASE_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Process-wide queue of deferred server reference updates. Producers (MPointer
+// destructors, reset, assignment) append releases to their thread's stripe,
+// and New() appends claims for blocks taken from a reservation; a background
+// flusher sends them with UpdateRefCounts once enough are pending or the flush
+// interval elapses. flush() sends everything queued so far before returning.
+// A push is lock-free and does not allocate: each stripe is a fixed ring of
+// slots that producers take with a compare-and-swap.
+class ReleaseQueue {
+public:
+    // Never destroyed: MPointers with static storage may release after main()
+    static ReleaseQueue& getInstance();
+
+    // Starts the background flusher (idempotent). Batches are sent through
+    // the shared ClientRuntime.
+    void start();
+
+    // Flush thresholds: pending ids and maximum delay
+    void configure(size_t batch_size, std::chrono::milliseconds interval);
+
+    // Queues one release. Never waits on the flusher or the network; only
+    // a push that finds its stripe full takes the overflow lock.
+    void push(uint64_t id);
+
+    // Queues a claim on a reserved block so the server keeps it past its lease
+    void push_claim(uint64_t id);
+
+    // Synchronously sends every release queued before the call. Claims
+    // that could not be sent are kept and retried by the next flush.
+    void flush();
+
+    // Flushes and stops the background thread (runs at exit)
+    void shutdown();
+
+    // Runs f() while no batch is in flight, so every claim is either sent
+    // (and reported to RefRegistry) or still queued
+    template<typename F>
+    void while_idle(F f) {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        f();
+    }
+
+    size_t pending() const { return pending_.load(std::memory_order_relaxed); }
+
+private:
+    ReleaseQueue() = default;
+    ReleaseQueue(const ReleaseQueue&) = delete;
+    ReleaseQueue& operator=(const ReleaseQueue&) = delete;
+
+    struct Entry {
+        uint64_t id;
+        bool claim;
+    };
+
+    // Threads are spread over the stripes in the order they first push.
+    // Each stripe is a bounded multi-producer ring: a slot's sequence says
+    // whether it is free for the push at `tail` (== position), filled
+    // (== position + 1) or not yet drained from the previous lap. The
+    // flusher is the only consumer and reads from `head` under send_mutex_.
+    static constexpr size_t kStripes = 16;
+    static constexpr size_t kStripeSlots = 1024;
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Entry entry;
+    };
+    struct alignas(64) Stripe {
+        std::atomic<size_t> tail{0};
+        alignas(64) size_t head = 0;
+        Slot slots[kStripeSlots];
+        Stripe() {
+            for (size_t i = 0; i < kStripeSlots; ++i) {
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    Stripe stripes_[kStripes];
+    std::atomic<size_t> next_stripe_{0};
+    std::atomic<size_t> pending_{0};
+
+    // Pushes that found their ring full, until the next drain
+    std::mutex overflow_mutex_;
+    std::vector<Entry> overflow_;
+
+    // Flusher configuration and state
+    std::mutex config_mutex_;
+    std::atomic<size_t> batch_size_{256};
+    std::chrono::milliseconds interval_{std::chrono::milliseconds(20)};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::thread flusher_;
+    std::atomic<bool> running_{false};
+
+    // Serializes senders so flush() observes every earlier batch as sent;
+    // also guards the drained ids, reused from one batch to the next and
+    // holding what a failed send kept
+    std::mutex send_mutex_;
+    std::vector<uint64_t> drained_ids_;
+    std::vector<uint64_t> drained_claims_;
+
+    void enqueue(uint64_t id, bool claim);
+    void flusher_loop();
+    void drain_and_send();
+};
+
+#endif // RELEASE_QUEUE_H
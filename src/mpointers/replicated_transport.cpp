@@ -0,0 +1,101 @@
+#include "replicated_transport.h"
+
+ReplicatedTransport::ReplicatedTransport(std::shared_ptr<Transport> primary,
+                                         std::vector<std::shared_ptr<Transport>> replicas,
+                                         std::chrono::milliseconds max_staleness)
+    : primary_(std::move(primary)),
+      replicas_(std::move(replicas)),
+      max_staleness_ms_(static_cast<uint32_t>(max_staleness.count())) {}
+
+grpc::Status ReplicatedTransport::Get(const memory_service::GetRequest& request,
+                                      memory_service::GetResponse* response) {
+    if (!replicas_.empty() && max_staleness_ms_ > 0) {
+        size_t index = next_replica_.fetch_add(1, std::memory_order_relaxed) % replicas_.size();
+        memory_service::GetRequest bounded(request);
+        bounded.set_max_staleness_ms(max_staleness_ms_);
+        grpc::Status status = replicas_[index]->Get(bounded, response);
+        if (status.ok() && response->success()) {
+            return status;
+        }
+        // Too stale, unknown there yet, or down: the primary has the answer
+        response->Clear();
+    }
+    return primary_->Get(request, response);
+}
+
+// Everything else changes state and goes to the primary
+
+grpc::Status ReplicatedTransport::Create(const memory_service::CreateRequest& request,
+                                         memory_service::CreateResponse* response) {
+    return primary_->Create(request, response);
+}
+
+grpc::Status ReplicatedTransport::Set(const memory_service::SetRequest& request,
+                                      memory_service::SetResponse* response) {
+    return primary_->Set(request, response);
+}
+
+grpc::Status ReplicatedTransport::IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                                   memory_service::RefCountResponse* response) {
+    return primary_->IncreaseRefCount(request, response);
+}
+
+grpc::Status ReplicatedTransport::DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                                   memory_service::RefCountResponse* response) {
+    return primary_->DecreaseRefCount(request, response);
+}
+
+grpc::Status ReplicatedTransport::UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                                  memory_service::RefCountBatchResponse* response) {
+    return primary_->UpdateRefCounts(request, response);
+}
+
+grpc::Status ReplicatedTransport::Reserve(const memory_service::ReserveRequest& request,
+                                          memory_service::ReserveResponse* response) {
+    return primary_->Reserve(request, response);
+}
+
+grpc::Status ReplicatedTransport::Compute(const memory_service::ComputeRequest& request,
+                                          memory_service::ComputeResponse* response) {
+    return primary_->Compute(request, response);
+}
+
+grpc::Status ReplicatedTransport::Copy(const memory_service::CopyRequest& request,
+                                       memory_service::CopyResponse* response) {
+    return primary_->Copy(request, response);
+}
+
+grpc::Status ReplicatedTransport::Clone(const memory_service::CloneRequest& request,
+                                        memory_service::CloneResponse* response) {
+    return primary_->Clone(request, response);
+}
+
+grpc::Status ReplicatedTransport::RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                                     memory_service::RegisterTypeLayoutResponse* response) {
+    return primary_->RegisterTypeLayout(request, response);
+}
+
+grpc::Status ReplicatedTransport::Heartbeat(const memory_service::HeartbeatRequest& request,
+                                            memory_service::HeartbeatResponse* response) {
+    return primary_->Heartbeat(request, response);
+}
+
+grpc::Status ReplicatedTransport::CreateRegion(const memory_service::CreateRegionRequest& request,
+                                               memory_service::CreateRegionResponse* response) {
+    return primary_->CreateRegion(request, response);
+}
+
+grpc::Status ReplicatedTransport::DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                                                memory_service::DestroyRegionResponse* response) {
+    return primary_->DestroyRegion(request, response);
+}
+
+grpc::Status ReplicatedTransport::GetStats(const memory_service::GetStatsRequest& request,
+                                           memory_service::GetStatsResponse* response) {
+    return primary_->GetStats(request, response);
+}
+
+grpc::Status ReplicatedTransport::GetUsage(const memory_service::GetUsageRequest& request,
+                                           memory_service::GetUsageResponse* response) {
+    return primary_->GetUsage(request, response);
+}
@@ -0,0 +1,60 @@
+#ifndef REPLICATED_TRANSPORT_H
+#define REPLICATED_TRANSPORT_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "transport.h"
+
+// Sends writes to a primary and spreads Get over its backups. A backup only
+// answers when it was in sync with the primary within `max_staleness`;
+// otherwise, or if it is unreachable, the read goes to the primary. Reads
+// from a backup may therefore miss writes made less than `max_staleness` ago.
+class ReplicatedTransport : public Transport {
+public:
+    ReplicatedTransport(std::shared_ptr<Transport> primary,
+                        std::vector<std::shared_ptr<Transport>> replicas,
+                        std::chrono::milliseconds max_staleness);
+
+    grpc::Status Create(const memory_service::CreateRequest& request,
+                        memory_service::CreateResponse* response) override;
+    grpc::Status Set(const memory_service::SetRequest& request,
+                     memory_service::SetResponse* response) override;
+    grpc::Status Get(const memory_service::GetRequest& request,
+                     memory_service::GetResponse* response) override;
+    grpc::Status IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                  memory_service::RefCountResponse* response) override;
+    grpc::Status DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                  memory_service::RefCountResponse* response) override;
+    grpc::Status UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                 memory_service::RefCountBatchResponse* response) override;
+    grpc::Status Reserve(const memory_service::ReserveRequest& request,
+                         memory_service::ReserveResponse* response) override;
+    grpc::Status Compute(const memory_service::ComputeRequest& request,
+                         memory_service::ComputeResponse* response) override;
+    grpc::Status Copy(const memory_service::CopyRequest& request,
+                      memory_service::CopyResponse* response) override;
+    grpc::Status Clone(const memory_service::CloneRequest& request,
+                       memory_service::CloneResponse* response) override;
+    grpc::Status RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                    memory_service::RegisterTypeLayoutResponse* response) override;
+    grpc::Status Heartbeat(const memory_service::HeartbeatRequest& request,
+                           memory_service::HeartbeatResponse* response) override;
+    grpc::Status CreateRegion(const memory_service::CreateRegionRequest& request,
+                              memory_service::CreateRegionResponse* response) override;
+    grpc::Status DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                               memory_service::DestroyRegionResponse* response) override;
+    grpc::Status GetStats(const memory_service::GetStatsRequest& request,
+                          memory_service::GetStatsResponse* response) override;
+    grpc::Status GetUsage(const memory_service::GetUsageRequest& request,
+                          memory_service::GetUsageResponse* response) override;
+
+private:
+    std::shared_ptr<Transport> primary_;
+    std::vector<std::shared_ptr<Transport>> replicas_;
+    uint32_t max_staleness_ms_;
+    std::atomic<size_t> next_replica_{0};
+};
+
+#endif // REPLICATED_TRANSPORT_H
@@ -0,0 +1,101 @@
+#include "reservation_pool.h"
+#include "release_queue.h"
+#include "client_runtime.h"
+#include <atomic>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+std::atomic<uint32_t> batch_size{64};
+std::atomic<int64_t> lease_ms{30000};
+
+struct Pool {
+    std::vector<uint64_t> ids;
+    // Ids are only handed out during the first half of their lease, which
+    // leaves the deferred claim ample time to reach the server
+    std::chrono::steady_clock::time_point usable_until;
+    bool unsupported = false;
+};
+
+struct ThreadPools {
+    std::map<std::tuple<uint64_t, int, uint32_t, uint32_t>, Pool> pools;  // Size, type, layout, alignment
+    uint64_t generation = 0;  // ClientRuntime generation the ids came from
+
+    ~ThreadPools() {
+        for (auto& entry : pools) {
+            for (uint64_t id : entry.second.ids) {
+                ReleaseQueue::getInstance().push(id);
+            }
+        }
+    }
+};
+
+thread_local ThreadPools thread_pools;
+
+} // namespace
+
+uint64_t ReservationPool::take(Transport& transport, uint64_t size, memory_service::DataType type,
+                              uint32_t layout_id, uint32_t alignment) {
+    uint32_t batch = batch_size.load(std::memory_order_relaxed);
+    if (batch == 0) {
+        return 0;
+    }
+
+    // Ids reserved before a re-Init belong to the previous backend
+    uint64_t generation = ClientRuntime::getInstance().generation();
+    if (thread_pools.generation != generation) {
+        thread_pools.pools.clear();
+        thread_pools.generation = generation;
+    }
+
+    Pool& pool = thread_pools.pools[std::make_tuple(size, static_cast<int>(type), layout_id, alignment)];
+    if (pool.unsupported) {
+        return 0;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!pool.ids.empty() && now >= pool.usable_until) {
+        // Too close to expiry to hand out: give them back
+        for (uint64_t id : pool.ids) {
+            ReleaseQueue::getInstance().push(id);
+        }
+        pool.ids.clear();
+    }
+
+    if (pool.ids.empty()) {
+        memory_service::ReserveRequest request;
+        memory_service::ReserveResponse response;
+
+        request.set_size(size);
+        request.set_type(type);
+        request.set_count(batch);
+        request.set_lease_ms(static_cast<uint32_t>(lease_ms.load(std::memory_order_relaxed)));
+        request.set_layout_id(layout_id);
+        request.set_alignment(alignment);
+
+        grpc::Status status = transport.Reserve(request, &response);
+        if (status.error_code() == grpc::StatusCode::UNIMPLEMENTED) {
+            // Older server: stop asking
+            pool.unsupported = true;
+            return 0;
+        }
+        if (!status.ok() || !response.success()) {
+            return 0;
+        }
+
+        // Hand out the lowest ids first
+        pool.ids.assign(response.ids().rbegin(), response.ids().rend());
+        pool.usable_until = now + std::chrono::milliseconds(response.lease_ms() / 2);
+    }
+
+    uint64_t id = pool.ids.back();
+    pool.ids.pop_back();
+    return id;
+}
+
+void ReservationPool::configure(uint32_t batch, std::chrono::milliseconds lease) {
+    batch_size = batch;
+    lease_ms = lease.count();
+}
@@ -0,0 +1,24 @@
+#ifndef RESERVATION_POOL_H
+#define RESERVATION_POOL_H
+
+#include <chrono>
+#include <cstdint>
+#include "transport.h"
+
+// Per-thread pools of blocks reserved ahead of MPointer<T>::New(). Each thread
+// keeps one pool per block shape (size, type, layout and alignment), which is one pool per T, and
+// refills it with a single Reserve call when it runs dry. Ids left over when a
+// thread exits are handed back through the release queue; ids the process
+// never returns are freed by the server when their lease expires.
+class ReservationPool {
+public:
+    // Returns a reserved block id, or 0 if none could be reserved (the caller
+    // then falls back to Create)
+    static uint64_t take(Transport& transport, uint64_t size, memory_service::DataType type,
+                         uint32_t layout_id = 0, uint32_t alignment = 0);
+
+    // Blocks requested per refill (0 disables reservations) and lease length
+    static void configure(uint32_t batch_size, std::chrono::milliseconds lease);
+};
+
+#endif // RESERVATION_POOL_H
@@ -0,0 +1,335 @@
+#include "sharded_transport.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// splitmix64 finalizer: spreads sequential keys and string hashes over the ring
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a: unlike std::hash, the same on every build, so every client puts
+// a server on the same ring points
+uint64_t name_hash(const std::string& name) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (unsigned char c : name) {
+        hash = (hash ^ c) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Rejections use the same shape as the server's own
+template<typename Response>
+grpc::Status reject(Response* response, const std::string& message) {
+    response->set_success(false);
+    response->set_error_message(message);
+    return grpc::Status::OK;
+}
+
+const char* kUnknownShard = "Block id does not belong to any shard";
+
+} // namespace
+
+ShardedTransport::ShardedTransport(std::vector<std::pair<std::string, std::shared_ptr<Transport>>> shards) {
+    if (shards.empty() || shards.size() > kMaxShards) {
+        throw std::invalid_argument("ShardedTransport needs between 1 and 65535 shards");
+    }
+
+    for (size_t shard = 0; shard < shards.size(); ++shard) {
+        uint64_t hash = name_hash(shards[shard].first);
+        // The tag in an id comes from the name too, so every client that
+        // names a server the same way decodes its ids to it, whatever the
+        // order of the list and whichever servers are added later
+        uint16_t shard_tag = static_cast<uint16_t>(hash % kMaxShards + 1);
+        if (!shard_by_tag_.emplace(shard_tag, shard).second) {
+            throw std::invalid_argument("Shards " + shards[shard_by_tag_[shard_tag]].first + " and " +
+                                        shards[shard].first + " map to the same id tag");
+        }
+        tags_.push_back(shard_tag);
+        for (int point = 0; point < kVirtualNodes; ++point) {
+            ring_.emplace_back(mix(hash ^ mix(point)), shard);
+        }
+    }
+    for (auto& shard : shards) {
+        shards_.push_back(std::move(shard.second));
+    }
+    std::sort(ring_.begin(), ring_.end());
+}
+
+size_t ShardedTransport::pick_shard() {
+    // New() has no natural key, so the transport's own sequence is hashed
+    // instead: the same sequence of calls lands on the same shards every run
+    uint64_t key = mix(next_key_.fetch_add(1, std::memory_order_relaxed));
+    auto it = std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(key, size_t(0)));
+    if (it == ring_.end()) {
+        it = ring_.begin();
+    }
+    return it->second;
+}
+
+uint64_t ShardedTransport::tag(size_t shard, uint64_t local_id) const {
+    return (static_cast<uint64_t>(tags_[shard]) << kShardShift) | local_id;
+}
+
+uint64_t ShardedTransport::local(uint64_t id) {
+    return id & ((uint64_t(1) << kShardShift) - 1);
+}
+
+int ShardedTransport::shard_of(uint64_t id) const {
+    auto it = shard_by_tag_.find(static_cast<uint16_t>(id >> kShardShift));
+    if (it == shard_by_tag_.end()) {
+        return -1;
+    }
+    return static_cast<int>(it->second);
+}
+
+grpc::Status ShardedTransport::Create(const memory_service::CreateRequest& request,
+                                      memory_service::CreateResponse* response) {
+    if (request.region_id() != 0) {
+        // Region ids are tagged like block ids; the block joins the region's shard
+        int shard = shard_of(request.region_id());
+        if (shard < 0) {
+            return reject(response, kUnknownShard);
+        }
+        memory_service::CreateRequest forwarded(request);
+        forwarded.set_region_id(local(request.region_id()));
+        grpc::Status status = shards_[shard]->Create(forwarded, response);
+        if (status.ok() && response->success()) {
+            response->set_id(tag(shard, response->id()));
+        }
+        return status;
+    }
+    size_t shard = pick_shard();
+    grpc::Status status = shards_[shard]->Create(request, response);
+    if (status.ok() && response->success()) {
+        response->set_id(tag(shard, response->id()));
+    }
+    return status;
+}
+
+grpc::Status ShardedTransport::Set(const memory_service::SetRequest& request,
+                                   memory_service::SetResponse* response) {
+    int shard = shard_of(request.id());
+    if (shard < 0) {
+        return reject(response, kUnknownShard);
+    }
+    memory_service::SetRequest forwarded(request);
+    forwarded.set_id(local(request.id()));
+    return shards_[shard]->Set(forwarded, response);
+}
+
+grpc::Status ShardedTransport::Get(const memory_service::GetRequest& request,
+                                   memory_service::GetResponse* response) {
+    int shard = shard_of(request.id());
+    if (shard < 0) {
+        return reject(response, kUnknownShard);
+    }
+    memory_service::GetRequest forwarded(request);
+    forwarded.set_id(local(request.id()));
+    return shards_[shard]->Get(forwarded, response);
+}
+
+grpc::Status ShardedTransport::IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                                memory_service::RefCountResponse* response) {
+    int shard = shard_of(request.id());
+    if (shard < 0) {
+        return reject(response, kUnknownShard);
+    }
+    memory_service::RefCountRequest forwarded(request);
+    forwarded.set_id(local(request.id()));
+    return shards_[shard]->IncreaseRefCount(forwarded, response);
+}
+
+grpc::Status ShardedTransport::DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                                memory_service::RefCountResponse* response) {
+    int shard = shard_of(request.id());
+    if (shard < 0) {
+        return reject(response, kUnknownShard);
+    }
+    memory_service::RefCountRequest forwarded(request);
+    forwarded.set_id(local(request.id()));
+    return shards_[shard]->DecreaseRefCount(forwarded, response);
+}
+
+grpc::Status ShardedTransport::UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                               memory_service::RefCountBatchResponse* response) {
+    // One batch per shard; ids from unknown shards are skipped like unknown blocks
+    std::vector<memory_service::RefCountBatchRequest> batches(shards_.size());
+    for (auto& batch : batches) {
+        batch.set_session_id(request.session_id());
+    }
+    for (uint64_t id : request.decrease_ids()) {
+        int shard = shard_of(id);
+        if (shard >= 0) {
+            batches[shard].add_decrease_ids(local(id));
+        }
+    }
+    for (uint64_t id : request.claim_ids()) {
+        int shard = shard_of(id);
+        if (shard >= 0) {
+            batches[shard].add_claim_ids(local(id));
+        }
+    }
+
+    uint32_t applied = 0;
+    uint32_t claimed = 0;
+    grpc::Status result = grpc::Status::OK;
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        if (batches[shard].decrease_ids_size() == 0 && batches[shard].claim_ids_size() == 0) {
+            continue;
+        }
+        memory_service::RefCountBatchResponse shard_response;
+        grpc::Status status = shards_[shard]->UpdateRefCounts(batches[shard], &shard_response);
+        if (!status.ok()) {
+            // Keep going: the other shards' releases are independent
+            result = status;
+            continue;
+        }
+        applied += shard_response.applied();
+        claimed += shard_response.claimed();
+    }
+
+    // Same meaning as one server's reply: every release was applied
+    response->set_applied(applied);
+    response->set_claimed(claimed);
+    response->set_success(result.ok() && applied == static_cast<uint32_t>(request.decrease_ids_size()));
+    return result;
+}
+
+grpc::Status ShardedTransport::Reserve(const memory_service::ReserveRequest& request,
+                                       memory_service::ReserveResponse* response) {
+    size_t shard = pick_shard();
+    grpc::Status status = shards_[shard]->Reserve(request, response);
+    if (status.ok() && response->success()) {
+        for (auto& id : *response->mutable_ids()) {
+            id = tag(shard, id);
+        }
+    }
+    return status;
+}
+
+grpc::Status ShardedTransport::Compute(const memory_service::ComputeRequest& request,
+                                       memory_service::ComputeResponse* response) {
+    int shard = shard_of(request.id());
+    if (shard < 0) {
+        return reject(response, kUnknownShard);
+    }
+    memory_service::ComputeRequest forwarded(request);
+    forwarded.set_id(local(request.id()));
+    if (request.other_id() != 0) {
+        if (shard_of(request.other_id()) != shard) {
+            return reject(response, "Both blocks must live on the same shard");
+        }
+        forwarded.set_other_id(local(request.other_id()));
+    }
+    return shards_[shard]->Compute(forwarded, response);
+}
+
+grpc::Status ShardedTransport::Copy(const memory_service::CopyRequest& request,
+                                    memory_service::CopyResponse* response) {
+    int shard = shard_of(request.src_id());
+    if (shard < 0) {
+        return reject(response, kUnknownShard);
+    }
+    if (shard_of(request.dst_id()) != shard) {
+        return reject(response, "Both blocks must live on the same shard");
+    }
+    memory_service::CopyRequest forwarded(request);
+    forwarded.set_src_id(local(request.src_id()));
+    forwarded.set_dst_id(local(request.dst_id()));
+    return shards_[shard]->Copy(forwarded, response);
+}
+
+grpc::Status ShardedTransport::Clone(const memory_service::CloneRequest& request,
+                                     memory_service::CloneResponse* response) {
+    int shard = shard_of(request.id());
+    if (shard < 0) {
+        return reject(response, kUnknownShard);
+    }
+    memory_service::CloneRequest forwarded(request);
+    forwarded.set_id(local(request.id()));
+    grpc::Status status = shards_[shard]->Clone(forwarded, response);
+    if (status.ok() && response->success()) {
+        response->set_id(tag(shard, response->id()));
+    }
+    return status;
+}
+
+grpc::Status ShardedTransport::RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                                  memory_service::RegisterTypeLayoutResponse* response) {
+    // Every shard needs the layout; ids are derived from it, so they agree.
+    // Each shard also learns its tag, so it can count links to its own blocks
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        memory_service::RegisterTypeLayoutRequest forwarded(request);
+        forwarded.set_shard_tag(tags_[shard]);
+        grpc::Status status = shards_[shard]->RegisterTypeLayout(forwarded, response);
+        if (!status.ok() || !response->success()) {
+            return status;
+        }
+    }
+    return grpc::Status::OK;
+}
+
+grpc::Status ShardedTransport::Heartbeat(const memory_service::HeartbeatRequest& request,
+                                         memory_service::HeartbeatResponse* response) {
+    // The session id is the client's own, so every shard renews the same one
+    grpc::Status result = grpc::Status::OK;
+    for (auto& shard : shards_) {
+        memory_service::HeartbeatResponse shard_response;
+        grpc::Status status = shard->Heartbeat(request, &shard_response);
+        if (!status.ok()) {
+            // Keep going: a down shard must not let the others expire
+            result = status;
+            continue;
+        }
+        if (shard_response.expired()) {
+            // Lost on one shard is lost: the client opens a new session
+            response->set_expired(true);
+        }
+        response->set_lease_ms(shard_response.lease_ms());
+    }
+    response->set_success(result.ok() && !response->expired());
+    return result;
+}
+
+grpc::Status ShardedTransport::CreateRegion(const memory_service::CreateRegionRequest& request,
+                                            memory_service::CreateRegionResponse* response) {
+    size_t shard = pick_shard();
+    grpc::Status status = shards_[shard]->CreateRegion(request, response);
+    if (status.ok() && response->success()) {
+        response->set_region_id(tag(shard, response->region_id()));
+    }
+    return status;
+}
+
+grpc::Status ShardedTransport::DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                                             memory_service::DestroyRegionResponse* response) {
+    int shard = shard_of(request.region_id());
+    if (shard < 0) {
+        return reject(response, kUnknownShard);
+    }
+    memory_service::DestroyRegionRequest forwarded;
+    forwarded.set_region_id(local(request.region_id()));
+    return shards_[shard]->DestroyRegion(forwarded, response);
+}
+
+grpc::Status ShardedTransport::GetStats(const memory_service::GetStatsRequest& request,
+                                        memory_service::GetStatsResponse* response) {
+    // Each server reports on itself
+    if (request.shard() >= shards_.size()) {
+        return reject(response, "No such shard");
+    }
+    return shards_[request.shard()]->GetStats(request, response);
+}
+
+grpc::Status ShardedTransport::GetUsage(const memory_service::GetUsageRequest& request,
+                                        memory_service::GetUsageResponse* response) {
+    if (request.shard() >= shards_.size()) {
+        return reject(response, "No such shard");
+    }
+    return shards_[request.shard()]->GetUsage(request, response);
+}
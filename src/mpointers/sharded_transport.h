@@ -0,0 +1,92 @@
+#ifndef SHARDED_TRANSPORT_H
+#define SHARDED_TRANSPORT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "transport.h"
+
+// Spreads blocks over several memory managers. New blocks go to the shard
+// picked by a consistent-hash ring, and the shard is encoded in the top 16
+// bits of every id handed to the client, so later calls on a block go
+// straight to its owner:
+//
+//   id = tag(server name) << 48 | server-local id
+//
+// The tag is a hash of the server's name (1..65535), not its position in
+// the list. Every client sharing blocks must name each server the same way
+// (e.g. always "host:port", never "localhost" in one and "127.0.0.1" in
+// another), or they decode ids to different servers.
+//
+// Operations on two blocks (Copy, DOT/ADD Compute) need both on one shard.
+// Region ids are tagged the same way; blocks created in a region live on
+// the region's shard.
+class ShardedTransport : public Transport {
+public:
+    static constexpr int kShardShift = 48;
+    static constexpr size_t kMaxShards = 0xFFFF;
+
+    // Shards are identified by name (normally their address); the ring
+    // position of a shard depends only on its name, so adding a server
+    // moves only the share of new blocks that the new server takes over.
+    // Throws std::invalid_argument for an empty list or two names whose
+    // tags collide (rename one, e.g. use its IP instead of its host name).
+    ShardedTransport(std::vector<std::pair<std::string, std::shared_ptr<Transport>>> shards);
+
+    size_t shard_count() const { return shards_.size(); }
+
+    // Shard owning a client id, or -1 for ids this transport did not issue
+    int shard_of(uint64_t id) const;
+
+    grpc::Status Create(const memory_service::CreateRequest& request,
+                        memory_service::CreateResponse* response) override;
+    grpc::Status Set(const memory_service::SetRequest& request,
+                     memory_service::SetResponse* response) override;
+    grpc::Status Get(const memory_service::GetRequest& request,
+                     memory_service::GetResponse* response) override;
+    grpc::Status IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                  memory_service::RefCountResponse* response) override;
+    grpc::Status DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                  memory_service::RefCountResponse* response) override;
+    grpc::Status UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                 memory_service::RefCountBatchResponse* response) override;
+    grpc::Status Reserve(const memory_service::ReserveRequest& request,
+                         memory_service::ReserveResponse* response) override;
+    grpc::Status Compute(const memory_service::ComputeRequest& request,
+                         memory_service::ComputeResponse* response) override;
+    grpc::Status Copy(const memory_service::CopyRequest& request,
+                      memory_service::CopyResponse* response) override;
+    grpc::Status Clone(const memory_service::CloneRequest& request,
+                       memory_service::CloneResponse* response) override;
+    grpc::Status RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                    memory_service::RegisterTypeLayoutResponse* response) override;
+    grpc::Status Heartbeat(const memory_service::HeartbeatRequest& request,
+                           memory_service::HeartbeatResponse* response) override;
+    grpc::Status CreateRegion(const memory_service::CreateRegionRequest& request,
+                              memory_service::CreateRegionResponse* response) override;
+    grpc::Status DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                               memory_service::DestroyRegionResponse* response) override;
+    grpc::Status GetStats(const memory_service::GetStatsRequest& request,
+                          memory_service::GetStatsResponse* response) override;
+    grpc::Status GetUsage(const memory_service::GetUsageRequest& request,
+                          memory_service::GetUsageResponse* response) override;
+
+private:
+    static constexpr int kVirtualNodes = 64;  // Ring points per shard
+
+    std::vector<std::shared_ptr<Transport>> shards_;
+    std::vector<uint16_t> tags_;                         // Id tag per shard
+    std::unordered_map<uint16_t, size_t> shard_by_tag_;  // Id tag -> shard
+    std::vector<std::pair<uint64_t, size_t>> ring_;  // Sorted (point, shard)
+    std::atomic<uint64_t> next_key_{0};
+
+    size_t pick_shard();
+    uint64_t tag(size_t shard, uint64_t local_id) const;
+    static uint64_t local(uint64_t id);
+};
+
+#endif // SHARDED_TRANSPORT_H
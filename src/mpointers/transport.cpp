@@ -0,0 +1,205 @@
+#include "transport.h"
+
+GrpcTransport::GrpcTransport(std::shared_ptr<grpc::Channel> channel, std::chrono::milliseconds timeout)
+    : stub_(memory_service::MemoryManager::NewStub(channel)), timeout_(timeout) {}
+
+void GrpcTransport::prepare(grpc::ClientContext& context) const {
+    context.set_deadline(std::chrono::system_clock::now() + timeout_);
+}
+
+grpc::Status GrpcTransport::Create(const memory_service::CreateRequest& request,
+                                   memory_service::CreateResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->Create(&context, request, response);
+}
+
+grpc::Status GrpcTransport::Set(const memory_service::SetRequest& request,
+                                memory_service::SetResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->Set(&context, request, response);
+}
+
+grpc::Status GrpcTransport::Get(const memory_service::GetRequest& request,
+                                memory_service::GetResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->Get(&context, request, response);
+}
+
+grpc::Status GrpcTransport::IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                             memory_service::RefCountResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->IncreaseRefCount(&context, request, response);
+}
+
+grpc::Status GrpcTransport::DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                             memory_service::RefCountResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->DecreaseRefCount(&context, request, response);
+}
+
+grpc::Status GrpcTransport::UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                            memory_service::RefCountBatchResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->UpdateRefCounts(&context, request, response);
+}
+
+grpc::Status GrpcTransport::Reserve(const memory_service::ReserveRequest& request,
+                                    memory_service::ReserveResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->Reserve(&context, request, response);
+}
+
+grpc::Status GrpcTransport::Compute(const memory_service::ComputeRequest& request,
+                                    memory_service::ComputeResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->Compute(&context, request, response);
+}
+
+grpc::Status GrpcTransport::Copy(const memory_service::CopyRequest& request,
+                                 memory_service::CopyResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->Copy(&context, request, response);
+}
+
+grpc::Status GrpcTransport::Clone(const memory_service::CloneRequest& request,
+                                  memory_service::CloneResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->Clone(&context, request, response);
+}
+
+grpc::Status GrpcTransport::RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                               memory_service::RegisterTypeLayoutResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->RegisterTypeLayout(&context, request, response);
+}
+
+grpc::Status GrpcTransport::Heartbeat(const memory_service::HeartbeatRequest& request,
+                                      memory_service::HeartbeatResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->Heartbeat(&context, request, response);
+}
+
+grpc::Status GrpcTransport::CreateRegion(const memory_service::CreateRegionRequest& request,
+                                         memory_service::CreateRegionResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->CreateRegion(&context, request, response);
+}
+
+grpc::Status GrpcTransport::DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                                          memory_service::DestroyRegionResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->DestroyRegion(&context, request, response);
+}
+
+grpc::Status GrpcTransport::GetStats(const memory_service::GetStatsRequest& request,
+                                     memory_service::GetStatsResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->GetStats(&context, request, response);
+}
+
+grpc::Status GrpcTransport::GetUsage(const memory_service::GetUsageRequest& request,
+                                     memory_service::GetUsageResponse* response) {
+    grpc::ClientContext context;
+    prepare(context);
+    return stub_->GetUsage(&context, request, response);
+}
+
+InProcessTransport::InProcessTransport(memory_service::MemoryManager::Service* service)
+    : service_(service) {}
+
+// The service handlers never look at their ServerContext, so none is built
+
+grpc::Status InProcessTransport::Create(const memory_service::CreateRequest& request,
+                                        memory_service::CreateResponse* response) {
+    return service_->Create(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::Set(const memory_service::SetRequest& request,
+                                     memory_service::SetResponse* response) {
+    return service_->Set(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::Get(const memory_service::GetRequest& request,
+                                     memory_service::GetResponse* response) {
+    return service_->Get(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                                  memory_service::RefCountResponse* response) {
+    return service_->IncreaseRefCount(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                                  memory_service::RefCountResponse* response) {
+    return service_->DecreaseRefCount(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                                 memory_service::RefCountBatchResponse* response) {
+    return service_->UpdateRefCounts(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::Reserve(const memory_service::ReserveRequest& request,
+                                         memory_service::ReserveResponse* response) {
+    return service_->Reserve(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::Compute(const memory_service::ComputeRequest& request,
+                                         memory_service::ComputeResponse* response) {
+    return service_->Compute(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::Copy(const memory_service::CopyRequest& request,
+                                      memory_service::CopyResponse* response) {
+    return service_->Copy(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::Clone(const memory_service::CloneRequest& request,
+                                       memory_service::CloneResponse* response) {
+    return service_->Clone(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                                    memory_service::RegisterTypeLayoutResponse* response) {
+    return service_->RegisterTypeLayout(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::Heartbeat(const memory_service::HeartbeatRequest& request,
+                                           memory_service::HeartbeatResponse* response) {
+    return service_->Heartbeat(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::CreateRegion(const memory_service::CreateRegionRequest& request,
+                                              memory_service::CreateRegionResponse* response) {
+    return service_->CreateRegion(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                                               memory_service::DestroyRegionResponse* response) {
+    return service_->DestroyRegion(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::GetStats(const memory_service::GetStatsRequest& request,
+                                          memory_service::GetStatsResponse* response) {
+    return service_->GetStats(nullptr, &request, response);
+}
+
+grpc::Status InProcessTransport::GetUsage(const memory_service::GetUsageRequest& request,
+                                          memory_service::GetUsageResponse* response) {
+    return service_->GetUsage(nullptr, &request, response);
+}
@@ -0,0 +1,142 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <chrono>
+#include <memory>
+#include <grpcpp/grpcpp.h>
+#include "memory_service.pb.h"
+#include "memory_service.grpc.pb.h"
+
+// How MPointer reaches a memory manager. Every call mirrors one RPC of
+// memory_service.proto and reports failures the same way the RPC would: a
+// non-OK status for transport errors, success=false in the response for
+// rejected requests.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual grpc::Status Create(const memory_service::CreateRequest& request,
+                                memory_service::CreateResponse* response) = 0;
+    virtual grpc::Status Set(const memory_service::SetRequest& request,
+                             memory_service::SetResponse* response) = 0;
+    virtual grpc::Status Get(const memory_service::GetRequest& request,
+                             memory_service::GetResponse* response) = 0;
+    virtual grpc::Status IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                          memory_service::RefCountResponse* response) = 0;
+    virtual grpc::Status DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                          memory_service::RefCountResponse* response) = 0;
+    virtual grpc::Status UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                         memory_service::RefCountBatchResponse* response) = 0;
+    virtual grpc::Status Reserve(const memory_service::ReserveRequest& request,
+                                 memory_service::ReserveResponse* response) = 0;
+    virtual grpc::Status Compute(const memory_service::ComputeRequest& request,
+                                 memory_service::ComputeResponse* response) = 0;
+    virtual grpc::Status Copy(const memory_service::CopyRequest& request,
+                              memory_service::CopyResponse* response) = 0;
+    virtual grpc::Status Clone(const memory_service::CloneRequest& request,
+                               memory_service::CloneResponse* response) = 0;
+    virtual grpc::Status RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                            memory_service::RegisterTypeLayoutResponse* response) = 0;
+    virtual grpc::Status Heartbeat(const memory_service::HeartbeatRequest& request,
+                                   memory_service::HeartbeatResponse* response) = 0;
+    virtual grpc::Status CreateRegion(const memory_service::CreateRegionRequest& request,
+                                      memory_service::CreateRegionResponse* response) = 0;
+    virtual grpc::Status DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                                       memory_service::DestroyRegionResponse* response) = 0;
+    virtual grpc::Status GetStats(const memory_service::GetStatsRequest& request,
+                                  memory_service::GetStatsResponse* response) = 0;
+    virtual grpc::Status GetUsage(const memory_service::GetUsageRequest& request,
+                                  memory_service::GetUsageResponse* response) = 0;
+};
+
+// Remote memory manager over one gRPC channel; each call gets its own deadline
+class GrpcTransport : public Transport {
+public:
+    GrpcTransport(std::shared_ptr<grpc::Channel> channel, std::chrono::milliseconds timeout);
+
+    grpc::Status Create(const memory_service::CreateRequest& request,
+                        memory_service::CreateResponse* response) override;
+    grpc::Status Set(const memory_service::SetRequest& request,
+                     memory_service::SetResponse* response) override;
+    grpc::Status Get(const memory_service::GetRequest& request,
+                     memory_service::GetResponse* response) override;
+    grpc::Status IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                  memory_service::RefCountResponse* response) override;
+    grpc::Status DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                  memory_service::RefCountResponse* response) override;
+    grpc::Status UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                 memory_service::RefCountBatchResponse* response) override;
+    grpc::Status Reserve(const memory_service::ReserveRequest& request,
+                         memory_service::ReserveResponse* response) override;
+    grpc::Status Compute(const memory_service::ComputeRequest& request,
+                         memory_service::ComputeResponse* response) override;
+    grpc::Status Copy(const memory_service::CopyRequest& request,
+                      memory_service::CopyResponse* response) override;
+    grpc::Status Clone(const memory_service::CloneRequest& request,
+                       memory_service::CloneResponse* response) override;
+    grpc::Status RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                    memory_service::RegisterTypeLayoutResponse* response) override;
+    grpc::Status Heartbeat(const memory_service::HeartbeatRequest& request,
+                           memory_service::HeartbeatResponse* response) override;
+    grpc::Status CreateRegion(const memory_service::CreateRegionRequest& request,
+                              memory_service::CreateRegionResponse* response) override;
+    grpc::Status DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                               memory_service::DestroyRegionResponse* response) override;
+    grpc::Status GetStats(const memory_service::GetStatsRequest& request,
+                          memory_service::GetStatsResponse* response) override;
+    grpc::Status GetUsage(const memory_service::GetUsageRequest& request,
+                          memory_service::GetUsageResponse* response) override;
+
+private:
+    std::unique_ptr<memory_service::MemoryManager::Stub> stub_;
+    std::chrono::milliseconds timeout_;
+
+    void prepare(grpc::ClientContext& context) const;
+};
+
+// Memory manager living in this process: calls go straight to the service
+// implementation (normally MemoryManager::getInstance()) with no
+// serialization, sockets or threads in between. The service must outlive
+// the transport.
+class InProcessTransport : public Transport {
+public:
+    explicit InProcessTransport(memory_service::MemoryManager::Service* service);
+
+    grpc::Status Create(const memory_service::CreateRequest& request,
+                        memory_service::CreateResponse* response) override;
+    grpc::Status Set(const memory_service::SetRequest& request,
+                     memory_service::SetResponse* response) override;
+    grpc::Status Get(const memory_service::GetRequest& request,
+                     memory_service::GetResponse* response) override;
+    grpc::Status IncreaseRefCount(const memory_service::RefCountRequest& request,
+                                  memory_service::RefCountResponse* response) override;
+    grpc::Status DecreaseRefCount(const memory_service::RefCountRequest& request,
+                                  memory_service::RefCountResponse* response) override;
+    grpc::Status UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                 memory_service::RefCountBatchResponse* response) override;
+    grpc::Status Reserve(const memory_service::ReserveRequest& request,
+                         memory_service::ReserveResponse* response) override;
+    grpc::Status Compute(const memory_service::ComputeRequest& request,
+                         memory_service::ComputeResponse* response) override;
+    grpc::Status Copy(const memory_service::CopyRequest& request,
+                      memory_service::CopyResponse* response) override;
+    grpc::Status Clone(const memory_service::CloneRequest& request,
+                       memory_service::CloneResponse* response) override;
+    grpc::Status RegisterTypeLayout(const memory_service::RegisterTypeLayoutRequest& request,
+                                    memory_service::RegisterTypeLayoutResponse* response) override;
+    grpc::Status Heartbeat(const memory_service::HeartbeatRequest& request,
+                           memory_service::HeartbeatResponse* response) override;
+    grpc::Status CreateRegion(const memory_service::CreateRegionRequest& request,
+                              memory_service::CreateRegionResponse* response) override;
+    grpc::Status DestroyRegion(const memory_service::DestroyRegionRequest& request,
+                               memory_service::DestroyRegionResponse* response) override;
+    grpc::Status GetStats(const memory_service::GetStatsRequest& request,
+                          memory_service::GetStatsResponse* response) override;
+    grpc::Status GetUsage(const memory_service::GetUsageRequest& request,
+                          memory_service::GetUsageResponse* response) override;
+
+private:
+    memory_service::MemoryManager::Service* service_;
+};
+
+#endif // TRANSPORT_H
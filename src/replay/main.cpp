@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "memory_manager/memory_manager.h"
+
+// Replays an allocation trace (mem-mgr --trace) against an in-process
+// MemoryManager as fast as it will go. Blocks are freed exactly where the
+// trace says the server freed them, so runs with different arena settings
+// or compaction policies see the same allocation sequence.
+
+void print_usage() {
+    std::cout << "Usage: ./mem-replay --trace FILE --memsize SIZE_MB [--segmentMB SIZE_MB]"
+              << " [--defrag traced|off|FREES]" << std::endl;
+}
+
+static constexpr size_t kSampleEvery = 1024;
+
+static double to_mb(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5 || argc % 2 == 0) {
+        print_usage();
+        return 1;
+    }
+
+    std::string trace_path;
+    size_t memsize = 0;
+    size_t segment_size = MemoryManager::kDefaultSegmentSize;
+    bool traced_defrag = true;
+    size_t defrag_every = 0;  // Compact after this many frees, 0 for never
+
+    try {
+        for (int i = 1; i < argc; i += 2) {
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if (arg == "--trace") {
+                trace_path = value;
+            } else if (arg == "--memsize") {
+                memsize = std::stoull(value) * 1024 * 1024;
+            } else if (arg == "--segmentMB") {
+                segment_size = std::stoull(value) * 1024 * 1024;
+            } else if (arg == "--defrag") {
+                traced_defrag = value == "traced";
+                defrag_every = traced_defrag || value == "off" ? 0 : std::stoull(value);
+            } else {
+                print_usage();
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        print_usage();
+        return 1;
+    }
+    if (trace_path.empty() || memsize == 0) {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<TraceEvent> events;
+    uint64_t missing = 0;
+    std::string error;
+    if (!AllocTrace::load(trace_path, events, missing, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    if (missing > 0) {
+        std::cerr << "Warning: the trace is missing " << missing << " events the server dropped" << std::endl;
+    }
+
+    auto dump_folder = std::filesystem::temp_directory_path() / "mpointers_replay";
+    MemoryManager* manager = MemoryManager::getInstance();
+    manager->setDumps(false);
+    if (!manager->initialize(0, memsize, dump_folder.string(), WalOptions(), 0, segment_size)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+
+    // Trace ids -> replayed ids, with the reference count the replay holds
+    struct Replayed {
+        uint32_t id;
+        uint32_t refCount;
+    };
+    std::unordered_map<uint32_t, Replayed> blocks;
+    std::unordered_map<uint32_t, uint32_t> regions;
+
+    size_t counts[TraceEvent::RegionDestroy + 1] = {};
+    size_t failed_creates = 0;
+    size_t frees_since_defrag = 0;
+    size_t defrags = 0;
+    size_t peak_committed = 0;
+    std::chrono::steady_clock::duration sampling{0};
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& event = events[i];
+        if (event.kind <= TraceEvent::RegionDestroy) {
+            counts[event.kind]++;
+        }
+
+        switch (event.kind) {
+            case TraceEvent::Create: {
+                uint32_t region = 0;
+                if (event.arg != 0) {
+                    auto it = regions.find(event.arg);
+                    if (it == regions.end()) break;
+                    region = it->second;
+                }
+                std::string type = memory_service::DataType_Name(static_cast<memory_service::DataType>(event.type));
+                uint32_t id = manager->createBlock(event.size, type, 0, 0, region);
+                if (id == static_cast<uint32_t>(-1)) {
+                    failed_creates++;
+                    break;
+                }
+                blocks[event.id] = Replayed{id, 1};
+                break;
+            }
+            case TraceEvent::RefCount: {
+                auto it = blocks.find(event.id);
+                if (it == blocks.end()) break;
+                Replayed& block = it->second;
+                for (; block.refCount < event.arg; ++block.refCount) {
+                    manager->increaseRefCount(block.id);
+                }
+                for (; block.refCount > event.arg; --block.refCount) {
+                    manager->decreaseRefCount(block.id);
+                }
+                break;
+            }
+            case TraceEvent::Free: {
+                auto it = blocks.find(event.id);
+                if (it == blocks.end()) break;
+                manager->releaseBlock(it->second.id);
+                blocks.erase(it);
+                if (defrag_every > 0 && ++frees_since_defrag == defrag_every) {
+                    manager->defragment();
+                    frees_since_defrag = 0;
+                    defrags++;
+                }
+                break;
+            }
+            case TraceEvent::Defragment:
+                if (traced_defrag) {
+                    manager->defragment();
+                    defrags++;
+                }
+                break;
+            case TraceEvent::RegionCreate: {
+                uint32_t region = manager->createRegion(event.size);
+                if (region != 0) {
+                    regions[event.id] = region;
+                }
+                break;
+            }
+            case TraceEvent::RegionDestroy: {
+                // Members' Free events follow and find nothing left to free
+                auto it = regions.find(event.id);
+                if (it == regions.end()) break;
+                size_t freed = 0;
+                manager->destroyRegion(it->second, freed);
+                regions.erase(it);
+                break;
+            }
+        }
+
+        if (i % kSampleEvery == 0) {
+            auto sample_start = std::chrono::steady_clock::now();
+            peak_committed = std::max(peak_committed, manager->arenaStats().committed);
+            sampling += std::chrono::steady_clock::now() - sample_start;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start - sampling).count();
+
+    MemoryManager::ArenaStats stats = manager->arenaStats();
+    peak_committed = std::max(peak_committed, stats.committed);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Replayed " << events.size() << " events in " << seconds << " s ("
+              << std::setprecision(0) << (seconds > 0 ? events.size() / seconds : 0.0) << " events/s)\n"
+              << "  creates " << counts[TraceEvent::Create] << ", frees " << counts[TraceEvent::Free]
+              << ", refcount changes " << counts[TraceEvent::RefCount]
+              << ", regions " << counts[TraceEvent::RegionCreate] << ", compactions " << defrags << "\n"
+              << "  failed creates " << failed_creates << "\n"
+              << std::setprecision(2)
+              << "Peak committed: " << to_mb(peak_committed) << " MB (sampled every " << kSampleEvery << " events)\n"
+              << "Final: " << stats.liveBlocks << " live blocks, " << to_mb(stats.liveBytes) << " MB live, "
+              << to_mb(stats.committed) << " MB committed in " << stats.segments << " segments, "
+              << "fragmentation " << stats.fragmentation() << std::endl;
+    return failed_creates == 0 ? 0 : 2;
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <csignal>
+#include <filesystem>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/mpointers/mpointer.h"
+#include "../src/mpointers/client_runtime.h"
+
+// Starts a local mem-mgr and initializes one channel pool for the whole
+// process. Checks that round-robin spreads calls over every channel, that
+// another MPointer<T> type works without its own Init(), that several
+// threads can share the pool, and that re-initializing with per-thread
+// affinity keeps earlier handles working.
+
+#ifndef MEM_MGR_PATH
+#define MEM_MGR_PATH "./mem-mgr"
+#endif
+
+static bool read_int(Transport& transport, uint64_t id, int& value) {
+    memory_service::GetRequest request;
+    memory_service::GetResponse response;
+    request.set_id(id);
+    if (!transport.Get(request, &response).ok() || !response.success() ||
+        response.value().size() != sizeof(int)) {
+        return false;
+    }
+    std::memcpy(&value, response.value().data(), sizeof(int));
+    return true;
+}
+
+int main() {
+    const std::string address = "localhost:50101";
+    const size_t channels = 4;
+    const int threads = 8;
+    const int blocks = 50;
+    auto dump_folder = std::filesystem::temp_directory_path() / "mpointers_channel_pool_test";
+    int result = 1;
+
+    pid_t server = fork();
+    if (server == 0) {
+        execl(MEM_MGR_PATH, MEM_MGR_PATH, "--port", "50101", "--memsize", "16",
+              "--dumpFolder", dump_folder.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    try {
+        ClientOptions options;
+        options.channels = channels;
+        options.policy = ChannelPolicy::RoundRobin;
+        MPointer<int>::Init(address, options);
+        ClientRuntime& runtime = ClientRuntime::getInstance();
+
+        std::set<Transport*> used;
+        for (size_t i = 0; i < channels; ++i) {
+            used.insert(runtime.transport().get());
+        }
+        std::cout << "Channels: " << runtime.channel_count() << ", used by " << channels
+                  << " round-robin calls: " << used.size() << std::endl;
+        bool round_robin = runtime.channel_count() == channels && used.size() == channels;
+
+        // Another type shares the pool without calling Init()
+        MPointer<double> shared = MPointer<double>::New();
+        shared = 2.5;
+
+        // Threads write and read back their own blocks over the shared pool
+        std::vector<std::vector<MPointer<int>>> ptrs(threads);
+        std::vector<int> mismatches(threads, 0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < blocks; ++i) {
+                    ptrs[t].push_back(MPointer<int>::New());
+                    ptrs[t].back() = t * blocks + i;
+                }
+                for (int i = 0; i < blocks; ++i) {
+                    int value = -1;
+                    if (!read_int(*runtime.transport(), ptrs[t][i].id(), value) || value != t * blocks + i) {
+                        mismatches[t]++;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        int wrong = 0;
+        for (int count : mismatches) {
+            wrong += count;
+        }
+        std::cout << "Mismatched values from " << threads << " threads: " << wrong << std::endl;
+
+        // With affinity a thread keeps its channel; handles survive re-Init
+        options.policy = ChannelPolicy::ThreadAffinity;
+        MPointer<int>::Init(address, options);
+        bool affinity = runtime.transport() == runtime.transport();
+        int value = -1;
+        bool survived = read_int(*runtime.transport(), ptrs[0][0].id(), value) && value == 0;
+        std::cout << "Same channel twice with affinity: " << (affinity ? "yes" : "no")
+                  << ", handle read after re-Init: " << (survived ? "ok" : "failed") << std::endl;
+
+        if (round_robin && wrong == 0 && affinity && survived) {
+            std::cout << "Test completed successfully!" << std::endl;
+            result = 0;
+        } else {
+            std::cerr << "Channel pool test failed" << std::endl;
+        }
+
+        ptrs.clear();
+        shared.reset();
+        MPointer<int>::flush();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+    return result;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "../src/memory_manager/memory_manager.h"
+
+// Clones a block copy-on-write and checks the clone takes no arena space
+// until its first write, which splits it from the source without touching
+// either side's data. Also checks a plain clone and a Copy between blocks.
+static std::string read_block(MemoryManager* manager, uint32_t id, size_t size) {
+    std::string data(size, '\0');
+    if (!manager->getValue(id, data.data(), size)) {
+        return std::string();
+    }
+    return data;
+}
+
+int main() {
+    const size_t size = 64 * 1024;
+
+    std::string dump_folder = (std::filesystem::temp_directory_path() / "mpointers_clone_test").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 16 * 1024 * 1024, dump_folder)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+
+    int failures = 0;
+    std::string original(size, 'a');
+    uint32_t source = manager->createBlock(size, "CHAR");
+    manager->setValue(source, original.data(), size);
+
+    size_t before = manager->arenaStats().freeBytes;
+    uint32_t cow = manager->cloneBlock(source, true);
+    size_t shared = manager->arenaStats().freeBytes;
+    std::cout << "Arena bytes taken by a copy-on-write clone: " << before - shared << std::endl;
+    if (shared != before || read_block(manager, cow, size) != original) {
+        std::cerr << "Copy-on-write clone did not share the source" << std::endl;
+        failures++;
+    }
+
+    // The first write gives the clone its own copy
+    std::string changed(size, 'b');
+    manager->setValue(cow, changed.data(), size);
+    size_t split = manager->arenaStats().freeBytes;
+    std::cout << "Arena bytes taken after the first write: " << shared - split << std::endl;
+    if (shared - split < size || read_block(manager, cow, size) != changed ||
+        read_block(manager, source, size) != original) {
+        std::cerr << "First write did not split the clone from the source" << std::endl;
+        failures++;
+    }
+
+    // Writing the source splits it the same way
+    uint32_t second = manager->cloneBlock(source, true);
+    manager->setValue(source, changed.data(), size);
+    if (read_block(manager, second, size) != original || read_block(manager, source, size) != changed) {
+        std::cerr << "Writing the source changed its clone" << std::endl;
+        failures++;
+    }
+
+    // A plain clone copies at once
+    before = manager->arenaStats().freeBytes;
+    uint32_t copy = manager->cloneBlock(source, false);
+    if (before - manager->arenaStats().freeBytes < size || read_block(manager, copy, size) != changed) {
+        std::cerr << "Plain clone did not copy the source" << std::endl;
+        failures++;
+    }
+
+    // Copy a range from one block into the middle of another
+    manager->copyRange(second, 0, copy, 100, 16);
+    std::string expected = changed;
+    expected.replace(100, 16, 16, 'a');
+    if (read_block(manager, copy, size) != expected || read_block(manager, second, size) != original) {
+        std::cerr << "Copy wrote the wrong range" << std::endl;
+        failures++;
+    }
+
+    if (failures > 0) {
+        std::cerr << "Clone test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+#include <memory>
+#include <filesystem>
+#include "../src/mpointers/mpointer.h"
+#include "../src/memory_manager/memory_manager.h"
+
+// Runs MPointer against a MemoryManager embedded in this process, with no
+// server. Pass a server address (e.g. localhost:50051) to time the same
+// workload over gRPC and see how much of the latency is transport.
+static double time_assignments(int iterations) {
+    MPointer<int> ptr = MPointer<int>::New();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        ptr = i;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    const int iterations = 1000;
+
+    try {
+        std::string dump_folder = (std::filesystem::temp_directory_path() / "mpointers_embedded_test").string();
+        MemoryManager* manager = MemoryManager::getInstance();
+        if (!manager->initialize(0, 16 * 1024 * 1024, dump_folder)) {
+            std::cerr << "Failed to initialize embedded memory manager" << std::endl;
+            return 1;
+        }
+
+        std::cout << "Initializing MPointer with an in-process transport..." << std::endl;
+        MPointer<int>::Init(std::make_shared<InProcessTransport>(manager));
+
+        {
+            MPointer<int> ptr = MPointer<int>::New();
+            ptr = 42;
+            std::cout << "Reading value: " << *ptr << std::endl;
+            if (*ptr != 42) {
+                std::cerr << "Unexpected value" << std::endl;
+                return 1;
+            }
+
+            MPointer<int> copy = ptr.clone(false);
+            std::cout << "Clone " << copy.id() << " of block " << ptr.id() << std::endl;
+        }
+
+        std::cout << "In-process assignment: " << time_assignments(iterations) << " us/op" << std::endl;
+        // Releases go to the embedded manager before switching transports
+        MPointer<int>::flush();
+
+        if (argc > 1) {
+            MPointer<int>::Init(argv[1]);
+            std::cout << "gRPC assignment (" << argv[1] << "): "
+                      << time_assignments(iterations) << " us/op" << std::endl;
+        }
+
+        std::cout << "Test completed successfully!" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <filesystem>
+#include "../src/memory_manager/memory_manager.h"
+
+// Profiles Set and Get handlers called from several threads on an embedded
+// MemoryManager and checks the Chrome trace file has the requests, their
+// lock wait and hold spans, their phases and the slowest-requests track.
+int main() {
+    const int threads = 4;
+    const int rounds = 200;
+
+    auto folder = std::filesystem::temp_directory_path() / "mpointers_profile_test";
+    std::string profile_path = (folder / "profile.json").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 16 * 1024 * 1024, folder.string())) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+    if (!manager->startProfile(profile_path, 5)) {
+        std::cerr << "Failed to open " << profile_path << std::endl;
+        return 1;
+    }
+
+    // Handlers are reached through the service interface, as gRPC does
+    memory_service::MemoryManager::Service* service = manager;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([service]() {
+            memory_service::CreateRequest create;
+            create.set_size(sizeof(int));
+            create.set_type(memory_service::INT);
+            memory_service::CreateResponse created;
+            service->Create(nullptr, &create, &created);
+            for (int i = 0; i < rounds; ++i) {
+                memory_service::SetRequest set;
+                set.set_id(created.id());
+                set.set_value(&i, sizeof(i));
+                memory_service::SetResponse set_response;
+                service->Set(nullptr, &set, &set_response);
+
+                memory_service::GetRequest get;
+                get.set_id(created.id());
+                memory_service::GetResponse get_response;
+                service->Get(nullptr, &get, &get_response);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    manager->stop();
+
+    std::ifstream file(profile_path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string json = contents.str();
+
+    size_t sets = 0;
+    for (size_t at = json.find("{\"name\":\"Set\",\"cat\":\"rpc\""); at != std::string::npos;
+         at = json.find("{\"name\":\"Set\",\"cat\":\"rpc\"", at + 1)) {
+        sets++;
+    }
+    std::cout << "Trace file: " << json.size() << " bytes, " << sets << " Set requests" << std::endl;
+
+    // The timeline has every Set; the slowest track repeats a few of them
+    if (json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) != 0 ||
+        sets < static_cast<size_t>(threads * rounds) ||
+        json.find("\"wait setValue\"") == std::string::npos ||
+        json.find("\"hold getValue\"") == std::string::npos ||
+        json.find("\"name\":\"lookup\",\"cat\":\"phase\"") == std::string::npos ||
+        json.find("\"slowest requests\"") == std::string::npos ||
+        json.find("\"rank\":5") == std::string::npos) {
+        std::cerr << "Profile test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
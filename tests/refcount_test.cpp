@@ -0,0 +1,102 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <filesystem>
+#include "../src/mpointers/mpointer.h"
+#include "../src/mpointers/ref_registry.h"
+#include "../src/memory_manager/memory_manager.h"
+
+// Copies, assigns and passes an MPointer around from several threads and
+// checks the server sees no reference count traffic for it: the process
+// keeps one server reference while any local handle is alive, and drops
+// it once the last handle goes.
+static bool block_exists(Transport& transport, uint64_t id) {
+    memory_service::GetRequest request;
+    memory_service::GetResponse response;
+    request.set_id(id);
+    return transport.Get(request, &response).ok() && response.success();
+}
+
+// Reference count RPCs the server has answered so far
+static uint64_t refcount_calls() {
+    uint64_t calls = 0;
+    memory_service::GetStatsResponse stats = MPointer<int>::Stats();
+    for (const auto& rpc : stats.rpcs()) {
+        if (rpc.method() == "IncreaseRefCount" || rpc.method() == "DecreaseRefCount" ||
+            rpc.method() == "UpdateRefCounts") {
+            calls += rpc.calls();
+        }
+    }
+    return calls;
+}
+
+static int read_by_value(MPointer<int> ptr) {
+    return *ptr;
+}
+
+int main() {
+    const int copies = 1000;
+
+    std::string dump_folder = (std::filesystem::temp_directory_path() / "mpointers_refcount_test").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 16 * 1024 * 1024, dump_folder)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+    manager->start();
+    auto transport = std::make_shared<InProcessTransport>(manager);
+    MPointer<int>::Init(transport);
+
+    int failures = 0;
+    MPointer<int> ptr = MPointer<int>::New();
+    ptr = 7;
+    uint64_t id = ptr.id();
+    MPointer<int>::flush();
+    uint64_t before = refcount_calls();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            std::vector<MPointer<int>> held;
+            MPointer<int> assigned;
+            for (int i = 0; i < copies; ++i) {
+                held.push_back(ptr);
+                assigned = held.back();
+                read_by_value(assigned);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    MPointer<int>::flush();
+
+    uint64_t during = refcount_calls() - before;
+    std::cout << "Reference count RPCs for " << 4 * copies << " copies: " << during
+              << ", local count left: " << RefRegistry::getInstance().count(id) << std::endl;
+    if (during != 0 || RefRegistry::getInstance().count(id) != 1) {
+        failures++;
+    }
+
+    // The last handle releases the one server reference; the GC frees the block
+    ptr.reset();
+    MPointer<int>::flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    bool freed = !block_exists(*transport, id);
+    std::cout << "Block freed after the last handle: " << (freed ? "yes" : "no") << std::endl;
+    if (!freed) {
+        failures++;
+    }
+
+    manager->stop();
+    if (failures > 0) {
+        std::cerr << "Reference count test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
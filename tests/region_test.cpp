@@ -0,0 +1,154 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include "../src/mpointers/mpointer.h"
+#include "../src/mpointers/reservation_pool.h"
+#include "../src/memory_manager/memory_manager.h"
+
+// Allocates a region's worth of blocks between ordinary ones in an embedded
+// MemoryManager, compacts the arena so the region's chunks move, checks
+// every value, then frees the region with a single DestroyRegion.
+// Then checks regions survive WAL recovery.
+static bool read_int(Transport& transport, uint64_t id, int& value) {
+    memory_service::GetRequest request;
+    memory_service::GetResponse response;
+    request.set_id(id);
+    if (!transport.Get(request, &response).ok() || !response.success() ||
+        response.value().size() != sizeof(int)) {
+        return false;
+    }
+    std::memcpy(&value, response.value().data(), sizeof(int));
+    return true;
+}
+
+// Fills a region with the WAL on, checkpointing halfway, drops every
+// reference to its blocks and recovers from the log: the blocks must
+// still be held by the region, and DestroyRegion must still free them.
+static int recover_region(MemoryManager* manager, const std::filesystem::path& folder) {
+    const uint64_t session = 5;
+    const int blocks = 100;
+    std::filesystem::remove_all(folder);
+    WalOptions wal;
+    wal.enabled = true;
+    wal.commitWindow = std::chrono::microseconds(100);
+    if (!manager->initialize(0, 16 * 1024 * 1024, folder.string(), wal)) {
+        std::cerr << "Failed to initialize memory manager with the WAL" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+    manager->heartbeat(session, std::chrono::seconds(10));
+    uint32_t region = manager->createRegion(16 * sizeof(int), session);
+    std::vector<uint32_t> members;
+    for (int i = 0; i < blocks; ++i) {
+        if (i == blocks / 2) {
+            manager->checkpoint();
+        }
+        members.push_back(manager->createBlock(sizeof(int), "INT", 0, session, region));
+        manager->setValue(members.back(), &i, sizeof(i));
+        manager->decreaseRefCount(members.back(), session);
+    }
+    manager->stop();
+
+    if (!manager->initialize(0, 16 * 1024 * 1024, folder.string(), wal)) {
+        std::cerr << "Failed to recover memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+    manager->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));  // One GC pass
+
+    int failures = 0;
+    int intact = 0;
+    for (int i = 0; i < blocks; ++i) {
+        int value = -1;
+        intact += manager->getValue(members[i], &value, sizeof(value)) && value == i ? 1 : 0;
+    }
+    size_t freed = 0;
+    bool destroyed = manager->destroyRegion(region, freed);
+    std::cout << "Region blocks intact after recovery: " << intact << ", DestroyRegion freed "
+              << freed << std::endl;
+    if (intact != blocks || !destroyed || freed != static_cast<size_t>(blocks)) {
+        failures++;
+    }
+    // A new region must not reuse the recovered one's id
+    if (manager->createRegion(0) == region) {
+        failures++;
+    }
+    manager->stop();
+    return failures;
+}
+
+int main() {
+    const int blocks = 1000;
+
+    std::string dump_folder = (std::filesystem::temp_directory_path() / "mpointers_region_test").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 16 * 1024 * 1024, dump_folder)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->start();
+    auto transport = std::make_shared<InProcessTransport>(manager);
+    MPointer<int>::Init(transport);
+    ReservationPool::configure(0, std::chrono::seconds(30));
+
+    int failures = 0;
+    try {
+        // Ordinary blocks interleaved with small region chunks leave holes
+        // once they are freed
+        uint64_t region = MPointer<int>::CreateRegion(64 * sizeof(int));
+        std::vector<MPointer<int>> members;
+        {
+            std::vector<MPointer<int>> scratch;
+            for (int i = 0; i < blocks; ++i) {
+                if (i % 64 == 0) {
+                    scratch.push_back(MPointer<int>::New());
+                    scratch.back() = -1;
+                }
+                members.push_back(MPointer<int>::New(region));
+                members.back() = i;
+            }
+        }
+        MPointer<int>::flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));  // One GC pass
+        manager->defragment();
+
+        for (int i = 0; i < blocks; ++i) {
+            int value = 0;
+            if (!read_int(*transport, members[i].id(), value) || value != i) {
+                failures++;
+            }
+        }
+        std::cout << "Region blocks wrong after compaction: " << failures << std::endl;
+
+        size_t freed = MPointer<int>::DestroyRegion(region);
+        std::cout << "DestroyRegion freed " << freed << " blocks" << std::endl;
+        if (freed != static_cast<size_t>(blocks)) {
+            failures++;
+        }
+        int value = 0;
+        for (const auto& member : members) {
+            if (read_int(*transport, member.id(), value)) {
+                failures++;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Region test failed: " << e.what() << std::endl;
+        manager->stop();
+        return 1;
+    }
+
+    manager->stop();
+    failures += recover_region(manager, std::filesystem::temp_directory_path() / "mpointers_region_test_wal");
+    if (failures != 0) {
+        std::cerr << "Region test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <csignal>
+#include <filesystem>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/mpointers/mpointer.h"
+
+// Starts a primary mem-mgr and writes through it, then starts a backup that
+// catches up from a snapshot while the primary stays idle, reads the data
+// back from the backup, then promotes the backup and writes to it.
+
+#ifndef MEM_MGR_PATH
+#define MEM_MGR_PATH "./mem-mgr"
+#endif
+
+static pid_t start_server(const std::string& port, const std::string& dump_folder,
+                          const std::string& replica_of = "") {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (replica_of.empty()) {
+            execl(MEM_MGR_PATH, MEM_MGR_PATH, "--port", port.c_str(), "--memsize", "16",
+                  "--dumpFolder", dump_folder.c_str(), static_cast<char*>(nullptr));
+        } else {
+            execl(MEM_MGR_PATH, MEM_MGR_PATH, "--port", port.c_str(), "--memsize", "16",
+                  "--dumpFolder", dump_folder.c_str(), "--replicaOf", replica_of.c_str(),
+                  static_cast<char*>(nullptr));
+        }
+        _exit(127);
+    }
+    return pid;
+}
+
+static bool read_int(Transport& transport, uint64_t id, uint32_t max_staleness_ms, int& value) {
+    memory_service::GetRequest request;
+    memory_service::GetResponse response;
+    request.set_id(id);
+    request.set_max_staleness_ms(max_staleness_ms);
+    grpc::Status status = transport.Get(request, &response);
+    if (!status.ok() || !response.success() || response.value().size() != sizeof(int)) {
+        return false;
+    }
+    std::memcpy(&value, response.value().data(), sizeof(int));
+    return true;
+}
+
+int main() {
+    const std::string primary_address = "localhost:50081";
+    const std::string backup_address = "localhost:50082";
+    const int blocks = 200;
+    auto dump_root = std::filesystem::temp_directory_path() / "mpointers_replication_test";
+    int result = 1;
+
+    pid_t primary = start_server("50081", (dump_root / "primary").string());
+    pid_t backup = 0;
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    try {
+        ClientOptions options;
+        options.read_replicas = {backup_address};
+        options.max_staleness = std::chrono::milliseconds(500);
+        MPointer<int>::Init(primary_address, options);
+
+        std::vector<MPointer<int>> ptrs;
+        for (int i = 0; i < blocks; ++i) {
+            MPointer<int> ptr = MPointer<int>::New();
+            ptr = i;
+            ptrs.push_back(std::move(ptr));
+        }
+
+        // The backup joins an idle primary, so after the snapshot it only
+        // gets empty heartbeat batches; those must keep it within the bound
+        backup = start_server("50082", (dump_root / "backup").string(), primary_address);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        GrpcTransport backup_transport(grpc::CreateChannel(backup_address, grpc::InsecureChannelCredentials()),
+                                       std::chrono::seconds(5));
+        int mismatches = 0;
+        for (int i = 0; i < blocks; ++i) {
+            int value = -1;
+            if (!read_int(backup_transport, ptrs[i].id(), 500, value) || value != i) {
+                mismatches++;
+            }
+        }
+        std::cout << "Blocks missing or stale on the backup: " << mismatches << std::endl;
+
+        // The backup refuses writes until promoted
+        memory_service::SetRequest set;
+        memory_service::SetResponse set_response;
+        int value = 1234;
+        set.set_id(ptrs[0].id());
+        set.set_value(std::string(reinterpret_cast<const char*>(&value), sizeof(int)));
+        backup_transport.Set(set, &set_response);
+        bool rejected = !set_response.success();
+        std::cout << "Write to backup rejected: " << (rejected ? "yes" : "no") << std::endl;
+
+        // Failover: kill the primary and promote the backup
+        kill(primary, SIGTERM);
+        waitpid(primary, nullptr, 0);
+        primary = 0;
+
+        auto stub = memory_service::MemoryManager::NewStub(
+            grpc::CreateChannel(backup_address, grpc::InsecureChannelCredentials()));
+        grpc::ClientContext context;
+        memory_service::PromoteRequest promote;
+        memory_service::PromoteResponse promote_response;
+        stub->Promote(&context, promote, &promote_response);
+        std::cout << "Promoted backup at sequence " << promote_response.sequence() << std::endl;
+
+        set_response.Clear();
+        backup_transport.Set(set, &set_response);
+        int read_back = -1;
+        bool promoted = promote_response.success() && set_response.success() &&
+                        read_int(backup_transport, ptrs[0].id(), 0, read_back) && read_back == value;
+        std::cout << "Write after promotion: " << (promoted ? "ok" : "failed") << std::endl;
+
+        if (mismatches == 0 && rejected && promoted) {
+            std::cout << "Test completed successfully!" << std::endl;
+            result = 0;
+        } else {
+            std::cerr << "Replication test failed" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    for (pid_t pid : {primary, backup}) {
+        if (pid > 0) {
+            kill(pid, SIGTERM);
+            waitpid(pid, nullptr, 0);
+        }
+    }
+    // Handles still alive refer to servers that are gone
+    _exit(result);
+}
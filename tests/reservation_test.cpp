@@ -0,0 +1,129 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <filesystem>
+#include <cstring>
+#include "../src/mpointers/mpointer.h"
+#include "../src/mpointers/reservation_pool.h"
+#include "../src/memory_manager/memory_manager.h"
+
+// Creates a few blocks through MPointer<int>::New() with a short lease and
+// checks they come from one Reserve call, that the claimed blocks outlive
+// the lease while the unclaimed rest of the batch is reclaimed, and that
+// New() reserves a fresh batch once the old one is too close to expiry,
+// and that a claim whose first send fails is not lost.
+static bool read_int(Transport& transport, uint64_t id, int& value) {
+    memory_service::GetRequest request;
+    memory_service::GetResponse response;
+    request.set_id(id);
+    if (!transport.Get(request, &response).ok() || !response.success() ||
+        response.value().size() != sizeof(int)) {
+        return false;
+    }
+    std::memcpy(&value, response.value().data(), sizeof(int));
+    return true;
+}
+
+// Fails every UpdateRefCounts while `down` is set, like an unreachable server
+class FlakyTransport : public InProcessTransport {
+public:
+    using InProcessTransport::InProcessTransport;
+    std::atomic<bool> down{false};
+
+    grpc::Status UpdateRefCounts(const memory_service::RefCountBatchRequest& request,
+                                 memory_service::RefCountBatchResponse* response) override {
+        if (down) {
+            return grpc::Status(grpc::StatusCode::UNAVAILABLE, "server down");
+        }
+        return InProcessTransport::UpdateRefCounts(request, response);
+    }
+};
+
+static uint64_t calls(const std::string& method) {
+    memory_service::GetStatsResponse stats = MPointer<int>::Stats();
+    for (const auto& rpc : stats.rpcs()) {
+        if (rpc.method() == method) return rpc.calls();
+    }
+    return 0;
+}
+
+int main() {
+    const uint32_t batch = 8;
+    const int taken = 5;
+    const auto lease = std::chrono::milliseconds(600);
+
+    std::string dump_folder = (std::filesystem::temp_directory_path() / "mpointers_reservation_test").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 16 * 1024 * 1024, dump_folder)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+    manager->start();
+    auto transport = std::make_shared<FlakyTransport>(manager);
+    MPointer<int>::Init(transport);
+    ReservationPool::configure(batch, lease);
+
+    int failures = 0;
+    std::vector<MPointer<int>> ptrs;
+    for (int i = 0; i < taken; ++i) {
+        ptrs.push_back(MPointer<int>::New());
+        ptrs.back() = i;
+    }
+    MPointer<int>::flush();
+    std::cout << "Reserve calls: " << calls("Reserve") << ", Create calls: " << calls("Create")
+              << ", live blocks: " << manager->arenaStats().liveBlocks << std::endl;
+    if (calls("Reserve") != 1 || calls("Create") != 0 || manager->arenaStats().liveBlocks != batch) {
+        failures++;
+    }
+
+    // Lease plus one GC pass: only the claimed blocks are left
+    std::this_thread::sleep_for(lease + std::chrono::milliseconds(1200));
+    int intact = 0;
+    for (int i = 0; i < taken; ++i) {
+        int value = -1;
+        intact += read_int(*transport, ptrs[i].id(), value) && value == i ? 1 : 0;
+    }
+    size_t live = manager->arenaStats().liveBlocks;
+    std::cout << "Live blocks after the lease: " << live << ", claimed blocks intact: " << intact << std::endl;
+    if (live != static_cast<size_t>(taken) || intact != taken) {
+        failures++;
+    }
+
+    // The rest of the old batch has expired, so New() reserves again
+    MPointer<int> fresh = MPointer<int>::New();
+    fresh = 99;
+    std::cout << "Reserve calls after the lease: " << calls("Reserve") << std::endl;
+    int value = -1;
+    if (calls("Reserve") != 2 || !read_int(*transport, fresh.id(), value) || value != 99) {
+        failures++;
+    }
+
+    // A claim whose send fails is kept and sent again, so the block still
+    // outlives the lease
+    transport->down = true;
+    MPointer<int> retried = MPointer<int>::New();
+    retried = 42;
+    MPointer<int>::flush();
+    transport->down = false;
+    MPointer<int>::flush();
+    std::this_thread::sleep_for(lease + std::chrono::milliseconds(1200));
+    value = -1;
+    bool survived = read_int(*transport, retried.id(), value) && value == 42;
+    std::cout << "Block whose claim failed once, after the lease: " << (survived ? "intact" : "freed") << std::endl;
+    if (!survived) {
+        failures++;
+    }
+
+    manager->stop();
+    if (failures > 0) {
+        std::cerr << "Reservation test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
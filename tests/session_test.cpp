@@ -0,0 +1,200 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <filesystem>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/mpointers/mpointer.h"
+#include "../src/mpointers/release_queue.h"
+
+// Starts a mem-mgr, lets a child client take references and die without
+// releasing them, then checks the server reclaims the blocks once the
+// child's session lease runs out while a live client keeps its own. A
+// client that stalls past its lease and then releases must not drop the
+// reference a second time, and one that renews its session must not take
+// a second reference to a block whose claim is still queued.
+
+#ifndef MEM_MGR_PATH
+#define MEM_MGR_PATH "./mem-mgr"
+#endif
+
+static bool block_exists(Transport& transport, uint64_t id) {
+    memory_service::GetRequest request;
+    memory_service::GetResponse response;
+    request.set_id(id);
+    return transport.Get(request, &response).ok() && response.success();
+}
+
+static bool heartbeat(Transport& transport, uint64_t session, uint32_t lease_ms, bool resume,
+                      memory_service::HeartbeatResponse& response) {
+    memory_service::HeartbeatRequest request;
+    request.set_session_id(session);
+    request.set_lease_ms(lease_ms);
+    request.set_resume(resume);
+    return transport.Heartbeat(request, &response).ok();
+}
+
+// Takes a reference to `id` under a session that then lapses, as if the
+// client were paused; returns whether the late release was refused, the
+// server reported the session expired and the block survived
+static bool stale_release(Transport& transport, uint64_t id) {
+    const uint64_t session = 0x5e55;
+    memory_service::HeartbeatResponse opened;
+    if (!heartbeat(transport, session, 300, false, opened) || !opened.success()) {
+        return false;
+    }
+    memory_service::RefCountRequest request;
+    memory_service::RefCountResponse response;
+    request.set_id(id);
+    request.set_session_id(session);
+    if (!transport.IncreaseRefCount(request, &response).ok() || !response.success()) {
+        return false;
+    }
+
+    // Lease plus one GC pass: the server drops the reference itself
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    memory_service::RefCountResponse late;
+    bool refused = transport.DecreaseRefCount(request, &late).ok() && !late.success();
+    memory_service::HeartbeatResponse resumed;
+    bool expired = heartbeat(transport, session, 300, true, resumed) && resumed.expired();
+
+    // Another pass would free the block had the release gone through
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    std::cout << "Late release refused: " << refused << ", session reported expired: " << expired << std::endl;
+    return refused && expired && block_exists(transport, id);
+}
+
+// Lets this client's session lapse while the claim on a reserved block is
+// still queued. After the client renews its session, the block must hold
+// one reference, so dropping the handle frees it.
+static bool renewed_claim(Transport& transport) {
+    // Let the flusher finish its current wait and start a long one
+    ReleaseQueue::getInstance().configure(1 << 20, std::chrono::seconds(60));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    MPointer<int> claimed = MPointer<int>::New();
+    uint64_t id = claimed.id();
+    uint64_t session = ClientRuntime::getInstance().session_id();
+
+    // Shrink the session's lease from outside until the GC drops it
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(1500);
+    while (std::chrono::steady_clock::now() < until) {
+        memory_service::HeartbeatResponse response;
+        heartbeat(transport, session, 1, true, response);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    // The client's next heartbeat finds it expired and opens a new one
+    until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (ClientRuntime::getInstance().session_id() == session && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    bool renewed = ClientRuntime::getInstance().session_id() != session;
+
+    ReleaseQueue::getInstance().configure(256, std::chrono::milliseconds(20));
+    MPointer<int>::flush();
+    claimed.reset();
+    MPointer<int>::flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));  // One GC pass
+    bool freed = !block_exists(transport, id);
+    std::cout << "Session renewed: " << renewed << ", block with a queued claim freed after its release: "
+              << freed << std::endl;
+    return renewed && freed;
+}
+
+// Takes references with a short lease, reports the ids and crashes
+static void crashing_client(const std::string& address, int blocks, int fd) {
+    ClientOptions options;
+    options.session_lease = std::chrono::milliseconds(500);
+    MPointer<int>::Init(address, options);
+
+    std::vector<MPointer<int>> ptrs;
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < blocks; ++i) {
+        ptrs.push_back(MPointer<int>::New());
+        ptrs.back() = i;
+        ids.push_back(ptrs.back().id());
+    }
+    MPointer<int>::flush();  // Reservation claims reach the server
+    if (write(fd, ids.data(), ids.size() * sizeof(uint64_t)) < 0) {
+        _exit(1);
+    }
+    kill(getpid(), SIGKILL);
+}
+
+int main() {
+    const std::string address = "localhost:50091";
+    const int blocks = 100;
+    auto dump_folder = std::filesystem::temp_directory_path() / "mpointers_session_test";
+    int result = 1;
+
+    pid_t server = fork();
+    if (server == 0) {
+        execl(MEM_MGR_PATH, MEM_MGR_PATH, "--port", "50091", "--memsize", "16",
+              "--dumpFolder", dump_folder.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        kill(server, SIGTERM);
+        return 1;
+    }
+    pid_t client = fork();
+    if (client == 0) {
+        close(fds[0]);
+        crashing_client(address, blocks, fds[1]);
+        _exit(1);
+    }
+    close(fds[1]);
+    std::vector<uint64_t> ids(blocks);
+    ssize_t got = read(fds[0], ids.data(), ids.size() * sizeof(uint64_t));
+    close(fds[0]);
+    waitpid(client, nullptr, 0);
+
+    try {
+        if (got != static_cast<ssize_t>(ids.size() * sizeof(uint64_t))) {
+            throw std::runtime_error("Client did not report its blocks");
+        }
+
+        MPointer<int>::Init(address);
+        MPointer<int> kept = MPointer<int>::New();
+        kept = 7;
+
+        GrpcTransport transport(grpc::CreateChannel(address, grpc::InsecureChannelCredentials()),
+                                std::chrono::seconds(5));
+        int alive = 0;
+        for (uint64_t id : ids) {
+            alive += block_exists(transport, id) ? 1 : 0;
+        }
+        std::cout << "Blocks held by the crashed client: " << alive << std::endl;
+
+        // Lease plus one GC pass
+        std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+        int leaked = 0;
+        for (uint64_t id : ids) {
+            leaked += block_exists(transport, id) ? 1 : 0;
+        }
+        std::cout << "Blocks left after the lease: " << leaked << std::endl;
+
+        bool stale_ok = stale_release(transport, kept.id()) && *kept == 7;
+        // Last: the lapsed session takes `kept` with it
+        bool renew_ok = renewed_claim(transport);
+
+        if (alive == blocks && leaked == 0 && stale_ok && renew_ok) {
+            std::cout << "Test completed successfully!" << std::endl;
+            result = 0;
+        } else {
+            std::cerr << "Session test failed" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Session test failed: " << e.what() << std::endl;
+    }
+
+    MPointer<int>::flush();
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+    return result;
+}
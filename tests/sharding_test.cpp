@@ -0,0 +1,126 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <csignal>
+#include <filesystem>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <grpcpp/grpcpp.h>
+#include "../src/mpointers/mpointer.h"
+#include "../src/mpointers/sharded_transport.h"
+
+// Starts three local mem-mgr processes, shards blocks over them and checks
+// that every block is created, written and read back on its own server,
+// also by a second transport that lists the servers in the reverse order,
+// and that a partly applied release batch is reported as a failure.
+
+#ifndef MEM_MGR_PATH
+#define MEM_MGR_PATH "./mem-mgr"
+#endif
+
+static pid_t start_server(const std::string& port, const std::string& dump_folder) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(MEM_MGR_PATH, MEM_MGR_PATH, "--port", port.c_str(), "--memsize", "16",
+              "--dumpFolder", dump_folder.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    return pid;
+}
+
+int main() {
+    const std::vector<std::string> ports = {"50071", "50072", "50073"};
+    const int blocks = 1000;
+    std::vector<pid_t> servers;
+    std::vector<std::string> addresses;
+    int result = 1;
+
+    auto dump_root = std::filesystem::temp_directory_path() / "mpointers_sharding_test";
+    for (const auto& port : ports) {
+        servers.push_back(start_server(port, (dump_root / port).string()));
+        addresses.push_back("localhost:" + port);
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    try {
+        std::cout << "Initializing MPointer with " << addresses.size() << " shards..." << std::endl;
+        MPointer<int>::Init(addresses);
+
+        std::vector<MPointer<int>> ptrs;
+        std::set<int> used_shards;
+        for (int i = 0; i < blocks; ++i) {
+            MPointer<int> ptr = MPointer<int>::New();
+            ptr = i;
+            used_shards.insert(std::static_pointer_cast<ShardedTransport>(
+                ClientRuntime::getInstance().transport())->shard_of(ptr.id()));
+            ptrs.push_back(std::move(ptr));
+        }
+        std::cout << "Blocks spread over " << used_shards.size() << " shards" << std::endl;
+
+        // Read every block back through the routing layer, and through one
+        // built from the same servers listed the other way round
+        std::vector<std::pair<std::string, std::shared_ptr<Transport>>> reversed;
+        for (auto it = addresses.rbegin(); it != addresses.rend(); ++it) {
+            reversed.emplace_back(*it, std::make_shared<GrpcTransport>(
+                grpc::CreateChannel(*it, grpc::InsecureChannelCredentials()), std::chrono::seconds(5)));
+        }
+        std::shared_ptr<Transport> transports[] = {ClientRuntime::getInstance().transport(),
+                                                   std::make_shared<ShardedTransport>(std::move(reversed))};
+        int mismatches = 0;
+        for (const auto& transport : transports) {
+            for (int i = 0; i < blocks; ++i) {
+                memory_service::GetRequest request;
+                memory_service::GetResponse response;
+                request.set_id(ptrs[i].id());
+                grpc::Status status = transport->Get(request, &response);
+                int value = -1;
+                if (status.ok() && response.success() && response.value().size() == sizeof(int)) {
+                    std::memcpy(&value, response.value().data(), sizeof(int));
+                }
+                if (value != i) {
+                    mismatches++;
+                }
+            }
+        }
+        std::cout << "Mismatched values: " << mismatches << std::endl;
+
+        // A batch one shard only partly applies is not a success
+        auto& sharded = *ClientRuntime::getInstance().transport();
+        memory_service::CreateRequest create;
+        memory_service::CreateResponse created;
+        create.set_size(sizeof(int));
+        create.set_type(memory_service::INT);
+        sharded.Create(create, &created);
+        memory_service::RefCountBatchRequest batch;
+        memory_service::RefCountBatchResponse batch_response;
+        batch.add_decrease_ids(created.id());
+        batch.add_decrease_ids(created.id());
+        grpc::Status batch_status = sharded.UpdateRefCounts(batch, &batch_response);
+        bool partial = batch_status.ok() && batch_response.applied() == 1 && !batch_response.success();
+        std::cout << "Releases applied from a batch of 2: " << batch_response.applied()
+                  << ", reported success: " << (batch_response.success() ? "yes" : "no") << std::endl;
+
+        if (used_shards.size() == ports.size() && mismatches == 0 && created.success() && partial) {
+            std::cout << "Test completed successfully!" << std::endl;
+            result = 0;
+        } else {
+            std::cerr << "Sharding test failed" << std::endl;
+        }
+
+        ptrs.clear();
+        MPointer<int>::flush();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    for (pid_t pid : servers) {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+    }
+    return result;
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <filesystem>
+#include "../src/memory_manager/simd_kernels.h"
+#include "../src/memory_manager/memory_manager.h"
+
+// Runs every kernel of every instruction set the CPU supports against the
+// scalar one. Reductions accumulate in double (int64 for INT) everywhere,
+// so only the order of the additions may differ; transforms must match
+// exactly, also when INT lanes overflow. Also checks MIN of an empty block
+// fails with its own error.
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "Mismatch: " << what << std::endl;
+        failures++;
+    }
+}
+
+static bool close_to(double a, double b) {
+    return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+}
+
+template<typename T>
+static void compare(simd::Isa isa, const std::vector<T>& a, const std::vector<T>& b, const char* type) {
+    const simd::KernelTable<T>& ref = simd::kernels<T>(simd::Isa::Scalar);
+    const simd::KernelTable<T>& k = simd::kernels<T>(isa);
+    std::string what = std::string(simd::isaName(isa)) + " " + type + " n=" + std::to_string(a.size());
+    size_t n = a.size();
+
+    check(close_to(static_cast<double>(k.sum(a.data(), n)), static_cast<double>(ref.sum(a.data(), n))),
+          what + " sum");
+    check(close_to(static_cast<double>(k.dot(a.data(), b.data(), n)),
+                   static_cast<double>(ref.dot(a.data(), b.data(), n))), what + " dot");
+    if (n > 0) {
+        check(k.min(a.data(), n) == ref.min(a.data(), n), what + " min");
+        check(k.max(a.data(), n) == ref.max(a.data(), n), what + " max");
+    }
+
+    std::vector<T> expected = a;
+    std::vector<T> actual = a;
+    ref.scale(expected.data(), n, static_cast<T>(3));
+    k.scale(actual.data(), n, static_cast<T>(3));
+    ref.add(expected.data(), b.data(), n);
+    k.add(actual.data(), b.data(), n);
+    check(expected == actual, what + " scale/add");
+    ref.fill(expected.data(), n, static_cast<T>(7));
+    k.fill(actual.data(), n, static_cast<T>(7));
+    check(expected == actual, what + " fill");
+}
+
+int main() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> real(0.0, 150.0);
+    std::uniform_int_distribution<int32_t> integer(-1000, 1000);
+
+    // Odd lengths exercise the scalar tails; 1M floats is where float lanes
+    // used to drift from the scalar sum
+    for (size_t n : {size_t(0), size_t(1), size_t(7), size_t(33), size_t(1000), size_t(1000003)}) {
+        std::vector<float> fa(n), fb(n);
+        std::vector<double> da(n), db(n);
+        std::vector<int32_t> ia(n), ib(n);
+        for (size_t i = 0; i < n; ++i) {
+            fa[i] = static_cast<float>(real(random));
+            fb[i] = static_cast<float>(real(random));
+            da[i] = real(random);
+            db[i] = real(random);
+            ia[i] = integer(random);
+            ib[i] = integer(random);
+        }
+        for (simd::Isa isa : {simd::Isa::SSE, simd::Isa::AVX2}) {
+            if (!simd::isSupported(isa)) continue;
+            compare(isa, fa, fb, "FLOAT");
+            compare(isa, da, db, "DOUBLE");
+            compare(isa, ia, ib, "INT");
+        }
+    }
+    // Values near the int32 limits: SCALE and ADD must wrap the same way on
+    // every instruction set, tail elements included
+    std::vector<int32_t> big(37), other(37);
+    for (size_t i = 0; i < big.size(); ++i) {
+        big[i] = i % 2 ? std::numeric_limits<int32_t>::max() - static_cast<int32_t>(i)
+                       : std::numeric_limits<int32_t>::min() + static_cast<int32_t>(i);
+        other[i] = i % 3 ? 1000 : -1000;
+    }
+    std::vector<int32_t> wrapped = big;
+    simd::kernels<int32_t>(simd::Isa::Scalar).scale(wrapped.data(), wrapped.size(), 3);
+    check(wrapped[1] == static_cast<int32_t>(3u * static_cast<uint32_t>(big[1])), "scalar INT scale wraps");
+    for (simd::Isa isa : {simd::Isa::SSE, simd::Isa::AVX2}) {
+        if (!simd::isSupported(isa)) continue;
+        compare(isa, big, other, "INT overflow");
+    }
+
+    std::cout << "Best instruction set: " << simd::isaName(simd::detectIsa()) << std::endl;
+
+    std::string dump_folder = (std::filesystem::temp_directory_path() / "mpointers_simd_kernels_test").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 1024 * 1024, dump_folder)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+    uint32_t empty = manager->createBlock(0, "FLOAT");
+    double result;
+    int64_t int_result;
+    std::string error;
+    bool computed = manager->compute(memory_service::MIN, empty, 0, 0, result, int_result, error);
+    std::cout << "MIN of an empty block: " << error << std::endl;
+    check(!computed && error.find("empty") != std::string::npos, "empty MIN error");
+
+    if (failures > 0) {
+        std::cerr << failures << " kernel results differ from the scalar reference" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
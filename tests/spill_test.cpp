@@ -0,0 +1,53 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "../src/memory_manager/memory_manager.h"
+
+// Stores four times --memsize worth of blocks in an embedded MemoryManager
+// with a spill file, then reads every block back and checks its contents.
+int main() {
+    const size_t arena = 1024 * 1024;
+    const size_t block_size = 64 * 1024;
+    const int blocks = 64;
+
+    std::string dump_folder = (std::filesystem::temp_directory_path() / "mpointers_spill_test").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, arena, dump_folder, WalOptions(), 16 * arena)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> ids;
+    std::vector<char> buffer(block_size);
+    for (int i = 0; i < blocks; ++i) {
+        uint32_t id = manager->createBlock(block_size, "CHAR");
+        if (id == static_cast<uint32_t>(-1)) {
+            std::cerr << "Allocation " << i << " failed" << std::endl;
+            return 1;
+        }
+        std::fill(buffer.begin(), buffer.end(), static_cast<char>(i));
+        if (!manager->setValue(id, buffer.data(), block_size)) {
+            std::cerr << "Write to block " << id << " failed" << std::endl;
+            return 1;
+        }
+        ids.push_back(id);
+    }
+    std::cout << "Stored " << (blocks * block_size) / 1024 << " KB in a " << arena / 1024 << " KB arena" << std::endl;
+
+    int mismatches = 0;
+    for (int i = 0; i < blocks; ++i) {
+        if (!manager->getValue(ids[i], buffer.data(), block_size) ||
+            buffer.front() != static_cast<char>(i) || buffer.back() != static_cast<char>(i)) {
+            mismatches++;
+        }
+    }
+    std::cout << "Blocks lost or corrupted: " << mismatches << std::endl;
+
+    if (mismatches != 0) {
+        std::cerr << "Spill test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <filesystem>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../src/mpointers/mpointer.h"
+#include "../src/memory_manager/memory_manager.h"
+
+// Creates blocks through an embedded MemoryManager, then checks GetStats
+// counts them and their RPCs, and that the metrics endpoint serves the
+// same numbers as Prometheus text.
+static std::string fetch_metrics(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::string text;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        ::send(fd, request.data(), request.size(), 0);
+        char buffer[4096];
+        ssize_t n;
+        while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            text.append(buffer, static_cast<size_t>(n));
+        }
+    }
+    ::close(fd);
+    return text;
+}
+
+int main() {
+    const int blocks = 50;
+    const uint16_t metrics_port = 50093;
+
+    std::string dump_folder = (std::filesystem::temp_directory_path() / "mpointers_stats_test").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 16 * 1024 * 1024, dump_folder)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+    if (!manager->startMetrics(metrics_port)) {
+        std::cerr << "Failed to start the metrics endpoint" << std::endl;
+        return 1;
+    }
+    MPointer<double>::Init(std::make_shared<InProcessTransport>(manager));
+
+    int failures = 0;
+    try {
+        std::vector<MPointer<double>> pointers;
+        for (int i = 0; i < blocks; ++i) {
+            pointers.push_back(MPointer<double>::New(MPointer<double>::CreateRegion(0)));
+            pointers.back() = i;
+        }
+
+        memory_service::GetStatsResponse stats = MPointer<double>::Stats();
+        uint64_t doubles = 0;
+        for (const auto& type : stats.types()) {
+            if (type.type() == "DOUBLE") doubles = type.blocks();
+        }
+        uint64_t sets = 0;
+        for (const auto& rpc : stats.rpcs()) {
+            if (rpc.method() == "Set") sets = rpc.calls();
+        }
+        std::cout << "Live blocks: " << stats.live_blocks() << ", DOUBLE blocks: " << doubles
+                  << ", Set calls: " << sets << ", committed: " << stats.committed_bytes() << std::endl;
+        if (doubles != static_cast<uint64_t>(blocks) || sets < static_cast<uint64_t>(blocks) ||
+            stats.live_bytes() < blocks * sizeof(double) || stats.committed_bytes() == 0) {
+            failures++;
+        }
+
+        std::string text = fetch_metrics(metrics_port);
+        if (text.find("mpointers_live_blocks{type=\"DOUBLE\"} " + std::to_string(blocks)) == std::string::npos ||
+            text.find("mpointers_rpc_latency_seconds_count{method=\"Set\"}") == std::string::npos) {
+            std::cerr << "Unexpected metrics:\n" << text << std::endl;
+            failures++;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Stats test failed: " << e.what() << std::endl;
+        manager->stop();
+        return 1;
+    }
+
+    manager->stop();
+    if (failures != 0) {
+        std::cerr << "Stats test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
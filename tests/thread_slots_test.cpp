@@ -0,0 +1,72 @@
+#include <iostream>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../src/common/thread_slots.h"
+
+// Runs short-lived threads one after another and checks they share one
+// slot with every count kept, that live threads get their own slots, and
+// that a thread may outlive the owner of a slot it holds.
+struct Counter {
+    std::atomic<uint64_t> value{0};
+};
+
+static uint64_t total(const ThreadSlots<Counter>& slots) {
+    uint64_t sum = 0;
+    slots.for_each([&](const Counter& counter) { sum += counter.value.load(); });
+    return sum;
+}
+
+int main() {
+    int failures = 0;
+
+    ThreadSlots<Counter> slots;
+    for (int i = 0; i < 100; ++i) {
+        std::thread([&] { slots.local().value += 1; }).join();
+    }
+    std::cout << "Sequential threads: " << slots.size() << " slot(s), total " << total(slots) << std::endl;
+    if (slots.size() != 1 || total(slots) != 100) {
+        failures++;
+    }
+
+    // Four threads alive at once need four slots, no more
+    const int live = 4;
+    std::atomic<int> arrived{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < live; ++i) {
+        threads.emplace_back([&] {
+            slots.local().value += 1;
+            arrived++;
+            while (arrived < live) std::this_thread::yield();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::cout << "Concurrent threads: " << slots.size() << " slot(s), total " << total(slots) << std::endl;
+    if (slots.size() != static_cast<size_t>(live) || total(slots) != 100 + live) {
+        failures++;
+    }
+
+    // The owner goes away while a thread still holds one of its slots
+    auto owner = std::make_unique<ThreadSlots<Counter>>();
+    std::atomic<bool> taken{false};
+    std::atomic<bool> released{false};
+    std::thread holder([&] {
+        owner->local().value += 1;
+        taken = true;
+        while (!released) std::this_thread::yield();
+    });
+    while (!taken) std::this_thread::yield();
+    owner.reset();
+    released = true;
+    holder.join();
+
+    if (failures > 0) {
+        std::cerr << "Thread slots test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include "../src/memory_manager/memory_manager.h"
+
+// Records an allocation trace from an embedded MemoryManager (creates, a GC
+// pass, a compaction and a region) and checks every event reads back in
+// order, as mem-replay would see it.
+int main() {
+    const int blocks = 100;
+    const int members = 10;
+
+    auto folder = std::filesystem::temp_directory_path() / "mpointers_trace_test";
+    std::string trace_path = (folder / "alloc.trace").string();
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 16 * 1024 * 1024, folder.string())) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    if (!manager->startTrace(trace_path)) {
+        std::cerr << "Failed to open " << trace_path << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < blocks; ++i) {
+        ids.push_back(manager->createBlock(8 + i, "CHAR"));
+    }
+    for (int i = 0; i < blocks; i += 2) {
+        manager->decreaseRefCount(ids[i]);
+    }
+    manager->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));  // One GC pass
+    manager->defragment();
+
+    uint32_t region = manager->createRegion(0);
+    for (int i = 0; i < members; ++i) {
+        manager->createBlock(16, "INT", 0, 0, region);
+    }
+    size_t freed = 0;
+    manager->destroyRegion(region, freed);
+    manager->stop();
+
+    std::vector<TraceEvent> events;
+    uint64_t missing = 0;
+    std::string error;
+    if (!AllocTrace::load(trace_path, events, missing, error)) {
+        std::cerr << "Trace test failed: " << error << std::endl;
+        return 1;
+    }
+
+    int counts[TraceEvent::RegionDestroy + 1] = {};
+    bool ordered = true;
+    for (size_t i = 0; i < events.size(); ++i) {
+        counts[events[i].kind]++;
+        ordered = ordered && events[i].sequence == i;
+    }
+    std::cout << "Events: " << events.size() << ", creates " << counts[TraceEvent::Create]
+              << ", frees " << counts[TraceEvent::Free] << ", compactions " << counts[TraceEvent::Defragment]
+              << ", missing " << missing << std::endl;
+
+    if (!ordered || missing != 0 ||
+        counts[TraceEvent::Create] != blocks + members ||
+        counts[TraceEvent::Free] != blocks / 2 + members ||
+        counts[TraceEvent::Defragment] != 1 ||
+        counts[TraceEvent::RegionCreate] != 1 || counts[TraceEvent::RegionDestroy] != 1 ||
+        counts[TraceEvent::RefCount] < blocks / 2) {
+        std::cerr << "Trace test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "../src/memory_manager/memory_manager.h"
+
+// Tags blocks from two sessions and an anonymous client on an embedded
+// MemoryManager, then checks GetUsage ranks them by bytes and by growth,
+// groups them, and follows frees and claimed reservations.
+static memory_service::GetUsageResponse usage(MemoryManager* manager, memory_service::UsageGroup group,
+                                              bool by_growth = false, uint32_t top = 0) {
+    memory_service::MemoryManager::Service* service = manager;
+    memory_service::GetUsageRequest request;
+    request.set_group_by(group);
+    request.set_by_growth(by_growth);
+    request.set_top(top);
+    memory_service::GetUsageResponse response;
+    service->GetUsage(nullptr, &request, &response);
+    return response;
+}
+
+int main() {
+    const uint64_t big = 11;
+    const uint64_t small = 22;
+
+    auto folder = std::filesystem::temp_directory_path() / "mpointers_usage_test";
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 16 * 1024 * 1024, folder.string())) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+
+    // Session `big` holds 100 x 1 KB CHAR and 10 DOUBLE; `small` 10 INT;
+    // session 0 one 64 KB CHAR block
+    std::vector<uint32_t> chars;
+    for (int i = 0; i < 100; ++i) {
+        chars.push_back(manager->createBlock(1024, "CHAR", 0, big));
+    }
+    for (int i = 0; i < 10; ++i) {
+        manager->createBlock(sizeof(double), "DOUBLE", 0, big);
+        manager->createBlock(sizeof(int), "INT", 0, small);
+    }
+    manager->createBlock(64 * 1024, "CHAR");
+
+    int failures = 0;
+    auto check = [&failures](bool ok, const std::string& what) {
+        if (!ok) {
+            std::cerr << "Failed: " << what << std::endl;
+            failures++;
+        }
+    };
+
+    memory_service::GetUsageResponse tags = usage(manager, memory_service::USAGE_BY_TAG, false, 2);
+    std::cout << "Tags: " << tags.groups() << ", total " << tags.total_bytes() << " bytes in "
+              << tags.total_blocks() << " blocks" << std::endl;
+    for (const auto& entry : tags.entries()) {
+        std::cout << "  session " << entry.session_id() << " " << entry.type() << ": " << entry.blocks()
+                  << " blocks, " << entry.bytes() << " bytes, " << entry.growth_bytes_per_sec() << " B/s" << std::endl;
+    }
+    check(tags.groups() == 4 && tags.entries_size() == 2, "top-N cut");
+    check(tags.total_blocks() == 121 && tags.total_bytes() == 100 * 1024 + 80 + 40 + 64 * 1024, "totals");
+    check(tags.entries(0).session_id() == big && tags.entries(0).type() == "CHAR" &&
+          tags.entries(0).bytes() == 100 * 1024, "largest tag");
+    check(tags.entries(1).session_id() == 0 && tags.entries(1).bytes() == 64 * 1024, "second tag");
+    check(tags.entries(0).growth_bytes_per_sec() > 0, "growth of a new tag");
+
+    memory_service::GetUsageResponse sessions = usage(manager, memory_service::USAGE_BY_SESSION);
+    check(sessions.groups() == 3 && sessions.entries(0).session_id() == big &&
+          sessions.entries(0).bytes() == 100 * 1024 + 80 && sessions.entries(0).type().empty(), "by session");
+    memory_service::GetUsageResponse types = usage(manager, memory_service::USAGE_BY_TYPE);
+    check(types.groups() == 3 && types.entries(0).type() == "CHAR" &&
+          types.entries(0).bytes() == 164 * 1024, "by type");
+
+    // Frees come off the tag; a claimed reservation moves to its session
+    for (int i = 0; i < 50; ++i) {
+        manager->releaseBlock(chars[i]);
+    }
+    std::vector<uint32_t> reserved = manager->reserveBlocks(2048, "CHAR", 4, std::chrono::seconds(10));
+    std::vector<uint64_t> claim(reserved.begin(), reserved.end());
+    manager->claimReservations(claim.data(), claim.size(), small);
+
+    tags = usage(manager, memory_service::USAGE_BY_TAG);
+    uint64_t big_chars = 0;
+    uint64_t big_freed = 0;
+    uint64_t small_chars = 0;
+    uint64_t unowned_chars = 0;
+    for (const auto& entry : tags.entries()) {
+        if (entry.type() != "CHAR") continue;
+        if (entry.session_id() == big) {
+            big_chars = entry.bytes();
+            big_freed = entry.freed_bytes();
+        } else if (entry.session_id() == small) {
+            small_chars = entry.bytes();
+        } else {
+            unowned_chars = entry.bytes();
+        }
+    }
+    check(big_chars == 50 * 1024 && big_freed == 50 * 1024, "frees");
+    check(small_chars == 4 * 2048 && unowned_chars == 64 * 1024, "claimed reservations");
+
+    manager->stop();
+    if (failures != 0) {
+        std::cerr << "Usage test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include "../src/memory_manager/memory_manager.h"
+
+// Reserves blocks, claims one for a session and creates another under it
+// with the WAL on, checkpoints halfway, then restarts the MemoryManager
+// from the log. Unclaimed reservations must expire after recovery instead
+// of leaking, the session must still be able to release its blocks, and
+// its blocks must still be charged to it.
+static bool block_exists(MemoryManager* manager, uint32_t id) {
+    int value;
+    return manager->getValue(id, &value, sizeof(value));
+}
+
+int main() {
+    const uint64_t session = 77;
+    const auto lease = std::chrono::milliseconds(500);
+    auto dump_folder = std::filesystem::temp_directory_path() / "mpointers_wal_test";
+    std::filesystem::remove_all(dump_folder);
+
+    WalOptions wal;
+    wal.enabled = true;
+    wal.commitWindow = std::chrono::microseconds(100);
+
+    MemoryManager* manager = MemoryManager::getInstance();
+    if (!manager->initialize(0, 1024 * 1024, dump_folder.string(), wal)) {
+        std::cerr << "Failed to initialize memory manager" << std::endl;
+        return 1;
+    }
+    manager->setDumps(false);
+    manager->heartbeat(session, std::chrono::seconds(10));
+    std::vector<uint32_t> reserved = manager->reserveBlocks(sizeof(int), "INT", 4, lease);
+    uint64_t claim = reserved.front();
+    manager->claimReservations(&claim, 1, session);
+    manager->checkpoint();
+    uint32_t created = manager->createBlock(sizeof(int), "INT", 0, session);
+    manager->stop();
+
+    // Recovery replays the checkpoint and the records after it
+    if (!manager->initialize(0, 1024 * 1024, dump_folder.string(), wal)) {
+        std::cerr << "Failed to recover memory manager" << std::endl;
+        return 1;
+    }
+    manager->start();
+
+    int failures = 0;
+    if (reserved.size() != 4 || !block_exists(manager, created)) {
+        std::cerr << "Blocks were not recovered" << std::endl;
+        failures++;
+    }
+
+    // The claimed and the created block are still charged to the session
+    memory_service::MemoryManager::Service* service = manager;
+    memory_service::GetUsageRequest usage_request;
+    memory_service::GetUsageResponse usage;
+    usage_request.set_group_by(memory_service::USAGE_BY_SESSION);
+    service->GetUsage(nullptr, &usage_request, &usage);
+    uint64_t owned = 0;
+    for (const auto& entry : usage.entries()) {
+        if (entry.session_id() == session) owned = entry.blocks();
+    }
+    std::cout << "Blocks charged to the session after recovery: " << owned << std::endl;
+    if (owned != 2) {
+        std::cerr << "Recovered blocks lost their owner" << std::endl;
+        failures++;
+    }
+    if (manager->decreaseRefCount(created, session + 1)) {
+        std::cerr << "Another session released a reference it never held" << std::endl;
+        failures++;
+    }
+    if (!manager->decreaseRefCount(created, session)) {
+        std::cerr << "The recovered session could not release its block" << std::endl;
+        failures++;
+    }
+
+    // Lease plus one GC pass
+    std::this_thread::sleep_for(lease + std::chrono::milliseconds(1500));
+    int leaked = 0;
+    for (size_t i = 1; i < reserved.size(); ++i) {
+        leaked += block_exists(manager, reserved[i]) ? 1 : 0;
+    }
+    std::cout << "Unclaimed reservations left after recovery: " << leaked << std::endl;
+    if (leaked != 0 || !block_exists(manager, reserved.front()) || block_exists(manager, created)) {
+        std::cerr << "Recovered reservations or session references are wrong" << std::endl;
+        failures++;
+    }
+    manager->stop();
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "Test completed successfully!" << std::endl;
+    return 0;
+}